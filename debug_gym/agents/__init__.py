@@ -1,3 +1,4 @@
+from debug_gym.agents.best_of_n_agent import BestOfNAgent
 from debug_gym.agents.debug_agent import Debug_5_Agent, DebugAgent
 from debug_gym.agents.rewrite_agent import RewriteAgent
 from debug_gym.agents.solution_agent import AgentSolution
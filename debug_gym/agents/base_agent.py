@@ -7,8 +7,11 @@ from os.path import join as pjoin
 import numpy as np
 from jinja2 import Environment, Template
 
+from debug_gym.agents.history_compactor import HistoryCompactor
 from debug_gym.agents.history_tracker import HistoryTracker, build_history_prompt
-from debug_gym.gym.envs.env import RepoEnv
+from debug_gym.agents.loop_detector import LoopDetector, StepFingerprint
+from debug_gym.agents.observation_dedup import ObservationDeduplicator
+from debug_gym.gym.envs.env import EnvInfo, RepoEnv
 from debug_gym.gym.utils import filter_non_utf8
 from debug_gym.llms.base import LLM
 from debug_gym.llms.utils import trim
@@ -49,15 +52,38 @@ class BaseAgent:
 
         self.set_seed(self.config["random_seed"])
         self.history = HistoryTracker(self.config["memory_size"])
+        self.loop_detector = LoopDetector.from_config(self.config.get("loop_detection"))
+        self.loop_warning = None  # Added to the next prompt when looping.
+        self.history_compactor = self._create_history_compactor()
+        self.deduplicator = ObservationDeduplicator.from_config(
+            self.config.get("dedup_observations")
+        )
 
     def set_seed(self, seed):
         np.random.seed(seed)
 
+    def _create_history_compactor(self) -> HistoryCompactor | None:
+        """Compactor from the `history_compaction` config, None if disabled."""
+        config = self.config.get("history_compaction")
+        if not config:
+            return None
+        config = dict(config)
+        summary_llm = None
+        if config.get("llm_name"):
+            summary_llm = LLM.instantiate(
+                config.pop("llm_name"),
+                self.config.get("llm_config_file_path"),
+                logger=self.logger,
+            )
+        return HistoryCompactor(**config, summary_llm=summary_llm, logger=self.logger)
+
     def build_history_prompt(self):
         messages = build_history_prompt(
             self.history,
             self.llm,
             self.config.get("reset_prompt_history_after_rewrite", False),
+            compactor=self.history_compactor,
+            deduplicator=self.deduplicator,
         )
         return messages
 
@@ -215,14 +241,64 @@ class BaseAgent:
         messages.extend(self.build_system_prompt(info))
         messages.extend(self.build_history_prompt())
         messages.extend(self.build_question_prompt())
+        if self.loop_warning:
+            messages.append({"role": "user", "content": self.loop_warning})
         return messages
 
+    @staticmethod
+    def episode_status(info: EnvInfo, stalled: bool = False) -> str:
+        if info.resolved:
+            return "resolved"
+        return "stalled" if stalled else "unresolved"
+
+    def reset_episode(self):
+        """Reset the per-episode state of the agent."""
+        self.history.reset()
+        self.loop_warning = None
+        if self.loop_detector is not None:
+            self.loop_detector.reset()
+        if self.history_compactor is not None:
+            self.history_compactor.reset()
+
+    def detect_loop(self, info: EnvInfo) -> bool:
+        """Fingerprints the last step with the hash of the workspace diff, and
+        responds to loops (see LoopDetector). Returns True if the episode has
+        stalled."""
+        if self.loop_detector is None:
+            return False
+        event = self.loop_detector.update(
+            StepFingerprint.from_info(info, self.env.changes_digest)
+        )
+        if event is None:
+            return False
+
+        self.logger.warning(
+            f"Loop detected: step repeated {event.repeats} times "
+            f"({event.kind} duplicate), action: {event.action}."
+        )
+        if event.action == "stop":
+            return True
+        if event.action == "escalate":
+            if hasattr(self.llm, "escalate"):
+                self.llm.escalate()  # e.g., RoutingLLM.
+            else:
+                self.logger.warning(f"{self.llm} cannot escalate, warning instead.")
+        self.loop_warning = (
+            f"Your last action repeated one of your previous steps {event.repeats} "
+            "times with the same outcome, without making progress. Do not repeat "
+            "it: take a different approach."
+        )
+        return False
+
     def run(self, task_name=None, debug=False):
         step = 0
         info = None
+        stalled = False
         max_steps = self.config["max_steps"]
         try:
-            self.history.reset()
+            self.reset_episode()
+            if self.llm is not None:
+                self.llm.routing_key = f"{self._uuid}/{task_name}"
             info = self.env.reset(options={"task_name": task_name})
             # initial state does not have prompt and response
             self.history.step(info, None)
@@ -252,6 +328,7 @@ class BaseAgent:
 
                 messages = self.build_prompt(info)
                 llm_response = self.llm(messages, info.tools)
+                self.loop_warning = None
 
                 if debug:
                     breakpoint()
@@ -262,14 +339,17 @@ class BaseAgent:
                     llm_response.reasoning_response,
                 )
                 self.history.step(info, llm_response)
+                stalled = not info.terminated and self.detect_loop(info)
 
                 if (
                     info.terminated
+                    or stalled
                     or info.rewrite_counter >= self.config["max_rewrite_steps"]
                 ):
                     reason = (
                         "terminated" if info.resolved else "max_rewrite_steps reached"
                     )
+                    reason = "stalled" if stalled else reason
                     self.logger.info(
                         f"Step: {step} | Score: {info.score}/{info.max_score if info.max_score else '-'} | Reason: {reason}"
                     )
@@ -280,7 +360,7 @@ class BaseAgent:
                         total_steps=step + 1,
                         score=info.score,
                         max_score=info.max_score,
-                        status="resolved" if info.resolved else "unresolved",
+                        status=self.episode_status(info, stalled),
                     )
                     break
                 # keep progress bar running until max_steps is reached
@@ -299,7 +379,7 @@ class BaseAgent:
                 total_steps=step + 1,
                 score=info.score,
                 max_score=info.max_score,
-                status="resolved" if info.resolved else "unresolved",
+                status=self.episode_status(info, stalled),
             )
             return info.resolved
         except Exception:
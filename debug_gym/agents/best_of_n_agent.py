@@ -0,0 +1,242 @@
+import copy
+from concurrent.futures import ThreadPoolExecutor
+from dataclasses import dataclass
+from typing import Callable
+
+from debug_gym.agents.base_agent import BaseAgent, register_agent
+from debug_gym.agents.debug_agent import DebugAgent
+from debug_gym.gym.envs.env import EnvInfo, RepoEnv
+from debug_gym.llms.base import LLMResponse
+
+
+@dataclass
+class BranchResult:
+    agent: BaseAgent  # Copy of the agent, with the branch's env and history.
+    info: EnvInfo
+    steps: int
+
+    @property
+    def rank(self) -> tuple:
+        return (self.info.resolved, self.info.score or 0, -self.steps)
+
+
+@register_agent
+class BestOfNAgent(DebugAgent):
+    """Explores `n_candidates` branches in parallel at decision points, and
+    continues with the best one. Decision points (`branch_at`) are:
+
+    - `start`: each branch runs `rollout_steps` steps from the initial state.
+    - `rewrite`: when the agent calls the rewrite tool, the other branches
+      sample their own action from the same prompt (at most `max_branch_points`
+      times per episode).
+
+    The first branch runs in the agent's environment, the others in forks of
+    it (see `RepoEnv.fork_into`), created with `env_factory`, and with forks of
+    the LLM under their own routing key (see `LLM.fork`). The LLM calls and
+    sandbox work of the branches run concurrently. Branches are scored by
+    evaluating their code, and the best one (resolved, then highest score, then
+    fewest steps) continues: its code, history and score are brought back into
+    the agent's environment.
+    """
+
+    name = "best_of_n_agent"
+
+    def __init__(self, *args, **kwargs):
+        super().__init__(*args, **kwargs)
+        self.n_candidates = self.config.get("n_candidates", 4)
+        self.branch_at = self.config.get("branch_at", ["start", "rewrite"])
+        self.rollout_steps = self.config.get("rollout_steps", 3)
+        self.max_branch_points = self.config.get("max_branch_points", 5)
+        # Creates environments with the same config and tools (see scripts/run.py).
+        self.env_factory: Callable[[], RepoEnv] | None = None
+        self.branch_envs: list[RepoEnv] = []
+
+    def _branch_envs(self) -> list[RepoEnv]:
+        if self.env_factory is None:
+            raise ValueError(f"{self.name} requires an `env_factory` to fork envs.")
+        while len(self.branch_envs) < self.n_candidates - 1:
+            self.branch_envs.append(self.env_factory())
+        return self.branch_envs
+
+    def close_branch_envs(self):
+        for env in self.branch_envs:
+            env.close()
+        self.branch_envs = []
+
+    def _branch_agent(self, env: RepoEnv, index: int) -> BaseAgent:
+        branch = copy.copy(self)
+        branch.env = env
+        if index > 0 and self.llm is not None:
+            # The branches must not share the state of the episode's requests.
+            branch.llm = self.llm.fork(f"{self.llm.routing_key}/branch{index}")
+        branch.history = self.history.clone()
+        branch.loop_detector = copy.deepcopy(self.loop_detector)
+        if self.history_compactor is not None:
+            branch.history_compactor = self.history_compactor.fork()
+        return branch
+
+    def rollout(
+        self,
+        branch: BaseAgent,
+        info: EnvInfo,
+        steps: int,
+        llm_response: LLMResponse | None = None,
+    ) -> BranchResult:
+        """Run `steps` steps of the branch (starting with `llm_response` if
+        given), then evaluate its code."""
+        taken = 0
+        for step in range(steps):
+            if step > 0 or llm_response is None:
+                llm_response = branch.llm(branch.build_prompt(info), info.tools)
+            info = branch.env.step(
+                llm_response.tool,
+                llm_response.response,
+                llm_response.reasoning_response,
+            )
+            branch.history.step(info, llm_response)
+            taken += 1
+            if info.terminated:
+                break
+        last_tool = info.action_tool_call.name if info.action_tool_call else None
+        evaluated = last_tool == "eval" or (
+            last_tool == "rewrite" and branch.env.auto_eval_on_rewrite
+        )
+        if not evaluated:
+            info = branch.env.evaluate()
+        return BranchResult(branch, info, taken)
+
+    def branch(
+        self, info: EnvInfo, steps: int, llm_response: LLMResponse | None = None
+    ) -> tuple[EnvInfo, int]:
+        """Explore `n_candidates` branches of `steps` steps from the current
+        state, and continue with the best one. Returns its last info and the
+        number of steps it took."""
+        envs = [self.env] + self._branch_envs()
+        responses = [llm_response] + [None] * (len(envs) - 1)
+        changes = self.env.changes
+        with ThreadPoolExecutor(len(envs), "debug-gym-branch") as executor:
+            infos = [info] + list(
+                executor.map(
+                    lambda env: self.env.fork_into(env, changes=changes), envs[1:]
+                )
+            )
+            results = list(
+                executor.map(
+                    lambda index, info, response: self.rollout(
+                        self._branch_agent(envs[index], index), info, steps, response
+                    ),
+                    range(len(envs)),
+                    infos,
+                    responses,
+                )
+            )
+
+        best = max(range(len(results)), key=lambda i: results[i].rank)
+        self.logger.info(
+            f"Branch scores: {[r.info.score for r in results]}, continuing with "
+            f"branch {best} ({results[best].steps} steps)."
+        )
+        winner = results[best]
+        info = winner.info
+        if winner.agent.env is not self.env:
+            info = winner.agent.env.fork_into(self.env)
+        self.history = winner.agent.history
+        self.loop_detector = winner.agent.loop_detector
+        self.history_compactor = winner.agent.history_compactor
+        return info, winner.steps
+
+    def run(self, task_name=None, debug=False):
+        step = 0
+        info = None
+        stalled = False
+        max_steps = self.config["max_steps"]
+        try:
+            self.reset_episode()
+            if self.llm is not None:
+                self.llm.routing_key = f"{self._uuid}/{task_name}"
+            info = self.env.reset(options={"task_name": task_name})
+            # initial state does not have prompt and response
+            self.history.step(info, None)
+
+            if info.resolved is True:
+                self.logger.report_progress(
+                    problem_id=task_name,
+                    step=1,
+                    total_steps=1,
+                    score=info.score,
+                    max_score=info.max_score,
+                    status="resolved",
+                )
+                return True
+
+            branch_points = 0
+            if "start" in self.branch_at:
+                info, step = self.branch(info, min(self.rollout_steps, max_steps))
+
+            while (
+                step < max_steps
+                and not info.terminated
+                and not stalled
+                and info.rewrite_counter < self.config["max_rewrite_steps"]
+            ):
+                self.logger.info(f"\n{'='*20} STEP {step+1} {'='*20}\n")
+                self.logger.info(
+                    f"[{task_name[:10]:<10}] Step {step} | Score: {info.score}/{info.max_score or '-'}"
+                )
+                messages = self.build_prompt(info)
+                llm_response = self.llm(messages, info.tools)
+                self.loop_warning = None
+
+                if debug:
+                    breakpoint()
+
+                if (
+                    "rewrite" in self.branch_at
+                    and llm_response.tool is not None
+                    and llm_response.tool.name == "rewrite"
+                    and branch_points < self.max_branch_points
+                ):
+                    info, steps = self.branch(info, 1, llm_response)
+                    branch_points += 1
+                else:
+                    info = self.env.step(
+                        llm_response.tool,
+                        llm_response.response,
+                        llm_response.reasoning_response,
+                    )
+                    self.history.step(info, llm_response)
+                    steps = 1
+                step += steps
+                stalled = not info.terminated and self.detect_loop(info)
+
+                self.logger.report_progress(
+                    problem_id=task_name,
+                    step=step,
+                    total_steps=max_steps + 1,
+                    score=info.score,
+                    max_score=info.max_score,
+                    status="running",
+                )
+
+            self.logger.report_progress(
+                problem_id=task_name,
+                step=step,
+                total_steps=step,
+                score=info.score,
+                max_score=info.max_score,
+                status=self.episode_status(info, stalled),
+            )
+            return info.resolved
+        except Exception:
+            # report any error that happens during the run
+            self.logger.report_progress(
+                problem_id=task_name,
+                step=step + 1,
+                total_steps=step + 1,
+                score=info.score if info else 0,
+                max_score=info.max_score if info else None,
+                status="error",
+            )
+            raise
+        finally:
+            self.close_branch_envs()
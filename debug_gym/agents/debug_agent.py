@@ -13,12 +13,13 @@ class Debug_5_Agent(DebugAgent):
 
     def run(self, task_name=None, debug=False):
         step = 0
+        stalled = False
         max_steps = self.config["max_steps"]
         try:
             # remove the pdb tool from the environment
             pdb_tool = self.env.remove_tool("pdb")
 
-            self.history.reset()
+            self.reset_episode()
             info = self.env.reset(options={"task_name": task_name})
             # initial state does not have prompt and response
             self.history.step(info, None)
@@ -45,6 +46,7 @@ class Debug_5_Agent(DebugAgent):
 
                 messages = self.build_prompt(info)
                 llm_response = self.llm(messages, info.tools)
+                self.loop_warning = None
 
                 if debug:
                     breakpoint()
@@ -67,12 +69,15 @@ class Debug_5_Agent(DebugAgent):
                     info.tools = self.env.tools
 
                 self.history.step(info, llm_response)
+                stalled = not info.terminated and self.detect_loop(info)
 
                 if (
                     info.terminated
+                    or stalled
                     or info.rewrite_counter >= self.config["max_rewrite_steps"]
                 ):
                     reason = "done" if info.resolved else "max_rewrite_steps reached"
+                    reason = "stalled" if stalled else reason
                     self.logger.info(
                         f"Step: {step} | Score: {info.score}/{info.max_score} ({info.score/info.max_score:.1%}) | Reason: {reason}"
                     )
@@ -83,7 +88,7 @@ class Debug_5_Agent(DebugAgent):
                         total_steps=step + 1,
                         score=info.score,
                         max_score=info.max_score,
-                        status="resolved" if info.resolved else "unresolved",
+                        status=self.episode_status(info, stalled),
                     )
                     break
                 # keep progress bar running until max_steps is reached
@@ -102,7 +107,7 @@ class Debug_5_Agent(DebugAgent):
                 total_steps=step + 1,
                 score=info.score,
                 max_score=info.max_score,
-                status="resolved" if info.resolved else "unresolved",
+                status=self.episode_status(info, stalled),
             )
             return info.resolved
         except Exception:
@@ -0,0 +1,182 @@
+import copy
+import json
+
+from debug_gym.agents.observation_dedup import ObservationDeduplicator
+from debug_gym.gym.envs.env import EnvInfo
+from debug_gym.llms.base import LLM
+from debug_gym.llms.routing import RoutingLLM
+from debug_gym.llms.utils import trim
+from debug_gym.logger import DebugGymLogger
+
+SUMMARY_PROMPT = (
+    "You summarize the earlier steps of an agent debugging a Python repository, "
+    "so that it can continue its work without them. Extend the previous summary, "
+    "if any, with the new steps. Keep the evidence needed to fix the bug: files "
+    "and functions inspected, relevant code snippets and values, error messages, "
+    "hypotheses confirmed or ruled out, and code changes made along with their "
+    "evaluation results. Be concise, and call the summarize_history tool."
+)
+
+
+class SummaryTool:
+    """Tool called by the summary model, so that any tool-calling LLM can be used."""
+
+    name = "summarize_history"
+    description = "Submit the updated summary of the previous steps."
+    arguments = {
+        "summary": {
+            "type": ["string"],
+            "description": "The previous summary extended with the new steps.",
+        },
+    }
+
+
+class HistoryCompactor:
+    """Keeps the history prompt bounded by replacing older steps with a summary.
+
+    Once the steps in the prompt exceed `max_tokens`, or leave the `memory_size`
+    window, the oldest ones are folded into the summary until the prompt is back
+    under half of `max_tokens`, keeping at least the `keep_recent` latest steps
+    verbatim. The summary is cached and extended with the newly folded steps,
+    rather than regenerated from the whole episode. It is written by
+    `summary_llm` (e.g., a cheaper model), by default the agent's LLM (its
+    default model if it routes the steps to several models).
+    """
+
+    def __init__(
+        self,
+        max_tokens: int,
+        keep_recent: int = 5,
+        summary_llm: LLM | None = None,
+        logger: DebugGymLogger | None = None,
+    ):
+        self.max_tokens = max_tokens
+        self.keep_recent = keep_recent
+        self.summary_llm = summary_llm
+        self.logger = logger or DebugGymLogger("debug-gym")
+        self.reset()
+
+    def reset(self):
+        self.summary: str | None = None
+        self.start = 0  # First step of the history prompt.
+        self.until = 0  # Steps before this one are in the summary.
+        # Token counts of the steps, by step index and observation shown.
+        self._step_tokens: dict[tuple[int, str], int] = {}
+
+    def fork(self) -> "HistoryCompactor":
+        """Copy with its own state, sharing the summary LLM (e.g., for a branch)."""
+        compactor = copy.copy(self)
+        compactor._step_tokens = dict(self._step_tokens)
+        return compactor
+
+    def summary_messages(self) -> list[dict]:
+        if not self.summary:
+            return []
+        return [
+            {
+                "role": "user",
+                "content": f"Summary of the previous steps:\n{self.summary}",
+            }
+        ]
+
+    def format_steps(
+        self, history, llm: LLM, deduplicator: ObservationDeduplicator | None = None
+    ) -> tuple[dict[int, list[dict]], dict[int, int]]:
+        """Messages and token counts of the steps not in the summary."""
+        indices = range(self.until, len(history))
+        infos = [history.memory[i] for i in indices]
+        if deduplicator is not None:
+            infos = deduplicator(infos)
+        messages, tokens = {}, {}
+        for i, info in zip(indices, infos):
+            messages[i] = llm.format_tool_call_history(
+                info, history.prompt_response_pairs[i]
+            )
+            key = (i, info.step_observation.observation)
+            if key not in self._step_tokens:
+                self._step_tokens[key] = llm.count_tokens(messages[i])
+            tokens[i] = self._step_tokens[key]
+        return messages, tokens
+
+    def build_history_prompt(
+        self,
+        history,
+        llm: LLM,
+        start: int = 0,
+        deduplicator: ObservationDeduplicator | None = None,
+    ) -> list[dict]:
+        """History messages from step `start`, with the older ones summarized."""
+        if start != self.start or not start <= self.until <= len(history):
+            self.reset()  # New episode, or the history was reset after a rewrite.
+            self.start = self.until = start
+
+        n_steps = len(history)
+        messages, tokens = self.format_steps(history, llm, deduplicator)
+        total = llm.count_tokens(self.summary_messages()) + sum(tokens.values())
+        end = self.until
+        if total > self.max_tokens or n_steps - end > history.history_steps:
+            remaining = total
+            while n_steps - end > history.history_steps or (
+                n_steps - end > self.keep_recent and remaining > self.max_tokens // 2
+            ):
+                remaining -= tokens[end]
+                end += 1
+
+        if end > self.until:
+            self.summarize(history, self.until, end, llm)
+            self.logger.info(
+                f"Summarized steps {self.until} to {end - 1} of the history "
+                f"({sum(tokens[i] for i in range(self.until, end)):,} tokens into "
+                f"{llm.count_tokens(self.summary_messages()):,})."
+            )
+            self.until = end
+            self._step_tokens = {
+                key: count for key, count in self._step_tokens.items() if key[0] >= end
+            }
+            if deduplicator is not None:
+                # Observations may have referred to the summarized ones.
+                messages, tokens = self.format_steps(history, llm, deduplicator)
+
+        _messages = self.summary_messages()
+        for i in range(self.until, n_steps):
+            _messages.extend(messages[i])
+        return _messages
+
+    def summarize(self, history, start: int, end: int, llm: LLM) -> None:
+        """Extend the summary with steps [start, end)."""
+        # Bypass the routing of the agent's steps (see RoutingLLM), so that
+        # summaries do not count as steps of the episode, nor take its
+        # escalation to the most capable model.
+        if isinstance(llm, RoutingLLM):
+            llm = llm.default_llm
+        llm = self.summary_llm or llm
+        steps = "\n\n".join(
+            self.format_step(i, history.memory[i]) for i in range(start, end)
+        )
+        content = f"Previous summary:\n{self.summary}\n\n" if self.summary else ""
+        content += f"New steps:\n{steps}"
+        content = trim(content, llm.context_length // 2, llm.count_tokens)
+        messages = [
+            {"role": "system", "content": SUMMARY_PROMPT},
+            {"role": "user", "content": content},
+        ]
+        response = llm(messages, [SummaryTool()])
+        if response.tool is not None and "summary" in response.tool.arguments:
+            summary = response.tool.arguments["summary"]
+        else:
+            summary = response.response  # Summary in the content.
+        if summary:
+            self.summary = summary
+
+    @staticmethod
+    def format_step(index: int, info: EnvInfo) -> str:
+        if info.action_tool_call is None:
+            return f"Step {index} (initial observation):\n{info.step_observation.observation}"
+        tool = info.action_tool_call
+        lines = [f"Step {index}: {tool.name}({json.dumps(tool.arguments)})"]
+        if info.action_reasoning:
+            lines.append(f"Reasoning: {info.action_reasoning}")
+        if info.action_content:
+            lines.append(f"Thoughts: {info.action_content}")
+        lines.append(f"Observation:\n{info.step_observation.observation}")
+        return "\n".join(lines)
@@ -1,6 +1,8 @@
 import copy
 from dataclasses import asdict
 
+from debug_gym.agents.history_compactor import HistoryCompactor
+from debug_gym.agents.observation_dedup import ObservationDeduplicator
 from debug_gym.gym.envs.env import EnvInfo
 from debug_gym.llms.base import LLM, LLMResponse
 
@@ -86,8 +88,21 @@ class HistoryTracker:
 
 
 def build_history_prompt(
-    history: HistoryTracker, llm: LLM, reset_prompt_history_after_rewrite: bool = False
+    history: HistoryTracker,
+    llm: LLM,
+    reset_prompt_history_after_rewrite: bool = False,
+    compactor: HistoryCompactor | None = None,
+    deduplicator: ObservationDeduplicator | None = None,
 ):
+    if compactor is not None:
+        # Older steps are summarized rather than dropped, see HistoryCompactor.
+        start = 0
+        if reset_prompt_history_after_rewrite and history.memory:
+            rewrite_counter = history.memory[-1].rewrite_counter
+            while history.memory[start].rewrite_counter != rewrite_counter:
+                start += 1
+        return compactor.build_history_prompt(history, llm, start, deduplicator)
+
     _history, _prompt_response_pairs = history.get()
     latest_rewrite_step = 0
     # Find the latest rewrite step if reset_prompt_history_after_rewrite
@@ -96,9 +111,12 @@ def build_history_prompt(
             if _history[i].rewrite_counter == _history[-1].rewrite_counter:
                 latest_rewrite_step = i
                 break
+    _history = _history[latest_rewrite_step:]
+    if deduplicator is not None:
+        _history = deduplicator(_history)
     _messages = []
     for history_info, response in zip(
-        _history[latest_rewrite_step:], _prompt_response_pairs[latest_rewrite_step:]
+        _history, _prompt_response_pairs[latest_rewrite_step:]
     ):
         _messages.extend(llm.format_tool_call_history(history_info, response))
     return _messages
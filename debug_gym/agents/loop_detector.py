@@ -0,0 +1,116 @@
+import hashlib
+import json
+import re
+from collections import deque
+from dataclasses import dataclass
+
+from debug_gym.gym.envs.env import EnvInfo
+from debug_gym.gym.tools.tool import ToolCall
+
+LOOP_ACTIONS = ("warn", "escalate", "stop")
+
+# Volatile parts of observations, e.g., timings, memory addresses, line counts.
+VOLATILE_PATTERN = re.compile(r"0x[0-9a-fA-F]+|\d+(\.\d+)?")
+
+
+def _digest(text: str) -> str:
+    return hashlib.sha1(text.encode(errors="replace")).hexdigest()
+
+
+@dataclass(frozen=True)
+class StepFingerprint:
+    action: str
+    observation: str
+    workspace: str
+    # Observation with its volatile parts masked, to catch near-duplicates.
+    near_observation: str
+
+    @classmethod
+    def from_info(cls, info: EnvInfo, workspace: str) -> "StepFingerprint":
+        """Fingerprint of a step: the action taken (without its call id), the
+        observation it got, and the state of the workspace (e.g., its diff)."""
+        tool = info.action_tool_call
+        if isinstance(tool, ToolCall):
+            action = json.dumps(
+                [tool.name, tool.arguments], sort_keys=True, default=str
+            )
+        else:
+            action = str(tool)
+        observation = info.step_observation.observation
+        near_observation = " ".join(VOLATILE_PATTERN.sub("#", observation).split())
+        return cls(
+            action=_digest(action),
+            observation=_digest(observation),
+            workspace=_digest(workspace),
+            near_observation=_digest(near_observation),
+        )
+
+    @property
+    def exact_key(self) -> tuple[str, str, str]:
+        return self.action, self.observation, self.workspace
+
+    @property
+    def near_key(self) -> tuple[str, str, str]:
+        return self.action, self.near_observation, self.workspace
+
+
+@dataclass
+class LoopEvent:
+    kind: str  # "exact" or "near" (same observation up to volatile parts).
+    repeats: int  # Previous occurrences of the step within the window.
+    action: str  # One of LOOP_ACTIONS.
+
+
+class LoopDetector:
+    """Detects an agent going in circles: a step repeating one of the last
+    `window` steps (same action, observation and workspace state) at least
+    `max_repeats` times. This covers repeated tool calls as well as
+    oscillations between the same states (e.g., view A, view B, view A, ...).
+
+    The n-th detection of an episode is answered with the n-th of `actions`
+    (the last one once exhausted): `warn` the agent in its next prompt,
+    `escalate` the next step to a more capable model, or `stop` the episode.
+    """
+
+    def __init__(
+        self,
+        window: int = 10,
+        max_repeats: int = 2,
+        actions: list[str] | tuple[str, ...] = ("warn", "stop"),
+    ):
+        if not actions or set(actions) - set(LOOP_ACTIONS):
+            raise ValueError(f"Loop actions must be some of {LOOP_ACTIONS}.")
+        if max_repeats < 1:
+            raise ValueError("max_repeats must be at least 1.")
+        self.window = window
+        self.max_repeats = max_repeats
+        self.actions = list(actions)
+        self.reset()
+
+    @classmethod
+    def from_config(cls, config: dict | None) -> "LoopDetector | None":
+        """Detector from the agent's `loop_detection` config, None if disabled."""
+        if not config:
+            return None
+        config = {} if config is True else dict(config)
+        return cls(**config)
+
+    def reset(self):
+        self._steps: deque[StepFingerprint] = deque(maxlen=self.window)
+        self.detections = 0
+
+    def update(self, fingerprint: StepFingerprint) -> LoopEvent | None:
+        """Records a step, returns the loop it closes if any."""
+        exact = sum(s.exact_key == fingerprint.exact_key for s in self._steps)
+        near = sum(s.near_key == fingerprint.near_key for s in self._steps)
+        self._steps.append(fingerprint)
+        if exact >= self.max_repeats:
+            kind, repeats = "exact", exact
+        elif near >= self.max_repeats:
+            kind, repeats = "near", near
+        else:
+            return None
+
+        action = self.actions[min(self.detections, len(self.actions) - 1)]
+        self.detections += 1
+        return LoopEvent(kind=kind, repeats=repeats, action=action)
@@ -0,0 +1,99 @@
+import difflib
+import json
+from dataclasses import replace
+
+from debug_gym.gym.entities import Observation
+from debug_gym.gym.envs.env import EnvInfo
+
+
+class ObservationDeduplicator:
+    """Shortens observations of the history prompt which repeat an earlier one,
+    e.g., views of the same file range, identical eval outputs after no-op
+    rewrites, or the pdb context around the current frame. An observation
+    identical to an earlier one is replaced with a reference to the call which
+    produced it, one mostly similar to an earlier one (at least `similarity`) by
+    a diff against it, if the diff is shorter than `max_diff_ratio` of it.
+
+    Only observations of at least `min_length` characters are shortened, and
+    only observations shown verbatim are referenced, so no information is lost.
+    """
+
+    def __init__(
+        self,
+        min_length: int = 300,
+        similarity: float = 0.8,
+        max_diff_ratio: float = 0.5,
+    ):
+        self.min_length = min_length
+        self.similarity = similarity
+        self.max_diff_ratio = max_diff_ratio
+
+    @classmethod
+    def from_config(
+        cls, config: dict | bool | None
+    ) -> "ObservationDeduplicator | None":
+        """Deduplicator from the agent's `dedup_observations` config."""
+        if not config:
+            return None
+        return cls() if config is True else cls(**config)
+
+    def __call__(self, infos: list[EnvInfo]) -> list[EnvInfo]:
+        """Copies of `infos` (in prompt order) with repeated observations shortened."""
+        verbatim: list[EnvInfo] = []
+        deduped = []
+        for info in infos:
+            observation = info.step_observation.observation
+            shortened = None
+            if len(observation) >= self.min_length:
+                shortened = self.shorten(observation, verbatim)
+            if shortened is None:
+                verbatim.append(info)
+                deduped.append(info)
+            else:
+                step_observation = Observation(info.step_observation.source, shortened)
+                deduped.append(replace(info, step_observation=step_observation))
+        return deduped
+
+    def shorten(self, observation: str, verbatim: list[EnvInfo]) -> str | None:
+        for info in reversed(verbatim):
+            if info.step_observation.observation == observation:
+                return f"[Same output as {self.describe(info)}.]"
+
+        lines = observation.splitlines()
+        best = None
+        for info in reversed(verbatim):
+            earlier = info.step_observation.observation
+            if len(earlier) < self.min_length:
+                continue
+            earlier_lines = earlier.splitlines()
+            matcher = difflib.SequenceMatcher(
+                None, earlier_lines, lines, autojunk=False
+            )
+            if (
+                matcher.real_quick_ratio() < self.similarity
+                or matcher.quick_ratio() < self.similarity
+                or matcher.ratio() < self.similarity
+            ):
+                continue
+            # Without the file headers.
+            diff = "\n".join(
+                list(difflib.unified_diff(earlier_lines, lines, n=1, lineterm=""))[2:]
+            )
+            if len(diff) <= len(observation) * self.max_diff_ratio:
+                if best is None or len(diff) < len(best[1]):
+                    best = info, diff
+
+        if best is None:
+            return None
+        info, diff = best
+        return f"[Same output as {self.describe(info)}, except:]\n{diff}"
+
+    @staticmethod
+    def describe(info: EnvInfo) -> str:
+        tool = info.action_tool_call
+        if tool is None:
+            return "the initial observation"
+        arguments = json.dumps(tool.arguments)
+        if len(arguments) > 100:
+            arguments = arguments[:100] + "…"
+        return f"the earlier `{tool.name}` call with arguments {arguments}"
@@ -31,6 +31,43 @@ def load_config():
         action="store_true",
         help="List available agents and problems.",
     )
+    parser.add_argument(
+        "--reap",
+        action="store_true",
+        help=(
+            "Delete the sandboxes (containers, pods) of the configured terminal "
+            "left behind by dead debug-gym processes of this host, then exit."
+        ),
+    )
+    parser.add_argument(
+        "--serve",
+        metavar="SOCKET_PATH",
+        help=(
+            "Serve the environments of the config to other processes on this "
+            "Unix socket instead of running agents (see debug_gym.gym.server)."
+        ),
+    )
+    parser.add_argument(
+        "--pool-size",
+        type=int,
+        default=4,
+        help="Number of environments kept ready by the server (with --serve).",
+    )
+    parser.add_argument(
+        "--certify",
+        metavar="CERTIFICATION_FILE",
+        help=(
+            "Check that the gold patch of each problem resolves it, reliably, "
+            "and write the results to this file instead of running agents "
+            "(see debug_gym.gym.certification)."
+        ),
+    )
+    parser.add_argument(
+        "--certify-runs",
+        type=int,
+        default=3,
+        help="Number of evals of each gold patch, to detect flaky tests (with --certify).",
+    )
     group = parser.add_mutually_exclusive_group()
     group.add_argument(
         "-v",
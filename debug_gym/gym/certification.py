@@ -0,0 +1,163 @@
+"""Certifies the tasks of a dataset before spending agent budgets on them, by
+checking that their gold patch resolves them, reliably.
+
+Each task is reset and evaluated once without its gold patch (it must not be
+resolved yet), then `runs` times with it (each eval must resolve it). Tasks
+failing to set up or not resolved by their gold patch are `broken`, the ones
+only resolved by some of the evals are `flaky`. The certificates are written to
+a certification file (JSON) as tasks complete, and environments given this file
+(`certification_file`) skip the tasks which are not certified when loading
+their dataset.
+"""
+
+import json
+import os
+import queue
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor, as_completed
+from dataclasses import asdict, dataclass, field
+from pathlib import Path
+from typing import Callable
+
+from debug_gym.logger import DebugGymLogger
+
+CERTIFIED = "certified"
+FLAKY = "flaky"
+BROKEN = "broken"
+
+
+@dataclass
+class TaskCertificate:
+    status: str  # `certified`, `flaky` or `broken`.
+    setup_time: float | None = None  # Seconds to reset the environment.
+    eval_times: list[float] = field(default_factory=list)  # Seconds, per gold eval.
+    results: list[bool] = field(default_factory=list)  # Resolved, per gold eval.
+    error: str | None = None  # Why the task is broken, if it is.
+
+
+class Certification:
+    """Certificates of the tasks of a dataset, by task name."""
+
+    def __init__(self, tasks: dict[str, TaskCertificate] | None = None):
+        self.tasks = tasks or {}
+
+    @classmethod
+    def load(cls, path: str | Path) -> "Certification":
+        with open(path) as f:
+            data = json.load(f)
+        return cls(
+            {name: TaskCertificate(**task) for name, task in data["tasks"].items()}
+        )
+
+    def save(self, path: str | Path) -> None:
+        """Write the certification file atomically, so readers never see it
+        half-written."""
+        tasks = {name: asdict(self.tasks[name]) for name in sorted(self.tasks)}
+        tmp_path = f"{path}.tmp"
+        with open(tmp_path, "w") as f:
+            json.dump({"tasks": tasks}, f, indent=2)
+        os.replace(tmp_path, path)
+
+    def uncertified_tasks(self) -> list[str]:
+        """Tasks found broken or flaky."""
+        return sorted(
+            name for name, task in self.tasks.items() if task.status != CERTIFIED
+        )
+
+
+def certify_task(env, task_name: str, runs: int = 3) -> TaskCertificate:
+    """Certify a task with its gold patch (see `RepoEnv.apply_gold_patch`)."""
+    certificate = TaskCertificate(status=BROKEN)
+    try:
+        start = time.perf_counter()
+        env.reset(options={"task_name": task_name})
+        certificate.setup_time = time.perf_counter() - start
+        if env.evaluate().resolved:
+            certificate.error = "The task is resolved without the gold patch."
+            return certificate
+
+        env.apply_gold_patch()
+        for _ in range(runs):
+            start = time.perf_counter()
+            infos = env.evaluate()
+            certificate.eval_times.append(time.perf_counter() - start)
+            certificate.results.append(infos.resolved)
+    except Exception as e:
+        certificate.error = repr(e)
+        return certificate
+
+    if all(certificate.results):
+        certificate.status = CERTIFIED
+    elif any(certificate.results):
+        certificate.status = FLAKY
+    else:
+        certificate.error = "The task is not resolved by the gold patch."
+    return certificate
+
+
+class Certifier:
+    """Certifies tasks concurrently on a pool of `workers` environments, each
+    reset on one task after the other (see `RepoEnv.reuse_sandbox` and the
+    shared Docker terminal to also share their sandboxes)."""
+
+    def __init__(
+        self,
+        env_factory: Callable,
+        workers: int = 1,
+        runs: int = 3,
+        logger: DebugGymLogger | None = None,
+    ):
+        self.env_factory = env_factory
+        self.workers = max(workers, 1)
+        self.runs = runs
+        self.logger = logger or DebugGymLogger("debug-gym")
+        self._envs = queue.SimpleQueue()  # Idle environments.
+        self._all_envs = []
+        self._lock = threading.Lock()
+
+    def _acquire(self):
+        try:
+            return self._envs.get_nowait()
+        except queue.Empty:
+            env = self.env_factory()
+            with self._lock:
+                self._all_envs.append(env)
+            return env
+
+    def _certify(self, task_name: str) -> TaskCertificate:
+        env = self._acquire()
+        certificate = certify_task(env, task_name, self.runs)
+        self._envs.put(env)
+        return certificate
+
+    def certify(
+        self, tasks: list[str], certification_file: str | Path, force: bool = False
+    ) -> Certification:
+        """Certify `tasks`, except the ones already in the certification file
+        (unless `force`), and save each certificate to the file."""
+        certification = Certification()
+        if Path(certification_file).exists():
+            certification = Certification.load(certification_file)
+        pending = [task for task in tasks if force or task not in certification.tasks]
+        self.logger.info(
+            f"Certifying {len(pending)} tasks ({len(tasks) - len(pending)} already "
+            f"certified) with {self.workers} workers."
+        )
+
+        executor = ThreadPoolExecutor(self.workers, "debug-gym-certify")
+        try:
+            futures = {executor.submit(self._certify, task): task for task in pending}
+            for i, future in enumerate(as_completed(futures), start=1):
+                task, certificate = futures[future], future.result()
+                certification.tasks[task] = certificate
+                certification.save(certification_file)
+                error = f": {certificate.error}" if certificate.error else ""
+                self.logger.info(
+                    f"[{i}/{len(pending)}] {task} is {certificate.status}{error}"
+                )
+        finally:
+            executor.shutdown(wait=True, cancel_futures=True)
+            for env in self._all_envs:
+                env.close()
+        return certification
@@ -1,4 +1,4 @@
-from dataclasses import dataclass
+from dataclasses import dataclass, field
 from enum import Enum
 
 
@@ -6,6 +6,9 @@ from enum import Enum
 class EvalOutput:
     success: bool
     output: str
+    truncated: bool = False  # Whether the evaluation was stopped early.
+    # Tests not run, as not impacted by the changes (see `RepoEnv.test_impact`).
+    skipped_tests: list[str] = field(default_factory=list)
 
 
 @dataclass
@@ -34,7 +34,7 @@ def build_docker_image(logger):
     # Then install git and the required Python packages
     setup_commands = [
         "apt update",
-        "apt install -y git tree",
+        "apt install -y git",
         "pip install pytest",
     ]
     # Create a temporary Dockerfile
@@ -83,12 +83,18 @@ class AiderBenchmarkEnv(RepoEnv):
         return utils.extract_max_score_from_pytest_output(eval_output.output)
 
     def calculate_score(self, eval_output: EvalOutput) -> int:
-        return utils.extract_reward_from_pytest_output(eval_output.output)
-
-    def eval(self, **kwargs) -> EvalOutput:
-        success, output = self.terminal.run(self.entrypoint, timeout=self.run_timeout)
+        # Tests skipped as not impacted by the changes passed before them.
+        passed = utils.extract_reward_from_pytest_output(eval_output.output)
+        return passed + len(eval_output.skipped_tests)
+
+    def eval(self, impacted_tests_only: bool = False, **kwargs) -> EvalOutput:
+        entrypoint, skipped_tests = self.entrypoint, []
+        if impacted_tests_only:
+            entrypoint, skipped_tests = self.impacted_tests_entrypoint()
+        success, output = self.terminal.run(entrypoint, timeout=self.run_timeout)
         output = utils.cleanup_pytest_output(output)
-        self.last_eval = EvalOutput(success, output)
+        output += self.skipped_tests_message(skipped_tests)
+        self.last_eval = EvalOutput(success, output, skipped_tests=skipped_tests)
         return self.last_eval
 
     def setup_task(self, task_name: str, options: dict = None):
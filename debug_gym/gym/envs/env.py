@@ -1,15 +1,102 @@
-from dataclasses import dataclass
+import copy
+import json
+import math
+import re
+import shlex
+from concurrent.futures import ThreadPoolExecutor
+from dataclasses import dataclass, replace
 from pathlib import Path
 
 import numpy as np
 
+from debug_gym.gym.certification import Certification
 from debug_gym.gym.entities import EvalOutput, Event, Observation
 from debug_gym.gym.terminals.local import LocalTerminal
+from debug_gym.gym.terminals.shared_docker import SharedDockerTerminal
 from debug_gym.gym.terminals.terminal import Terminal
 from debug_gym.gym.tools.tool import EnvironmentTool, ToolCall
-from debug_gym.gym.workspace import Workspace
+from debug_gym.gym.utils import trace_entrypoint
+from debug_gym.gym.workspace import (
+    SANDBOX_PYCACHE_DIR,
+    SANDBOX_SCRIPTS_DIR,
+    SandboxSnapshot,
+    Workspace,
+)
 from debug_gym.logger import DebugGymLogger
 
+IMPACT_SCRIPT = "impact_index.py"
+IMPACT_INDEX_FILE = f"{SANDBOX_SCRIPTS_DIR}/impact_index.json"
+MAX_LISTED_SKIPPED_TESTS = 20
+# Failing tests in pytest's short test summary, e.g. `FAILED tests/a.py::test_b - ...`.
+PYTEST_FAILED_TEST = re.compile(r"^(?:FAILED|ERROR) (\S+::\S+)", re.MULTILINE)
+# Pytest options followed by their value as a separate token, e.g. `-k expr`.
+PYTEST_OPTIONS_WITH_VALUE = set(
+    "-k -m -p -c -o -r -n -W --tb --rootdir --deselect --ignore --ignore-glob "
+    "--maxfail --durations --confcutdir --basetemp --import-mode --junitxml "
+    "--log-level".split()
+)
+
+
+def _pytest_position(tokens: list[str]) -> int | None:
+    """Position of the first argument of pytest in the entrypoint tokens."""
+    for i, token in enumerate(tokens):
+        if token in ("pytest", "pytest)") or token.endswith("/pytest"):
+            return i + 1
+    return None
+
+
+def select_pytest_tests(entrypoint: str, tests: list[str]) -> str:
+    """Replace the tests selected by a pytest entrypoint (files, directories or
+    node ids) with `tests`, e.g. `python -m pdb -m pytest -sq .` becomes
+    `python -m pdb -m pytest -sq tests/a.py::test_b`. The entrypoint is returned
+    as is if it does not run pytest or if `tests` has no node id."""
+    tests = [test for test in tests if "::" in test]
+    tokens = entrypoint.split()
+    start = _pytest_position(tokens)
+    if start is None or not tests:
+        return entrypoint
+
+    end = start
+    while end < len(tokens) and tokens[end] not in ("&&", "||", ";", "|"):
+        end += 1
+    options = [
+        token
+        for i, token in enumerate(tokens[start:end], start)
+        if token.startswith("-") or tokens[i - 1] in PYTEST_OPTIONS_WITH_VALUE
+    ]
+    selected = [shlex.quote(test) for test in tests]
+    return " ".join(tokens[:start] + options + selected + tokens[end:])
+
+
+def add_pytest_options(entrypoint: str, options: list[str]) -> str:
+    """Insert `options` right after pytest in the entrypoint."""
+    tokens = entrypoint.split()
+    start = _pytest_position(tokens)
+    if start is None:
+        raise ValueError(f"`{entrypoint}` does not run pytest.")
+    return " ".join(tokens[:start] + options + tokens[start:])
+
+
+def changed_lines(diff: str) -> dict[str, set[int]]:
+    """Lines of the original files changed by a diff without context (`-U0`),
+    per file. Lines around insertions count as changed. New files are skipped,
+    and binary files have no lines."""
+    changes = {}
+    lines = None
+    for line in diff.splitlines():
+        if line.startswith("diff --git "):
+            lines = None
+        elif lines is None and line.startswith("--- a/"):
+            lines = changes.setdefault(line[len("--- a/") :], set())
+        elif line.startswith("Binary files a/"):
+            path = line[len("Binary files a/") :].split(" and ")[0]
+            changes.setdefault(path, set())
+        elif line.startswith("@@ ") and lines is not None:
+            match = re.match(r"@@ -(\d+)(?:,(\d+))?", line)
+            start, count = int(match.group(1)), int(match.group(2) or 1)
+            lines.update(range(start, start + count) if count else (start, start + 1))
+    return changes
+
 
 @dataclass
 class EnvInfo:
@@ -88,6 +175,83 @@ class EnvInfo:
         return "\n".join(lines)
 
 
+@dataclass
+class PatchEval:
+    """Evaluation of a candidate patch (see `RepoEnv.eval_many`)."""
+
+    patch: str
+    eval_output: EvalOutput
+    score: int
+
+
+@dataclass
+class ImpactIndex:
+    """Lines of code executed by each test, recorded once at reset (see
+    `RepoEnv.test_impact`), as {file: set of line numbers}."""
+
+    shared: dict[str, set[int]]  # Executed outside of the tests, e.g. imports.
+    tests: dict[str, dict[str, set[int]]]
+    outcomes: dict[str, str]  # Outcome of the tests at reset.
+
+    @classmethod
+    def from_index(cls, index: dict) -> "ImpactIndex":
+        """Load the index written by `impact_index.py`."""
+
+        def lines(ranges_by_file: dict) -> dict[str, set[int]]:
+            result = {}
+            for file_index, ranges in ranges_by_file.items():
+                linenos = result.setdefault(index["files"][int(file_index)], set())
+                for part in ranges.split(","):
+                    start, _, end = part.partition("-")
+                    linenos.update(range(int(start), int(end or start) + 1))
+            return result
+
+        return cls(
+            shared=lines(index["shared"]),
+            tests={k: lines(test["lines"]) for k, test in index["tests"].items()},
+            outcomes={k: test["outcome"] for k, test in index["tests"].items()},
+        )
+
+    def skippable_tests(self, changes: dict[str, set[int]]) -> list[str]:
+        """Tests which passed at reset and execute none of the changed lines.
+        None can be skipped if a change is outside of the code executed by the
+        tests (e.g., a data file) or in code shared by all of them."""
+        recorded = set(self.shared).union(*self.tests.values())
+        for path, lines in changes.items():
+            if path not in recorded or lines & self.shared.get(path, set()):
+                return []
+        skippable = [
+            test
+            for test, outcome in self.outcomes.items()
+            if outcome == "passed"
+            and not any(
+                changes[path] & lines
+                for path, lines in self.tests[test].items()
+                if path in changes
+            )
+        ]
+        if len(skippable) == len(self.outcomes):
+            return []  # Pytest fails if no test is run.
+        return skippable
+
+
+class WorktreeTerminal:
+    """Runs the commands of `terminal` in another directory of its sandbox
+    (e.g., a git worktree), to reuse the environment's `eval` there."""
+
+    def __init__(self, terminal: Terminal, path: str):
+        self.terminal = terminal
+        self.path = path
+
+    def run(self, entrypoint: str | list[str], **kwargs) -> tuple[bool, str]:
+        if isinstance(entrypoint, str):
+            entrypoint = [entrypoint]
+        return self.terminal.run([f"cd {self.path}", *entrypoint], **kwargs)
+
+    def __getattr__(self, name):
+        return getattr(self.terminal, name)
+
+
 class EventHooks:
     def __init__(self):
         self.event_listeners = {event: [] for event in Event}
@@ -206,6 +370,12 @@ class TooledEnv:
 
 
 class RepoEnv(TooledEnv):
+    # Paths outside the repository modified by `setup_terminal`. They are restored
+    # when resetting the sandbox in place (see `reuse_sandbox`).
+    SANDBOX_RESTORE_PATHS: list[str] = []
+    # Paths outside the repository that are only checked for modifications
+    # when resetting the sandbox in place.
+    SANDBOX_VERIFY_PATHS: list[str] = []
 
     def __init__(
         self,
@@ -222,8 +392,37 @@ class RepoEnv(TooledEnv):
         terminal: Terminal | None = None,
         logger: DebugGymLogger | None = None,
         problems: str | list[str] | None = None,
+        reuse_sandbox: bool = False,
+        bytecode_cache: bool = False,
+        watch_files: bool = False,
+        test_impact: bool = False,
+        certification_file: str | None = None,
         **kwargs,
     ):
+        """
+        reuse_sandbox (bool): If True, a reset on the same task (or on a task
+                sharing the same sandbox, see `sandbox_key`) restores the sandbox
+                of the previous episode to its post-setup state instead of
+                setting up a new container or pod.
+        bytecode_cache (bool): If True, the code is compiled to bytecode once at
+                setup, into a directory of the sandbox outside the repository
+                (`PYTHONPYCACHEPREFIX`), so evals and pdb sessions import it from
+                there instead of recompiling it, without writing `.pyc` files
+                to the workspace.
+        watch_files (bool): If True, a watcher running in the sandbox reports the
+                files changed by each step (by any tool or process), which are
+                sent to the tools as a `FILE_CHANGE` event. The directory tree
+                is then only listed again after files are created or deleted.
+        test_impact (bool): If True, the lines of code executed by each test are
+                recorded at reset (pytest entrypoints only). Evals requested by
+                the agent then only run the tests executing the lines changed
+                since reset, and the tests which did not pass at reset. Final
+                evals (e.g., submit) still run all the tests.
+        certification_file (str): Certification file of the dataset (see
+                `debug_gym.gym.certification`). Like the `excluded` tasks of
+                the dataset config, the tasks found broken or flaky are skipped
+                when loading all the tasks.
+        """
         super().__init__()
 
         self.path = path
@@ -238,8 +437,22 @@ class RepoEnv(TooledEnv):
         self.auto_list = auto_list
         self.logger = logger or DebugGymLogger("debug-gym")
         self.infos: EnvInfo | None = None
+        self.reset_options: dict = {}  # Options of the last reset (see `fork_into`).
         self.rng = None
         self.additional_kwargs = kwargs
+        self.reuse_sandbox = reuse_sandbox
+        self.bytecode_cache = bytecode_cache
+        self.watch_files = watch_files
+        self.test_impact = test_impact
+        self._test_impact: ImpactIndex | None = None
+        self.certification_file = certification_file
+        self._dir_tree: str | None = None
+        self.sandbox_reused = False  # Whether the last reset reused the sandbox.
+        self._sandbox_snapshot: SandboxSnapshot | None = None
+        self._sandbox_pids: list[str] = []
+
+        if self.bytecode_cache:
+            self.terminal.env_vars["PYTHONPYCACHEPREFIX"] = SANDBOX_PYCACHE_DIR
 
         self.workspace = Workspace(self.terminal, logger=self.logger)
         self.dataset = self.load_dataset(problems)
@@ -327,14 +540,108 @@ class RepoEnv(TooledEnv):
         self.terminal.run("git add .debugignore .debugreadonly")
         self.terminal.run("git commit -am 'Add debug-gym ignore and read-only files'")
 
+    def compile_bytecode(self) -> None:
+        """Compile the code of the working directory in parallel into the
+        bytecode cache (see `bytecode_cache`). Later runs still do not write
+        bytecode (`PYTHONDONTWRITEBYTECODE`), so files edited since then are
+        compiled in memory, and Python versions without `PYTHONPYCACHEPREFIX`
+        (before 3.8) never write to the workspace."""
+        self.logger.debug(f"Compiling bytecode into {SANDBOX_PYCACHE_DIR}...")
+        success, output = self.terminal.run(
+            "python -c 'import sys; sys.exit(sys.version_info < (3, 8))' && "
+            f"python -m compileall -q -j0 -x '/[.]git/' {self.working_dir}",
+            timeout=self.run_timeout,
+        )
+        if not success:  # E.g., files with syntax errors, which are skipped.
+            self.logger.debug(f"Bytecode cache not fully compiled:\n{output}")
+
+    def setup_episode(self) -> None:
+        """Setup applied on top of the sandbox, whether it was just set up or
+        reset in place. Override in subclasses for different behavior.
+        Called once at reset."""
+        pass
+
+    @property
+    def sandbox_key(self) -> tuple:
+        """Identifies the sandbox produced by `setup_terminal`. Episodes with the
+        same key can reuse the sandbox of the previous episode.
+        Override in subclasses for different behavior."""
+        return (getattr(self, "task_name", None), getattr(self, "base_image", None))
+
+    def snapshot_sandbox(self) -> None:
+        """Record the post-setup state of the sandbox to reset it in place later."""
+        if not self.reuse_sandbox or isinstance(self.terminal, LocalTerminal):
+            return
+
+        self._sandbox_snapshot = self.workspace.snapshot(
+            self.sandbox_key,
+            restore_paths=self.SANDBOX_RESTORE_PATHS,
+            verify_paths=self.SANDBOX_VERIFY_PATHS,
+        )
+        if not isinstance(self.terminal, SharedDockerTerminal):
+            _, pids = self.terminal.run(
+                "for p in /proc/[0-9]*; do echo ${p#/proc/}; done", raises=True
+            )
+            self._sandbox_pids = pids.split()
+
+    def restore_sandbox(self) -> bool:
+        """Reset the sandbox of the previous episode in place to its post-setup
+        state. Returns False if a new sandbox needs to be set up instead."""
+        snapshot, self._sandbox_snapshot = self._sandbox_snapshot, None
+        if snapshot is None:
+            return False
+
+        if snapshot.key == self.sandbox_key:
+            self.logger.debug(f"Resetting {self.terminal} in place.")
+            self.kill_stray_processes()
+            if self.workspace.restore(snapshot):
+                self._sandbox_snapshot = snapshot
+                return True
+
+        self.logger.debug(f"Cannot reuse {self.terminal}, setting up a new one.")
+        self.terminal.close()
+        return False
+
+    def kill_stray_processes(self) -> None:
+        """Kill the processes started in the sandbox since its setup."""
+        for session in list(self.terminal.sessions):
+            self.terminal.close_shell_session(session)
+
+        if isinstance(self.terminal, SharedDockerTerminal):
+            # Other tasks share the container, only kill this task's processes.
+            self.terminal.kill_tenant_processes()
+            return
+
+        keep = " ".join(self._sandbox_pids)
+        self.terminal.run(
+            f'keep=" {keep} "; for p in /proc/[0-9]*; do pid=${{p#/proc/}}; '
+            'case "$keep" in *" $pid "*) ;; '
+            '*) [ "$pid" != "$$" ] && kill -9 "$pid" 2>/dev/null;; esac; done; true'
+        )
+
     def reset(self, *, options: dict = None):
         """Resets the environment and returns eval as the initial observation."""
         options = options or {}
+        self.reset_options = options
         self.logger.debug("Resetting environment")
         self.setup_task(task_name=options.get("task_name"), options=options)
+        self.sandbox_reused = self.reuse_sandbox and self.restore_sandbox()
+        if isinstance(self.terminal, SharedDockerTerminal):
+            # Only a new sandbox starts from an empty tenant directory.
+            self.terminal.keep_tenant_dir = self.sandbox_reused
         self.setup_workspace()
-        self.setup_terminal()
+        if not self.sandbox_reused:
+            self.setup_terminal()
+            if self.bytecode_cache:
+                self.compile_bytecode()
+            self.snapshot_sandbox()
+        self.setup_episode()
         self._reset_env_state()
+        self._dir_tree = None
+        if self.watch_files and not self.workspace.watch_files():
+            self.logger.warning("Cannot watch files in the sandbox, not watching.")
+        if self.test_impact:
+            self.record_test_impact()
 
         # Notify all tools that the environment is reset and get their observations
         self.queue_event(Event.ENV_RESET, source="env")
@@ -356,7 +663,7 @@ class RepoEnv(TooledEnv):
             eval_observation=(
                 Observation("env", self.last_eval.output) if self.last_eval else None
             ),
-            dir_tree=self.workspace.display_files(self.dir_tree_depth),
+            dir_tree=self.display_files(),
             current_breakpoints=self.current_breakpoints(),
             action_reasoning=None,
             action_content=None,
@@ -395,14 +702,176 @@ class RepoEnv(TooledEnv):
         Override in subclasses for different behavior."""
         return self.calculate_resolved(eval_output)
 
-    def eval(self, **kwargs) -> EvalOutput:
-        """Evaluates the current code using the provided entrypoint.
-        Sets the last_eval and returns it.
+    def failing_tests(self) -> list[str]:
+        """Node ids of the tests that failed in the last eval, parsed from
+        pytest's short test summary. Override in subclasses for different
+        behavior (e.g., tests known to fail)."""
+        if self.last_eval is None:
+            return []
+        tests = PYTEST_FAILED_TEST.findall(self.last_eval.output)
+        return list(dict.fromkeys(tests))  # Unique, in order.
+
+    def targeted_entrypoint(self) -> str:
+        """The entrypoint restricted to the failing tests (see `failing_tests`),
+        e.g., to trace only them. Same as `entrypoint` if it does not run pytest
+        or no test failed."""
+        return select_pytest_tests(self.entrypoint, self.failing_tests())
+
+    def targeted_debug_entrypoint(self) -> str:
+        """The debug entrypoint restricted to the failing tests (see
+        `failing_tests`), so pdb sessions do not run the passing tests first.
+        Same as `debug_entrypoint` if it does not run pytest or no test failed."""
+        return select_pytest_tests(self.debug_entrypoint, self.failing_tests())
+
+    def record_test_impact(self) -> None:
+        """Run the tests once, recording the lines of code executed by each of
+        them in the sandbox (see `test_impact`)."""
+        self._test_impact = None
+        script = self.workspace.upload_script(IMPACT_SCRIPT)
+        try:
+            command = trace_entrypoint(
+                self.entrypoint, script, str(self.working_dir), IMPACT_INDEX_FILE
+            )
+        except ValueError as e:
+            self.logger.warning(f"Cannot record the test impact: {e}")
+            return
+
+        # Failing tests are expected.
+        _, output = self.terminal.run(
+            f"rm -f {IMPACT_INDEX_FILE}; {command}", timeout=self.run_timeout
+        )
+        success, index = self.terminal.run(f"cat {IMPACT_INDEX_FILE}")
+        if not success:
+            self.logger.warning(f"Failed to record the test impact:\n{output}")
+            return
+        self._test_impact = ImpactIndex.from_index(json.loads(index))
+
+    def impacted_tests_entrypoint(self) -> tuple[str, list[str]]:
+        """The entrypoint deselecting the tests not impacted by the changes
+        since reset (see `test_impact`), and the deselected tests."""
+        if self._test_impact is None:
+            return self.entrypoint, []
+        success, diff = self.terminal.run(
+            "git diff -U0 --no-color --no-ext-diff HEAD", strip_output=False
+        )
+        if not success:  # E.g., not a git repository.
+            return self.entrypoint, []
+        skipped = self._test_impact.skippable_tests(changed_lines(diff))
+        if not skipped:
+            return self.entrypoint, []
+        options = [f"--deselect {shlex.quote(test)}" for test in skipped]
+        return add_pytest_options(self.entrypoint, options), skipped
+
+    @staticmethod
+    def skipped_tests_message(skipped_tests: list[str]) -> str:
+        if not skipped_tests:
+            return ""
+        listed = skipped_tests[:MAX_LISTED_SKIPPED_TESTS]
+        if len(skipped_tests) > len(listed):
+            listed.append(f"... ({len(skipped_tests) - len(listed)} more)")
+        return (
+            f"\n{len(skipped_tests)} tests not impacted by the changes were not run"
+            " (they passed before the changes):\n" + "\n".join(listed)
+        )
+
+    def eval(self, impacted_tests_only: bool = False, **kwargs) -> EvalOutput:
+        """Evaluates the current code using the provided entrypoint. If
+        `impacted_tests_only`, the tests not impacted by the changes are not run
+        (see `test_impact`). Sets the last_eval and returns it.
         Override in subclasses for different behavior."""
-        success, output = self.terminal.run(self.entrypoint, timeout=self.run_timeout)
-        self.last_eval = EvalOutput(success, output)
+        entrypoint, skipped_tests = self.entrypoint, []
+        if impacted_tests_only:
+            entrypoint, skipped_tests = self.impacted_tests_entrypoint()
+        success, output = self.terminal.run(entrypoint, timeout=self.run_timeout)
+        output += self.skipped_tests_message(skipped_tests)
+        self.last_eval = EvalOutput(success, output, skipped_tests=skipped_tests)
         return self.last_eval
 
+    def evaluate(self) -> EnvInfo:
+        """Evaluate the current code outside of a step (e.g., to score it), and
+        update the score and infos accordingly."""
+        self.eval()
+        self.max_score = self.calculate_max_score(self.last_eval)
+        self.score = self.calculate_score(self.last_eval)
+        self.terminated = self.calculate_terminated(self.last_eval)
+        self.resolved = self.calculate_resolved(self.last_eval)
+        self.infos = replace(
+            self.infos,
+            eval_observation=Observation("env", self.last_eval.output),
+            score=self.score,
+            max_score=self.max_score,
+            terminated=self.terminated,
+            resolved=self.resolved,
+        )
+        return self.infos
+
+    def cpu_quota(self) -> int:
+        """Number of CPUs available in the sandbox, bounded by its cgroup quota."""
+        _, output = self.terminal.run(
+            "nproc; cat /sys/fs/cgroup/cpu.max 2>/dev/null || true"
+        )
+        lines = output.split("\n")
+        cpus = int(lines[0]) if lines[0].strip().isdigit() else 1
+        if len(lines) > 1 and not lines[1].startswith("max"):
+            quota, period = map(int, lines[1].split())
+            cpus = min(cpus, math.ceil(quota / period))
+        return max(cpus, 1)
+
+    def eval_many(
+        self, patches: list[str], max_workers: int | None = None
+    ) -> list[PatchEval]:
+        """Evaluate candidate patches of the post-setup code (e.g., from
+        `changes`) concurrently, each in its own git worktree of the sandbox, and
+        score them with `calculate_score`. The working directory and the state
+        of the environment are left untouched. At most `max_workers` patches
+        (by default, the CPU quota of the sandbox) are evaluated at once."""
+        if not patches:
+            return []
+        max_workers = min(len(patches), max_workers or self.cpu_quota())
+        with ThreadPoolExecutor(max_workers, "debug-gym-eval") as executor:
+            return list(executor.map(self._eval_in_worktree, patches))
+
+    def _eval_in_worktree(self, patch: str) -> PatchEval:
+        _, worktree = self.terminal.run(
+            "worktree=$(mktemp -d /tmp/debug_gym_worktree.XXXXXX) && "
+            "git worktree add --quiet --detach $worktree HEAD && echo $worktree",
+            raises=True,
+        )
+        worktree = worktree.split("\n")[-1]
+        try:
+            if patch.strip():
+                self.workspace.write_file(f"{worktree}.patch", patch)
+                success, output = self.terminal.run(
+                    f"cd {worktree} && git apply --binary {worktree}.patch"
+                )
+                if not success:
+                    eval_output = EvalOutput(False, f"Cannot apply patch:\n{output}")
+                    return PatchEval(patch, eval_output, 0)
+
+            # Untracked files, ignored (e.g., virtual environments or build
+            # artifacts) or not (e.g., R2E-Gym's `r2e_tests` link), are not
+            # checked out, link them from the working directory (once per
+            # directory), except the caches which are specific to each copy of
+            # the code.
+            self.terminal.run(
+                "git ls-files --others --directory | "
+                "grep -v -e __pycache__ -e .pytest_cache | while read -r path; do "
+                f'path=${{path%/}}; test -e "{worktree}/$path" || '
+                f'{{ mkdir -p "$(dirname "{worktree}/$path")" && '
+                f'ln -s "$PWD/$path" "{worktree}/$path"; }}; done',
+                raises=True,
+            )
+            env = copy.copy(self)
+            env.terminal = WorktreeTerminal(self.terminal, worktree)
+            env.close = lambda: None  # The sandbox is this environment's.
+            eval_output = env.eval()
+            return PatchEval(patch, eval_output, env.calculate_score(eval_output))
+        finally:
+            self.terminal.run(
+                f"git worktree remove --force {worktree}; "
+                f"rm -rf {worktree} {worktree}.patch; git worktree prune"
+            )
+
     def has_breakpoint(self, file_path: str, line_number: int) -> bool:
         """Check if a breakpoint is set at the given file and line number."""
         key = f"{self.workspace.resolve_path(file_path)}|||{line_number}"
@@ -431,11 +900,93 @@ class RepoEnv(TooledEnv):
         success, output = self.terminal.run("git diff", strip_output=False, raises=True)
         return output
 
+    @staticmethod
+    def _changes_command(pipe: str = "") -> str:
+        """Command diffing the working directory since setup (see `changes`),
+        piping the diff to `pipe` if given."""
+        return (
+            'index=$(mktemp) && cp -p "$(git rev-parse --git-path index)" $index && '
+            "GIT_INDEX_FILE=$index git -c core.excludesFile=.debugignore "
+            f"add --intent-to-add . && GIT_INDEX_FILE=$index git diff --binary{pipe}; "
+            'status=$?; rm -f "$index"; (exit $status)'
+        )
+
+    @property
+    def changes(self) -> str:
+        """Binary diff of the working directory since setup, including the files
+        created since then (unlike `patch`) except the ignored ones. Uses a copy
+        of the git index to leave the repository untouched."""
+        success, output = self.terminal.run(
+            self._changes_command(), strip_output=False, raises=True
+        )
+        return output
+
+    @property
+    def changes_digest(self) -> str:
+        """Hash of `changes`, computed in the sandbox so the diff itself is not
+        transferred, e.g., to tell whether the workspace changed."""
+        _, output = self.terminal.run(
+            self._changes_command(" | git hash-object --stdin"), raises=True
+        )
+        return output
+
+    def apply_patch(self, patch: str) -> None:
+        """Apply a patch (e.g., from `changes`) to the working directory."""
+        if not patch.strip():
+            return
+        # A file of its own, since environments can share the sandbox.
+        _, patch_file = self.terminal.run(
+            f"mkdir -p {SANDBOX_SCRIPTS_DIR} "
+            f"&& mktemp {SANDBOX_SCRIPTS_DIR}/changes.XXXXXXXX",
+            raises=True,
+        )
+        try:
+            self.workspace.write_file(patch_file, patch)
+            self.terminal.run(f"git apply --binary {patch_file}", raises=True)
+        finally:
+            self.terminal.run(f"rm -f {patch_file}")
+
+    def fork_into(
+        self, env: "RepoEnv", reset: bool = True, changes: str | None = None
+    ) -> EnvInfo:
+        """Bring `env` (with the same tools) to the state of this environment:
+        same task, code changes, breakpoints and score. Interactive state, like
+        a running pdb session, is not copied. If `reset` is False, `env` must
+        already be reset with the same options as this environment. `changes`
+        can be given when forking into several environments at once, to get
+        them from this environment only once."""
+        if reset:
+            env.reset(options=self.reset_options)
+        env.apply_patch(self.changes if changes is None else changes)
+        env.queue_file_changes()
+        env.process_events()
+        env.current_breakpoints_state = dict(self.current_breakpoints_state)
+        env.rewrite_counter = self.rewrite_counter
+        env.last_eval = self.last_eval
+        env.max_score = self.max_score
+        env.score = self.score
+        env.terminated = self.terminated
+        env.resolved = self.resolved
+        env.infos = replace(
+            self.infos,
+            dir_tree=env.display_files(),
+            current_breakpoints=env.current_breakpoints(),
+            rewrite_counter=env.rewrite_counter,
+            tools=env.tools,
+        )
+        return env.infos
+
     def apply_gold_patch(self):
         raise NotImplementedError(
             f"apply_gold_patch is not implemented for {self.__class__.__name__}."
         )
 
+    def score_last_eval(self) -> None:
+        self.max_score = self.calculate_max_score(self.last_eval)
+        self.score = self.calculate_score(self.last_eval)
+        self.terminated = self.calculate_terminated(self.last_eval)
+        self.resolved = self.calculate_resolved(self.last_eval)
+
     def step(
         self,
         action_tool_call: ToolCall,
@@ -466,16 +1017,18 @@ class RepoEnv(TooledEnv):
                 self.logger.debug(error_message)
 
         # Process any events that were queued during tool execution
+        self.queue_file_changes()
         self.all_observations = self.process_events()
         # prepend step_observation to all_observations
         self.all_observations.insert(0, self.step_observation)
 
         # Calculate score and done based on the last eval output
         if self.last_eval:
-            self.max_score = self.calculate_max_score(self.last_eval)
-            self.score = self.calculate_score(self.last_eval)
-            self.terminated = self.calculate_terminated(self.last_eval)
-            self.resolved = self.calculate_resolved(self.last_eval)
+            self.score_last_eval()
+            if self.last_eval.skipped_tests and (self.resolved or self.terminated):
+                # Only end the episode on a run of all the tests (see `test_impact`).
+                self.eval()
+                self.score_last_eval()
 
         self.infos = EnvInfo(
             step_observation=self.step_observation,
@@ -483,7 +1036,7 @@ class RepoEnv(TooledEnv):
             eval_observation=(
                 Observation("env", self.last_eval.output) if self.last_eval else None
             ),
-            dir_tree=self.workspace.display_files(self.dir_tree_depth),
+            dir_tree=self.display_files(),
             current_breakpoints=self.current_breakpoints(),
             action_reasoning=action_reasoning,
             action_content=action_content,
@@ -499,6 +1052,23 @@ class RepoEnv(TooledEnv):
 
         return self.infos
 
+    def display_files(self) -> str:
+        """Listing of the working directory. When watching files, it is only
+        listed again after files are created or deleted."""
+        if self._dir_tree is None or not self.workspace.watching_files:
+            self._dir_tree = self.workspace.display_files(self.dir_tree_depth)
+        return self._dir_tree
+
+    def queue_file_changes(self) -> None:
+        """Queue a `FILE_CHANGE` event with the files changed since the last
+        call, if files are watched (see `watch_files`)."""
+        changes = self.workspace.poll_file_changes()
+        if not changes:
+            return
+        if any(kind != "modified" for kind in changes.values()):
+            self._dir_tree = None
+        self.queue_event(Event.FILE_CHANGE, source="env", changes=changes)
+
     def post_process_event(self, event: Event, source, kwargs, observations):
         """Post-process the event after it has been handled by the tools."""
         if event in (Event.REWRITE_SUCCESS, Event.REWRITE_FAIL):
@@ -514,3 +1084,12 @@ class RepoEnv(TooledEnv):
 
     def load_dataset(self, problems: str | list[str] | None = None):
         return {"custom": None}
+
+    def uncertified_tasks(self) -> list[str]:
+        """Tasks found broken or flaky by the certification of the dataset, to
+        exclude when loading it (see `certification_file`)."""
+        if not self.certification_file:
+            return []
+        tasks = Certification.load(self.certification_file).uncertified_tasks()
+        self.logger.debug(f"Excluding {len(tasks)} uncertified tasks: {tasks}")
+        return tasks
@@ -1,5 +1,6 @@
 import json
 import re
+import shlex
 from importlib.resources import files as importlib_files
 from pathlib import Path
 
@@ -11,10 +12,12 @@ from datasets import load_from_disk
 from debug_gym.constants import DEBUG_GYM_CACHE_DIR
 from debug_gym.gym.entities import EvalOutput
 from debug_gym.gym.envs.env import RepoEnv
+from debug_gym.gym.scripts.early_exit_eval import TRUNCATED_MARKER
 from debug_gym.gym.terminals.docker import DockerTerminal
 from debug_gym.gym.terminals.kubernetes import KubernetesTerminal
 from debug_gym.gym.terminals.terminal import Terminal
 from debug_gym.gym.utils import filter_problems
+from debug_gym.gym.workspace import SANDBOX_SCRIPTS_DIR
 
 
 def decolor_dict_keys(key):
@@ -62,6 +65,12 @@ def parse_log_pytest(log: str | None) -> dict[str, str]:
 class R2EGymEnv(RepoEnv):
     CACHE = DEBUG_GYM_CACHE_DIR / "r2e-gym"
     CONFIG = importlib_files("debug_gym") / "gym" / "envs" / "configs" / "r2egym.yaml"
+    SANDBOX_RESTORE_PATHS = [
+        "/root/.venv",
+        "/root/.local/bin",
+        "/root/r2e_tests",
+        "/root/run_tests.sh",
+    ]
 
     def __init__(
         self,
@@ -69,8 +78,15 @@ class R2EGymEnv(RepoEnv):
         dataset_revision: str = "8d3163011f01f9393bb3dc7700497a79a8686ae5",
         split: str = "train",
         terminal: Terminal | None = None,
+        early_exit_eval: bool = False,
         **kwargs,
     ):
+        """
+        early_exit_eval (bool): If True, pytest-based evaluations are stopped at
+                the first test whose outcome differs from the expected output,
+                since the score is 0 as soon as one test mismatches. The output
+                of such evaluations is truncated.
+        """
         terminal = terminal or DockerTerminal(logger=kwargs.get("logger"))
         if not isinstance(terminal, (DockerTerminal, KubernetesTerminal)):
             raise ValueError(
@@ -81,6 +97,8 @@ class R2EGymEnv(RepoEnv):
         self.dataset_revision = dataset_revision
         self.split = split
         self.session_commands = []
+        self.early_exit_eval = early_exit_eval
+        self._expected_output_file = None
 
         super().__init__(terminal=terminal, **kwargs)
 
@@ -113,6 +131,7 @@ class R2EGymEnv(RepoEnv):
         with open(R2EGymEnv.CONFIG) as f:
             custom_splits = yaml.safe_load(f)
             excluded_ids = custom_splits.get("excluded", [])
+            excluded_ids += self.uncertified_tasks()
 
         dataset = {
             id.split("/", 1)[-1]: i for i, id in enumerate(self.ds["docker_image"])
@@ -125,7 +144,16 @@ class R2EGymEnv(RepoEnv):
             f"Loaded {len(dataset)} tasks accross {len(image_names)} Docker images from {self.dataset_id}."
         )
 
-        if not isinstance(self.terminal, KubernetesTerminal):
+        if isinstance(self.terminal, KubernetesTerminal):
+            # Warm the images on the cluster's nodes, in the order tasks are run.
+            self.terminal.prepull_images(
+                list(
+                    dict.fromkeys(
+                        self.ds[dataset[id]]["docker_image"] for id in sorted(dataset)
+                    )
+                )
+            )
+        else:
             # Download all images needed for R2E-Gym.
             client = docker.from_env()
 
@@ -164,6 +192,7 @@ class R2EGymEnv(RepoEnv):
         }
 
         self.commit_hash = self.ds_row["commit_hash"]
+        self._expected_output_file = None
 
         self.entrypoint = "python -m pytest -W ignore -rA r2e_tests"
         if self.package_name == "pillow":
@@ -195,8 +224,9 @@ class R2EGymEnv(RepoEnv):
         self.git_apply_cmd = f"git apply -"
 
     def setup_workspace(self):
-        self.terminal.task_name = self.task_name
-        self.terminal.base_image = self.base_image
+        if not self.sandbox_reused:
+            self.terminal.task_name = self.task_name
+            self.terminal.base_image = self.base_image
         # Ignore hidden files (dotfiles) and any contents under hidden directories
         self.workspace.reset(
             ignore_patterns=["**/.*"], readonly_patterns=["r2e_tests/**"]
@@ -206,9 +236,6 @@ class R2EGymEnv(RepoEnv):
     def setup_terminal(self):
         self.logger.debug(f"Configuring {self.terminal}...")
 
-        # Install tree for listdir.
-        self.terminal.run("apt update && apt install -y tree")
-
         # Follow r2egym setup for non- swe-bench/swe-smith tasks.
         # Ref: https://github.com/R2E-Gym/R2E-Gym/blob/main/src/r2egym/agenthub/runtime/docker.py#L545
 
@@ -277,19 +304,46 @@ class R2EGymEnv(RepoEnv):
         """Evaluates the current code using the provided entrypoint.
         Sets the last_eval and returns it.
         Override in subclasses for different behavior."""
-        success, output = self.terminal.run(self.entrypoint, timeout=self.run_timeout)
+        entrypoint = self.entrypoint
+        early_exit = self.early_exit_eval and "-m pytest" in entrypoint
+        if early_exit:
+            entrypoint = self.early_exit_entrypoint()
+
+        success, output = self.terminal.run(entrypoint, timeout=self.run_timeout)
 
         # success, output = self.terminal.run(f"bash {self.alt_path}/run_tests.sh", timeout=self.run_timeout)
         # Remove ANSI escape codes and \r characters
         output = re.sub(r"\x1b\[[0-9;]*m|\r", "", output)
-        self.last_eval = EvalOutput(success, output)
+        truncated = early_exit and TRUNCATED_MARKER in output
+        self.last_eval = EvalOutput(success, output, truncated=truncated)
         return self.last_eval
 
+    def early_exit_entrypoint(self) -> str:
+        """Wrap the pytest entrypoint so it is stopped at the first test whose
+        outcome differs from the expected output (see `early_exit_eval.py`)."""
+        script_path = self.workspace.upload_script("early_exit_eval.py")
+        if self._expected_output_file is None:
+            self._expected_output_file = f"{SANDBOX_SCRIPTS_DIR}/expected_output.json"
+            self.workspace.write_file(
+                self._expected_output_file, json.dumps(self.expected_output)
+            )
+
+        # Verbose mode reports each test outcome as soon as the test finishes.
+        entrypoint = self.entrypoint.replace("-m pytest", "-m pytest -v", 1)
+        return (
+            f"python {script_path} {self._expected_output_file} "
+            f"{shlex.quote(entrypoint)}"
+        )
+
     def calculate_max_score(self, eval_output: EvalOutput) -> int:
         # return len([1 for k, v in self.expected_output.items() if v])
         return 1
 
     def calculate_score(self, eval_output: EvalOutput) -> int:
+        if eval_output.truncated:
+            # Stopped at the first test not matching the expected output.
+            return 0
+
         parse = parse_log_pytest(eval_output.output)
         parse = decolor_dict_keys(parse)
         parse = {k.split(" - ")[0]: parse[k] for k in sorted(parse.keys())}
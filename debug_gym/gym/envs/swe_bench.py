@@ -18,6 +18,8 @@ from debug_gym.gym.utils import filter_problems
 
 class SWEBenchEnv(RepoEnv):
     CACHE = DEBUG_GYM_CACHE_DIR / "swe-bench"
+    SANDBOX_RESTORE_PATHS = ["/etc/hosts"]
+    SANDBOX_VERIFY_PATHS = ["/opt/miniconda3/envs/testbed"]
 
     def __init__(
         self,
@@ -49,7 +51,9 @@ class SWEBenchEnv(RepoEnv):
             self.dataset_id, revision=self.dataset_revision
         )[self.split]
         dataset = {id: i for i, id in enumerate(self.ds["instance_id"])}
-        problems = filter_problems(dataset, problems)
+        problems = filter_problems(
+            dataset, problems, excluded_ids=self.uncertified_tasks()
+        )
         dataset = {id: i for id, i in dataset.items() if id in problems}
 
         instance_ids = [self.ds[dataset[id]]["instance_id"] for id in dataset]
@@ -57,7 +61,15 @@ class SWEBenchEnv(RepoEnv):
             f"sweb.eval.x86_64.{id.replace('__', '_1776_')}" for id in instance_ids
         )
 
-        if not isinstance(self.terminal, KubernetesTerminal):
+        if isinstance(self.terminal, KubernetesTerminal):
+            # Warm the images on the cluster's nodes, in the order tasks are run.
+            self.terminal.prepull_images(
+                [
+                    f"swebench/sweb.eval.x86_64.{id.replace('__', '_1776_')}:latest"
+                    for id in sorted(dataset)
+                ]
+            )
+        else:
             # Download all images needed for SWE-Bench.
             client = docker.from_env()
             tagged_image_names = set(f"swebench/{name}:latest" for name in image_names)
@@ -134,8 +146,9 @@ class SWEBenchEnv(RepoEnv):
         self.git_apply_cmd = f"git apply -"
 
     def setup_workspace(self):
-        self.terminal.task_name = self.task_name
-        self.terminal.base_image = self.base_image
+        if not self.sandbox_reused:
+            self.terminal.task_name = self.task_name
+            self.terminal.base_image = self.base_image
         # Ignore hidden files (dotfiles) and any contents under hidden directories
         self.workspace.reset(
             ignore_patterns=["**/.*"], readonly_patterns=self.test_directives
@@ -145,9 +158,6 @@ class SWEBenchEnv(RepoEnv):
     def setup_terminal(self):
         self.logger.debug(f"Configuring {self.terminal}...")
 
-        # Install tree for listdir.
-        self.terminal.run("apt update && apt install -y tree")
-
         self.terminal.session_commands.append("source /opt/miniconda3/bin/activate")
         self.terminal.session_commands.append("conda activate testbed")
 
@@ -196,6 +206,11 @@ class SWEBenchEnv(RepoEnv):
 
         return self.last_eval
 
+    def failing_tests(self) -> list[str]:
+        # The failing tests come from the test patch, which is only applied
+        # during evals, so pdb sessions run all the test directives.
+        return []
+
     def calculate_max_score(self, eval_output: EvalOutput) -> int:
         return len(self.fail_to_pass)
 
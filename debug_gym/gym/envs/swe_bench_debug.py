@@ -11,6 +11,10 @@ class SWEBenchDebugEnv(SWEBenchEnv):
         self.terminal.run(f"git apply - <<'EOF'\n{self.test_patch}\nEOF")
         self.terminal.run(f"git commit -am 'Applying test patch for {self.task_name}'")
 
+    def failing_tests(self) -> list[str]:
+        # The test patch is applied, pdb sessions can run the tests to fix.
+        return self.fail_to_pass
+
     def eval(self, **kwargs) -> EvalOutput:
         success, output = self.terminal.run(self.entrypoint, timeout=self.run_timeout)
         self.last_eval = EvalOutput(success, output)
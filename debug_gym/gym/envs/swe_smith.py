@@ -61,6 +61,7 @@ class SWESmithEnv(SWEBenchEnv):
         with open(SWESmithEnv.CONFIG) as f:
             custom_splits = yaml.safe_load(f)
             excluded_ids = custom_splits.get("excluded", [])
+            excluded_ids += self.uncertified_tasks()
 
         dataset = {id: i for i, id in enumerate(self.ds["instance_id"])}
         problems = filter_problems(dataset, problems, custom_splits, excluded_ids)
@@ -71,7 +72,17 @@ class SWESmithEnv(SWEBenchEnv):
             f"Loaded {len(dataset)} tasks accross {len(image_names)} Docker images from {self.dataset_id}."
         )
 
-        if not isinstance(self.terminal, KubernetesTerminal):
+        if isinstance(self.terminal, KubernetesTerminal):
+            # Warm the images on the cluster's nodes, in the order tasks are run.
+            self.terminal.prepull_images(
+                list(
+                    dict.fromkeys(
+                        f"{DOCKER_ORG}/{self.ds[dataset[id]]['image_name']}:{TAG}"
+                        for id in sorted(dataset)
+                    )
+                )
+            )
+        else:
             # Download all images needed for SWE-Smith.
             client = docker.from_env()
             tagged_image_names = set(
@@ -181,13 +192,21 @@ class SWESmithEnv(SWEBenchEnv):
         self.git_apply_cmd = f"git apply --reverse -"
         self.gold_patch = self.bug_patch
 
-    def setup_terminal(self):
-        super().setup_terminal()
+    @property
+    def sandbox_key(self) -> tuple:
+        # Tasks built on the same image only differ by their bug patch,
+        # which is applied on top of the sandbox by `setup_episode`.
+        return (self.base_image,)
 
+    def setup_episode(self):
         # Apply bug patch.
         self.terminal.run(f"git apply - <<'EOF'\n{self.bug_patch}\nEOF", raises=True)
         self.terminal.run(f"git commit -am 'Applying bug patch for {self.task_name}'")
 
+    def failing_tests(self) -> list[str]:
+        # The tests broken by the bug patch, whether or not an eval ran.
+        return self.fail_to_pass
+
     def calculate_score(self, eval_output: EvalOutput) -> int:
         test_status_map = self.log_parser(eval_output.output)
         score = sum(
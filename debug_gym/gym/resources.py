@@ -0,0 +1,113 @@
+"""Registry of the resources to release when the process exits (sandboxes,
+shell sessions, temporary directories), instead of one `atexit` hook each.
+
+Resources are registered with the bound method releasing them, which is only
+referenced weakly: registering an object does not keep it alive, and objects
+garbage collected leave the registry. Resources unregister themselves once
+released (e.g., by `close`). At exit, the resources still alive are released
+concurrently. `live_counts` gives the number of live resources by kind, e.g. to
+monitor leaks in long-lived processes.
+"""
+
+import atexit
+import os
+import queue
+import threading
+import weakref
+from collections import Counter
+from typing import Callable
+
+from debug_gym.logger import DebugGymLogger
+
+
+class ResourceRegistry:
+
+    def __init__(self, max_workers: int = 8, logger: DebugGymLogger | None = None):
+        self.max_workers = max_workers
+        self.logger = logger or DebugGymLogger("debug-gym")
+        # Reentrant, since garbage collection can run the weakref callbacks
+        # while the lock is held.
+        self._lock = threading.RLock()
+        self._resources: dict[tuple, tuple[str, weakref.WeakMethod]] = {}
+        self._jobs = queue.SimpleQueue()
+        self._workers_pid = None  # Process running the workers (not forks).
+
+    @staticmethod
+    def _key(release: Callable) -> tuple:
+        return (id(release.__self__), release.__func__.__name__)
+
+    def register(self, release: Callable, kind: str) -> None:
+        """Track a resource of `kind` (e.g., "container"), released by calling
+        the bound method `release`. Registering it again is a no-op."""
+        key = self._key(release)
+
+        def discard(ref):
+            with self._lock:
+                if self._resources.get(key, (None, None))[1] is ref:
+                    del self._resources[key]
+
+        with self._lock:
+            self._resources[key] = (kind, weakref.WeakMethod(release, discard))
+            self._start_workers()
+
+    def unregister(self, release: Callable) -> None:
+        """Stop tracking the resource released by `release`, once released."""
+        with self._lock:
+            self._resources.pop(self._key(release), None)
+
+    def live_counts(self) -> dict[str, int]:
+        """Number of live resources by kind."""
+        with self._lock:
+            resources = list(self._resources.values())
+        return dict(Counter(kind for kind, ref in resources if ref() is not None))
+
+    def _start_workers(self) -> None:
+        """Start the threads releasing the resources ahead of time, since new
+        threads cannot be started once the interpreter is exiting (Python
+        3.12+). They wait for resources to release in the meantime."""
+        if self._workers_pid == os.getpid():
+            return
+
+        self._workers_pid = os.getpid()
+        self._jobs = queue.SimpleQueue()
+        for _ in range(self.max_workers):
+            threading.Thread(
+                target=self._work,
+                args=(self._jobs,),
+                name="debug-gym-release",
+                daemon=True,
+            ).start()
+
+    def _work(self, jobs: queue.SimpleQueue) -> None:
+        while True:
+            kind, release, done = jobs.get()
+            self._release(kind, release)
+            done.release()
+
+    def _release(self, kind: str, release: Callable) -> None:
+        try:
+            release()
+        except Exception as e:
+            self.logger.debug(f"Failed to release a {kind}: {e!r}")
+
+    def release_all(self) -> None:
+        """Release all the live resources concurrently."""
+        with self._lock:
+            resources, self._resources = self._resources, {}
+            has_workers = self._workers_pid == os.getpid()
+        releases = [(kind, ref()) for kind, ref in resources.values()]
+        releases = [(kind, release) for kind, release in releases if release]
+        if not has_workers:  # E.g., a fork which registered nothing.
+            for kind, release in releases:
+                self._release(kind, release)
+            return
+
+        done = threading.Semaphore(0)
+        for kind, release in releases:
+            self._jobs.put((kind, release, done))
+        for _ in releases:
+            done.acquire()
+
+
+RESOURCES = ResourceRegistry()
+atexit.register(RESOURCES.release_all)
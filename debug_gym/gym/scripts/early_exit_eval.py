@@ -0,0 +1,74 @@
+"""Runs a pytest command inside the sandbox, streaming its output, and stops it at
+the first test whose outcome differs from the expected one.
+
+Usage: python early_exit_eval.py EXPECTED_OUTPUT_JSON COMMAND
+
+EXPECTED_OUTPUT_JSON maps test names (e.g. `TestClass.test_name`) to their
+expected status (PASSED, FAILED or ERROR). COMMAND must run pytest verbosely
+(-v) so each outcome is reported as soon as the test finishes.
+
+This script is copied into the sandbox and only relies on the standard library.
+"""
+
+import json
+import os
+import re
+import signal
+import subprocess
+import sys
+
+TRUNCATED_MARKER = "[debug-gym] Evaluation stopped early"
+ANSI_ESCAPE = re.compile(r"\x1b\[[0-9;]*m")
+TEST_OUTCOME = re.compile(r"^(?P<nodeid>\S+::.+?) (?P<status>PASSED|FAILED|ERROR)\b")
+
+
+def parse_outcome(line):
+    """Returns (test name, status) if the line reports a test outcome."""
+    match = TEST_OUTCOME.match(ANSI_ESCAPE.sub("", line).strip())
+    if match is None:
+        return None
+    # Same naming as the keys of R2E-Gym's expected output.
+    test_name = ".".join(match.group("nodeid").split("::")[1:])
+    return test_name, match.group("status")
+
+
+def main(expected_output_file, command):
+    with open(expected_output_file) as f:
+        expected_output = json.load(f)
+
+    process = subprocess.Popen(
+        ["/bin/bash", "-c", command],
+        stdout=subprocess.PIPE,
+        stderr=subprocess.STDOUT,
+        start_new_session=True,  # So all test processes can be killed at once.
+    )
+    # A test can report several outcomes, e.g. PASSED then ERROR in teardown,
+    # and the last one counts (as when scoring). So the outcome of a test is
+    # only checked once the next test reports one.
+    pending = None
+    for line in iter(process.stdout.readline, b""):
+        sys.stdout.buffer.write(line)
+        sys.stdout.buffer.flush()
+
+        outcome = parse_outcome(line.decode(errors="replace"))
+        if outcome is None:
+            continue
+        if pending is not None and pending[0] != outcome[0]:
+            test_name, status = pending
+            expected = expected_output.get(test_name)
+            if status != expected:
+                os.killpg(process.pid, signal.SIGKILL)
+                process.wait()
+                sys.stdout.write(
+                    "\n{}: `{}` {} (expected {}).\n".format(
+                        TRUNCATED_MARKER, test_name, status, expected or "no such test"
+                    )
+                )
+                return 1
+        pending = outcome
+
+    return process.wait()
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1], sys.argv[2]))
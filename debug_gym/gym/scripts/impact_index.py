@@ -0,0 +1,167 @@
+"""Runs a pytest command once, recording the lines of code executed by each test,
+and writes a test impact index as JSON.
+
+Usage: python impact_index.py ROOT INDEX_FILE (-m pytest | PYTEST_SCRIPT) [ARGS...]
+
+Only code living under ROOT is recorded (excluding virtual environments and
+site-packages). The lines executed while a test runs are attributed to it. The
+other ones (imports, collection, fixtures setup and teardown) are shared by all
+tests. The index has the recorded `files` (relative to ROOT), the `shared` lines
+and, for each test node id, its `outcome` (passed, failed or skipped) and
+`lines`. Lines are stored per file index as ranges, e.g. {"0": "1-4,7"}.
+Uses `sys.monitoring` when available (Python 3.12+), `sys.settrace` otherwise.
+
+This script is copied into the sandbox and only relies on the standard library
+and pytest.
+"""
+
+import json
+import os
+import sys
+import threading
+
+import pytest
+
+EXCLUDED_DIRS = ("site-packages", ".venv", "venv", ".tox", "__pycache__")
+
+
+class Recorder:
+    def __init__(self, root):
+        self.root = os.path.realpath(root) + os.sep
+        self.shared = set()  # (filename, lineno)
+        self.tests = {}  # Node id -> set of (filename, lineno).
+        self.outcomes = {}
+        self.current = self.shared
+        self._traced_files = {}
+
+    def is_traced(self, filename):
+        traced = self._traced_files.get(filename)
+        if traced is None:
+            # Skip code without a source file, e.g. `<frozen os>` or `<string>`.
+            path = os.path.realpath(filename)
+            traced = (
+                not filename.startswith("<")
+                and path.startswith(self.root)
+                and not any(part in EXCLUDED_DIRS for part in path.split(os.sep))
+            )
+            self._traced_files[filename] = traced
+        return traced
+
+    def switch(self, lines):
+        """Attribute the lines executed from now on to `lines`."""
+        self.current = lines
+        if hasattr(sys, "monitoring"):
+            # Lines are only reported once until events are restarted.
+            sys.monitoring.restart_events()
+
+    @pytest.hookimpl(tryfirst=True)
+    def pytest_runtest_call(self, item):
+        self.switch(self.tests.setdefault(item.nodeid, set()))
+
+    @pytest.hookimpl(tryfirst=True)
+    def pytest_runtest_teardown(self, item):
+        self.switch(self.shared)
+
+    def pytest_runtest_logreport(self, report):
+        outcome = self.outcomes.get(report.nodeid, "passed")
+        if report.failed:
+            outcome = "failed"
+        elif report.skipped and outcome == "passed":
+            outcome = "skipped"
+        self.outcomes[report.nodeid] = outcome
+
+    def start(self):
+        if hasattr(sys, "monitoring"):
+            self._start_monitoring()
+        else:
+            threading.settrace(self._trace_call)
+            sys.settrace(self._trace_call)
+
+    def stop(self):
+        if hasattr(sys, "monitoring"):
+            sys.monitoring.set_events(self._tool_id, 0)
+            sys.monitoring.free_tool_id(self._tool_id)
+        else:
+            sys.settrace(None)
+            threading.settrace(None)
+
+    def _start_monitoring(self):
+        monitoring = sys.monitoring
+        # The coverage tool id may already be used, e.g. by pytest-cov.
+        self._tool_id = next(i for i in range(6) if monitoring.get_tool(i) is None)
+
+        def line(code, lineno):
+            if self.is_traced(code.co_filename):
+                self.current.add((code.co_filename, lineno))
+            return monitoring.DISABLE
+
+        monitoring.use_tool_id(self._tool_id, "debug-gym-impact")
+        monitoring.register_callback(self._tool_id, monitoring.events.LINE, line)
+        monitoring.set_events(self._tool_id, monitoring.events.LINE)
+
+    def _trace_call(self, frame, event, arg):
+        if event != "call" or not self.is_traced(frame.f_code.co_filename):
+            return None
+        return self._trace_local
+
+    def _trace_local(self, frame, event, arg):
+        if event == "line":
+            self.current.add((frame.f_code.co_filename, frame.f_lineno))
+        return self._trace_local
+
+    def index(self):
+        files = {}  # Relative path -> file index.
+
+        def compact(lines):
+            by_file = {}
+            for filename, lineno in lines:
+                path = os.path.relpath(os.path.realpath(filename), self.root)
+                key = str(files.setdefault(path, len(files)))
+                by_file.setdefault(key, []).append(lineno)
+            return {key: to_ranges(linenos) for key, linenos in by_file.items()}
+
+        shared = compact(self.shared)
+        tests = {
+            nodeid: {"outcome": outcome, "lines": compact(self.tests.get(nodeid, ()))}
+            for nodeid, outcome in self.outcomes.items()
+        }
+        return {"files": list(files), "shared": shared, "tests": tests}
+
+
+def to_ranges(linenos):
+    """[1, 2, 3, 7] -> "1-3,7" """
+    ranges = []
+    for lineno in sorted(set(linenos)):
+        if ranges and ranges[-1][1] == lineno - 1:
+            ranges[-1][1] = lineno
+        else:
+            ranges.append([lineno, lineno])
+    return ",".join(
+        str(start) if start == end else "{}-{}".format(start, end)
+        for start, end in ranges
+    )
+
+
+def main(root, index_file, args):
+    if args[0] == "-m":
+        if args[1] != "pytest":
+            raise SystemExit("Only pytest commands are supported, got -m " + args[1])
+        sys.path[0] = os.getcwd()
+        pytest_args = args[2:]
+    else:
+        sys.path[0] = os.path.dirname(os.path.abspath(args[0]))
+        pytest_args = args[1:]
+
+    recorder = Recorder(root)
+    recorder.start()
+    try:
+        exit_code = pytest.main(pytest_args, plugins=[recorder])
+    finally:
+        recorder.stop()
+        with open(index_file, "w") as f:
+            json.dump(recorder.index(), f, separators=(",", ":"))
+    return exit_code
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1], sys.argv[2], sys.argv[3:]))
@@ -0,0 +1,211 @@
+"""Runs a Python program once under a lightweight tracer and writes an execution
+index (call edges, per-line hit counts and sampled argument/return values) as JSON.
+
+Usage: python trace_index.py ROOT INDEX_FILE (-m MODULE | -c CODE | SCRIPT) [ARGS...]
+
+Only code living under ROOT is traced (excluding virtual environments and
+site-packages). Functions are identified as `relative/path.py:QualifiedName`.
+Uses `sys.monitoring` when available (Python 3.12+), `sys.settrace` otherwise.
+
+This script is copied into the sandbox and only relies on the standard library.
+"""
+
+import json
+import os
+import reprlib
+import runpy
+import sys
+import threading
+from collections import defaultdict
+
+MAX_SAMPLES = 3  # Number of calls per function whose values are recorded.
+EXTERNAL = "<external>"  # Caller of functions called from untraced code.
+EXCLUDED_DIRS = ("site-packages", ".venv", "venv", ".tox", "__pycache__")
+
+
+class Tracer:
+    def __init__(self, root, max_samples=MAX_SAMPLES):
+        self.root = os.path.realpath(root) + os.sep
+        self.max_samples = max_samples
+        self.calls = defaultdict(int)
+        self.edges = defaultdict(int)
+        self.lines = defaultdict(lambda: defaultdict(int))
+        self.samples = defaultdict(lambda: {"args": [], "returns": []})
+        self.repr = reprlib.Repr()
+        self.repr.maxstring = self.repr.maxother = 80
+        self._traced_files = {}
+        self._busy = False
+
+    def is_traced(self, filename):
+        traced = self._traced_files.get(filename)
+        if traced is None:
+            # Skip code without a source file, e.g. `<frozen os>` or `<string>`.
+            path = os.path.realpath(filename)
+            traced = (
+                not filename.startswith("<")
+                and path.startswith(self.root)
+                and not any(part in EXCLUDED_DIRS for part in path.split(os.sep))
+            )
+            self._traced_files[filename] = traced
+        return traced
+
+    def function_key(self, code):
+        path = os.path.relpath(os.path.realpath(code.co_filename), self.root)
+        return "{}:{}".format(path, getattr(code, "co_qualname", code.co_name))
+
+    def safe_repr(self, value):
+        try:
+            return self.repr.repr(value)
+        except Exception as e:
+            return "<repr failed: {}>".format(type(e).__name__)
+
+    def on_call(self, frame):
+        if self._busy:
+            return
+        self._busy = True
+        try:
+            code = frame.f_code
+            key = self.function_key(code)
+            self.calls[key] += 1
+
+            # Nearest caller living in the traced code (skipping library frames).
+            caller = frame.f_back
+            while caller is not None and not self.is_traced(caller.f_code.co_filename):
+                caller = caller.f_back
+            caller_key = self.function_key(caller.f_code) if caller else EXTERNAL
+            self.edges[(caller_key, key)] += 1
+
+            samples = self.samples[key]["args"]
+            if len(samples) < self.max_samples:
+                nargs = code.co_argcount + code.co_kwonlyargcount
+                nargs += bool(code.co_flags & 0x04) + bool(code.co_flags & 0x08)
+                samples.append(
+                    {
+                        name: self.safe_repr(frame.f_locals[name])
+                        for name in code.co_varnames[:nargs]
+                        if name in frame.f_locals
+                    }
+                )
+        finally:
+            self._busy = False
+
+    def on_line(self, code, lineno):
+        self.lines[code.co_filename][lineno] += 1
+
+    def on_return(self, code, value):
+        if self._busy:
+            return
+        self._busy = True
+        try:
+            samples = self.samples[self.function_key(code)]["returns"]
+            if len(samples) < self.max_samples:
+                samples.append(self.safe_repr(value))
+        finally:
+            self._busy = False
+
+    def start(self):
+        if hasattr(sys, "monitoring"):
+            self._start_monitoring()
+        else:
+            threading.settrace(self._trace_call)
+            sys.settrace(self._trace_call)
+
+    def stop(self):
+        if hasattr(sys, "monitoring"):
+            sys.monitoring.set_events(sys.monitoring.PROFILER_ID, 0)
+            sys.monitoring.free_tool_id(sys.monitoring.PROFILER_ID)
+        else:
+            sys.settrace(None)
+            threading.settrace(None)
+
+    def _start_monitoring(self):
+        monitoring = sys.monitoring
+        tool_id = monitoring.PROFILER_ID
+        events = monitoring.events
+
+        def py_start(code, offset):
+            if not self.is_traced(code.co_filename):
+                return monitoring.DISABLE
+            self.on_call(sys._getframe(1))
+
+        def line(code, lineno):
+            if not self.is_traced(code.co_filename):
+                return monitoring.DISABLE
+            self.on_line(code, lineno)
+
+        def py_return(code, offset, value):
+            if not self.is_traced(code.co_filename):
+                return monitoring.DISABLE
+            self.on_return(code, value)
+
+        monitoring.use_tool_id(tool_id, "debug-gym-trace")
+        monitoring.register_callback(tool_id, events.PY_START, py_start)
+        monitoring.register_callback(tool_id, events.LINE, line)
+        monitoring.register_callback(tool_id, events.PY_RETURN, py_return)
+        monitoring.set_events(tool_id, events.PY_START | events.LINE | events.PY_RETURN)
+
+    def _trace_call(self, frame, event, arg):
+        if event != "call" or not self.is_traced(frame.f_code.co_filename):
+            return None
+        self.on_call(frame)
+        return self._trace_local
+
+    def _trace_local(self, frame, event, arg):
+        if event == "line":
+            self.on_line(frame.f_code, frame.f_lineno)
+        elif event == "return":
+            self.on_return(frame.f_code, arg)
+        return self._trace_local
+
+    def index(self, command):
+        functions = {}
+        for key, count in self.calls.items():
+            functions[key] = dict(self.samples[key], calls=count)
+        return {
+            "root": self.root,
+            "command": command,
+            "functions": functions,
+            "edges": [
+                [caller, callee, count]
+                for (caller, callee), count in sorted(self.edges.items())
+            ],
+            "lines": {
+                os.path.relpath(os.path.realpath(filename), self.root): {
+                    str(lineno): count for lineno, count in sorted(hits.items())
+                }
+                for filename, hits in self.lines.items()
+            },
+        }
+
+
+def main(root, index_file, args):
+    tracer = Tracer(root)
+    if args[0] == "-m":
+        sys.argv = args[1:]
+        sys.path[0] = os.getcwd()
+        run = lambda: runpy.run_module(args[1], run_name="__main__", alter_sys=True)
+    elif args[0] == "-c":
+        sys.argv = ["-c"] + args[2:]
+        sys.path[0] = ""
+        code = compile(args[1], "<string>", "exec")
+        run = lambda: exec(code, {"__name__": "__main__"})
+    else:
+        sys.argv = args
+        sys.path[0] = os.path.dirname(os.path.abspath(args[0]))
+        run = lambda: runpy.run_path(args[0], run_name="__main__")
+
+    exit_code = 0
+    tracer.start()
+    try:
+        run()
+    except SystemExit as e:
+        exit_code = e.code
+    finally:
+        tracer.stop()
+        with open(index_file, "w") as f:
+            json.dump(tracer.index(" ".join(args)), f)
+    return exit_code
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1], sys.argv[2], sys.argv[3:]))
@@ -0,0 +1,84 @@
+"""Lists a directory tree as JSON, up to a maximum depth, skipping ignored files
+and marking read-only ones.
+
+Usage: python walk_tree.py ROOT MAX_DEPTH FILTERS_FILE
+
+FILTERS_FILE is a JSON file with the `base` directory of the filters, and the
+`ignore` and `readonly` rules as lists of [regex, negation], compiled from
+gitignore-like patterns (see `Workspace.setup_file_filters`). The regexes match
+paths relative to `base`, and later rules override earlier ones. Ignored
+directories are not descended into, symbolic links are followed, and entries
+are sorted naturally (e.g., `file2` before `file10`). Prints the entries of ROOT
+as a list of {"name", "dir", "readonly", "children" (for directories)}.
+
+This script is copied into the sandbox and only relies on the standard library.
+"""
+
+import json
+import os
+import re
+import sys
+
+
+class Filters:
+    def __init__(self, base, ignore, readonly):
+        self.base = base
+        self.ignore = [(re.compile(regex), negation) for regex, negation in ignore]
+        self.readonly = [(re.compile(regex), negation) for regex, negation in readonly]
+
+    @staticmethod
+    def matches(rules, path, is_dir):
+        if not any(negation for _, negation in rules):
+            return any(regex.search(path) for regex, _ in rules)
+        for regex, negation in reversed(rules):
+            # Directory-only negations match directories with a trailing slash.
+            if regex.search(path + "/" if negation and is_dir else path):
+                return not negation
+        return False
+
+
+def natural_key(name):
+    return [int(part) if part.isdigit() else part for part in re.split(r"(\d+)", name)]
+
+
+def walk(path, max_depth, filters, visited):
+    try:
+        names = os.listdir(path)
+    except OSError:
+        return []
+
+    entries = []
+    for name in sorted(names, key=natural_key):
+        child = os.path.join(path, name)
+        is_dir = os.path.isdir(child)
+        relative_path = os.path.relpath(child, filters.base)
+        if Filters.matches(filters.ignore, relative_path, is_dir):
+            continue
+
+        entry = {
+            "name": name,
+            "dir": is_dir,
+            "readonly": Filters.matches(filters.readonly, relative_path, is_dir),
+        }
+        if is_dir:
+            entry["children"] = []
+            real_path = os.path.realpath(child)
+            # Skip the directories already listed higher up (symbolic link loops).
+            if max_depth > 1 and real_path not in visited:
+                entry["children"] = walk(
+                    child, max_depth - 1, filters, visited | {real_path}
+                )
+        entries.append(entry)
+    return entries
+
+
+def main():
+    root, max_depth, filters_file = sys.argv[1], int(sys.argv[2]), sys.argv[3]
+    with open(filters_file) as f:
+        filters = Filters(**json.load(f))
+    entries = walk(root, max_depth, filters, {os.path.realpath(root)})
+    json.dump(entries, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,203 @@
+"""Watches a directory tree with inotify, and reports the changed files on
+request, as lines `KIND<TAB>PATH` where KIND is `created`, `modified` or
+`deleted` and PATH is relative to ROOT. Exits when ROOT is deleted.
+
+Usage: python watch_files.py ROOT FEED_DIR FILTERS_FILE
+
+FILTERS_FILE is the JSON file of `walk_tree.py`: ignored paths are neither
+watched nor reported. Once the watches are set up, `ready PID` is written to
+FEED_DIR/status (or `error MESSAGE` if inotify is not available). Writing a
+token to FEED_DIR/sync requests the changes since the previous request: they
+are written to FEED_DIR/changes, then the token to FEED_DIR/synced. Since the
+events are read in order, the changes made before the request are all there.
+If events were lost (the kernel queue overflowed), `overflow<TAB>.` is reported.
+
+This script is copied into the sandbox and only relies on the standard library.
+"""
+
+import ctypes
+import ctypes.util
+import json
+import os
+import re
+import struct
+import sys
+
+IN_MODIFY = 0x00000002
+IN_CLOSE_WRITE = 0x00000008
+IN_MOVED_FROM = 0x00000040
+IN_MOVED_TO = 0x00000080
+IN_CREATE = 0x00000100
+IN_DELETE = 0x00000200
+IN_DELETE_SELF = 0x00000400
+IN_Q_OVERFLOW = 0x00004000
+IN_IGNORED = 0x00008000
+IN_ISDIR = 0x40000000
+WATCH_MASK = (
+    IN_MODIFY | IN_MOVED_FROM | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_DELETE_SELF
+)
+EVENT_HEADER = struct.Struct("iIII")  # wd, mask, cookie, len
+EXCLUDED_DIRS = (".git", "__pycache__")
+
+
+class IgnoreFilter:
+    """The ignore rules of the filters of `walk_tree.py` (its read-only rules
+    are not needed here), matched the same way."""
+
+    def __init__(self, base, ignore, **kwargs):
+        self.base = base
+        self.rules = [(re.compile(regex), negation) for regex, negation in ignore]
+
+    def ignores(self, path, is_dir):
+        path = os.path.relpath(path, self.base)
+        if not any(negation for _, negation in self.rules):
+            return any(regex.search(path) for regex, _ in self.rules)
+        for regex, negation in reversed(self.rules):
+            # Directory-only negations match directories with a trailing slash.
+            if regex.search(path + "/" if negation and is_dir else path):
+                return not negation
+        return False
+
+
+class Watcher:
+    def __init__(self, root, feed_dir, ignore_filter):
+        self.root = root
+        self.feed_dir = feed_dir
+        self.ignore_filter = ignore_filter
+        self.libc = ctypes.CDLL(ctypes.util.find_library("c"), use_errno=True)
+        self.fd = self.libc.inotify_init()
+        if self.fd < 0:
+            raise OSError(ctypes.get_errno(), "inotify_init failed")
+        self.dirs = {}  # Watch descriptor -> directory.
+        self.changes = {}  # Path -> kind, in order of first change.
+        self.overflow = False
+
+        sync_file = os.path.join(feed_dir, "sync")
+        open(sync_file, "w").close()
+        self.sync_wd = self.libc.inotify_add_watch(
+            self.fd, sync_file.encode(), IN_CLOSE_WRITE
+        )
+        self.watch(root)
+        if self.sync_wd < 0 or root not in self.dirs.values():
+            raise OSError(ctypes.get_errno(), "inotify_add_watch failed")
+
+    def is_watched(self, path, is_dir):
+        if is_dir and os.path.basename(path) in EXCLUDED_DIRS:
+            return False
+        return not self.ignore_filter.ignores(path, is_dir)
+
+    def watch(self, directory, report=False):
+        """Watch `directory` and its subdirectories. If `report`, their content
+        is reported as created (it may predate the watches)."""
+        wd = self.libc.inotify_add_watch(self.fd, directory.encode(), WATCH_MASK)
+        if wd < 0:
+            return
+        self.dirs[wd] = directory
+        try:
+            names = os.listdir(directory)
+        except OSError:
+            return
+        for name in names:
+            path = os.path.join(directory, name)
+            is_dir = os.path.isdir(path) and not os.path.islink(path)
+            if not self.is_watched(path, is_dir):
+                continue
+            if report:
+                self.record("created", path)
+            if is_dir:
+                self.watch(path, report)
+
+    def unwatch(self, directory):
+        for wd, path in list(self.dirs.items()):
+            if path == directory or path.startswith(directory + os.sep):
+                self.libc.inotify_rm_watch(self.fd, wd)
+                del self.dirs[wd]
+
+    def record(self, kind, path):
+        path = os.path.relpath(path, self.root)
+        previous = self.changes.get(path)
+        if previous == "created" and kind == "deleted":
+            del self.changes[path]
+        elif previous == "deleted" and kind == "created":
+            self.changes[path] = "modified"
+        elif previous != "created":
+            self.changes[path] = kind
+
+    def sync(self):
+        with open(os.path.join(self.feed_dir, "sync")) as f:
+            token = f.read()
+        changes = ["{}\t{}\n".format(kind, path) for path, kind in self.changes.items()]
+        if self.overflow:
+            changes.append("overflow\t.\n")
+        with open(os.path.join(self.feed_dir, "changes"), "w") as f:
+            f.write("".join(changes))
+        with open(os.path.join(self.feed_dir, "synced"), "w") as f:
+            f.write(token)
+        self.changes = {}
+        self.overflow = False
+
+    def handle(self, wd, mask, name):
+        """Handle an event. Returns False once the root is deleted."""
+        if mask & IN_Q_OVERFLOW:
+            self.overflow = True
+            return True
+        if wd == self.sync_wd:
+            if mask & IN_CLOSE_WRITE:
+                self.sync()
+            return True
+        directory = self.dirs.get(wd)
+        if directory is None:
+            return True
+        if mask & (IN_IGNORED | IN_DELETE_SELF):
+            if mask & IN_IGNORED:
+                del self.dirs[wd]
+            return directory != self.root
+
+        path = os.path.join(directory, name)
+        is_dir = bool(mask & IN_ISDIR)
+        if not self.is_watched(path, is_dir):
+            return True
+        if mask & (IN_CREATE | IN_MOVED_TO):
+            self.record("created", path)
+            if is_dir:
+                self.watch(path, report=True)
+        elif mask & (IN_DELETE | IN_MOVED_FROM):
+            self.record("deleted", path)
+            if is_dir and mask & IN_MOVED_FROM:
+                self.unwatch(path)  # Watched again under its new path, if any.
+        elif mask & IN_MODIFY and not is_dir:
+            self.record("modified", path)
+        return True
+
+    def run(self):
+        running = True
+        while running:
+            data = os.read(self.fd, 64 * 1024)
+            offset = 0
+            while offset < len(data):
+                wd, mask, _, length = EVENT_HEADER.unpack_from(data, offset)
+                offset += EVENT_HEADER.size
+                name = data[offset : offset + length].rstrip(b"\0")
+                offset += length
+                running = self.handle(wd, mask, name.decode(errors="replace"))
+                if not running:
+                    break
+
+
+def main():
+    root, feed_dir, filters_file = sys.argv[1:4]
+    with open(filters_file) as f:
+        ignore_filter = IgnoreFilter(**json.load(f))
+    try:
+        watcher = Watcher(os.path.abspath(root), feed_dir, ignore_filter)
+    except Exception as e:
+        with open(os.path.join(feed_dir, "status"), "w") as f:
+            f.write("error {}".format(e))
+        sys.exit(1)
+    with open(os.path.join(feed_dir, "status"), "w") as f:
+        f.write("ready {}".format(os.getpid()))
+    watcher.run()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,361 @@
+"""Serves debug-gym environments to other processes (e.g., RL trainers) over a
+local Unix socket, so clients don't need to hold Docker/Kubernetes clients nor
+manage sandboxes themselves.
+
+Messages are framed as a 4-byte big-endian length followed by a pickle. Pickles
+can run arbitrary code when loaded, so the socket is only accessible to its
+owner and must not be exposed to untrusted processes.
+
+Clients open sessions with `reset`, act with `step`, branch a session with
+`fork` and release it with `close`. Each session runs on its own environment,
+taken from a pool of environments reset ahead of time (see `EnvPool`).
+"""
+
+import os
+import pickle
+import socket
+import struct
+import threading
+import uuid
+from concurrent.futures import ThreadPoolExecutor
+from dataclasses import dataclass, replace
+from typing import Any, Callable
+
+from debug_gym.gym.envs.env import EnvInfo, RepoEnv
+from debug_gym.gym.tools.tool import ToolCall
+from debug_gym.logger import DebugGymLogger
+
+HEADER = struct.Struct(">I")
+
+
+def send_message(sock: socket.socket, message: Any) -> None:
+    payload = pickle.dumps(message, protocol=pickle.HIGHEST_PROTOCOL)
+    sock.sendall(HEADER.pack(len(payload)) + payload)
+
+
+def _recv_exactly(sock: socket.socket, size: int) -> bytes:
+    buffer = bytearray()
+    while len(buffer) < size:
+        chunk = sock.recv(size - len(buffer))
+        if not chunk:
+            raise EOFError("Connection closed.")
+        buffer += chunk
+    return bytes(buffer)
+
+
+def recv_message(sock: socket.socket) -> Any:
+    (size,) = HEADER.unpack(_recv_exactly(sock, HEADER.size))
+    return pickle.loads(_recv_exactly(sock, size))
+
+
+@dataclass
+class ToolSpec:
+    """What clients need to know about a tool of the environment, e.g., to
+    define it to an LLM (see `LLM.define_tools`)."""
+
+    name: str
+    description: str
+    arguments: dict
+
+    def __str__(self):
+        args = ", ".join(f"{k}:{v['type'][0]}" for k, v in self.arguments.items())
+        return f"{self.name}({args}): {self.description.split('.')[0].strip()}."
+
+
+def _to_client(infos: EnvInfo) -> EnvInfo:
+    """Replace the tools, which live in the server, by their specification."""
+    tools = [
+        ToolSpec(tool.name, tool.description, tool.arguments) for tool in infos.tools
+    ]
+    return replace(infos, tools=tools)
+
+
+class EnvPool:
+    """Environments reset ahead of time, ready to serve a session.
+
+    `size` environments are warmed at start, cycling over `tasks`. Environments
+    released by finished sessions are reset again on the same task in the
+    background, in place if `reuse_sandbox` is enabled, before going back to the
+    pool. If the pool has no idle environment, a new one is created.
+    """
+
+    def __init__(
+        self,
+        env_factory: Callable[[], RepoEnv],
+        size: int = 4,
+        tasks: list[str] | None = None,
+        logger: DebugGymLogger | None = None,
+    ):
+        self.env_factory = env_factory
+        self.size = size
+        self.tasks = list(tasks or [])
+        self.logger = logger or DebugGymLogger("debug-gym")
+        self._idle: list[tuple[RepoEnv, dict, EnvInfo]] = []
+        self._lock = threading.Lock()
+        self._executor = ThreadPoolExecutor(max(size, 1), "debug-gym-pool")
+        self._closed = False
+
+    def start(self):
+        for i in range(self.size):
+            options = (
+                {"task_name": self.tasks[i % len(self.tasks)]} if self.tasks else {}
+            )
+            self._executor.submit(self._warm, None, options)
+
+    def _warm(self, env: RepoEnv | None, options: dict):
+        try:
+            env = env or self.env_factory()
+            infos = env.reset(options=options)
+        except Exception as e:
+            self.logger.warning(f"Failed to warm an environment {options}: {e!r}")
+            if env is not None:
+                env.close()
+            return
+
+        with self._lock:
+            if not self._closed and len(self._idle) < self.size:
+                self._idle.append((env, options, infos))
+                return
+        env.close()
+
+    def acquire(self, options: dict) -> tuple[RepoEnv, EnvInfo | None]:
+        """An idle environment, along with the infos of its last reset if it was
+        reset with `options` already (None otherwise)."""
+        with self._lock:
+            for i, (env, env_options, infos) in enumerate(self._idle):
+                if env_options == options:
+                    del self._idle[i]
+                    return env, infos
+            if self._idle:
+                env, _, _ = self._idle.pop(0)
+                return env, None
+        return self.env_factory(), None
+
+    def release(self, env: RepoEnv) -> None:
+        """Give back the environment of a finished session."""
+        try:
+            self._executor.submit(self._warm, env, env.reset_options)
+        except RuntimeError:  # The pool is closed.
+            env.close()
+
+    def close(self):
+        with self._lock:
+            self._closed = True
+            idle, self._idle = self._idle, []
+        self._executor.shutdown(wait=True, cancel_futures=True)
+        for env, _, _ in idle:
+            env.close()
+
+
+class EnvServer:
+    """Serves the environments of a pool on a Unix socket, one thread per client
+    connection. Sessions belong to the connection which opened them, and are
+    closed when it is."""
+
+    def __init__(
+        self,
+        socket_path: str,
+        pool: EnvPool,
+        logger: DebugGymLogger | None = None,
+    ):
+        self.socket_path = socket_path
+        self.pool = pool
+        self.logger = logger or DebugGymLogger("debug-gym")
+        self._socket = None
+        self._thread = None
+
+    def bind(self):
+        if os.path.exists(self.socket_path):
+            os.unlink(self.socket_path)  # Left over by a previous server.
+        self._socket = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self._socket.bind(self.socket_path)
+        os.chmod(self.socket_path, 0o600)
+        self._socket.listen()
+
+    def serve_forever(self):
+        if self._socket is None:
+            self.bind()
+        server_socket = self._socket
+        self.pool.start()
+        self.logger.info(f"Serving environments on {self.socket_path}")
+        while True:
+            try:
+                connection, _ = server_socket.accept()
+            except OSError:  # The server was shut down.
+                break
+            threading.Thread(
+                target=self.handle_connection, args=(connection,), daemon=True
+            ).start()
+
+    def start(self):
+        """Serve in a background thread."""
+        self.bind()
+        self._thread = threading.Thread(target=self.serve_forever, daemon=True)
+        self._thread.start()
+
+    def shutdown(self):
+        if self._socket is not None:
+            self._socket.shutdown(socket.SHUT_RDWR)
+            self._socket.close()
+            self._socket = None
+        if self._thread is not None:
+            self._thread.join()
+            self._thread = None
+        self.pool.close()
+        if os.path.exists(self.socket_path):
+            os.unlink(self.socket_path)
+
+    def handle_connection(self, connection: socket.socket):
+        sessions: dict[str, RepoEnv] = {}
+        try:
+            while True:
+                try:
+                    method, kwargs = recv_message(connection)
+                except (EOFError, ConnectionError):
+                    break
+                try:
+                    response = {"result": self.dispatch(sessions, method, **kwargs)}
+                except Exception as e:
+                    self.logger.debug(f"Request `{method}` failed: {e!r}")
+                    response = {"error": f"{type(e).__name__}: {e}"}
+                send_message(connection, response)
+        finally:
+            connection.close()
+            for env in sessions.values():
+                self.pool.release(env)
+
+    def dispatch(self, sessions: dict[str, RepoEnv], method: str, **kwargs):
+        match method:
+            case "reset":
+                return self.reset(sessions, **kwargs)
+            case "step":
+                return self.step(sessions, **kwargs)
+            case "fork":
+                return self.fork(sessions, **kwargs)
+            case "close":
+                return self.close(sessions, **kwargs)
+            case _:
+                raise ValueError(f"Unknown method: {method}")
+
+    def _get_env(self, sessions: dict[str, RepoEnv], session: str) -> RepoEnv:
+        if session not in sessions:
+            raise ValueError(f"Unknown session: {session}")
+        return sessions[session]
+
+    def reset(
+        self, sessions: dict[str, RepoEnv], session: str | None = None, options=None
+    ) -> tuple[str, EnvInfo]:
+        """Reset a session, or open a new one if `session` is None."""
+        options = options or {}
+        if session is not None:
+            return session, _to_client(
+                self._get_env(sessions, session).reset(options=options)
+            )
+
+        env, infos = self.pool.acquire(options)
+        try:
+            infos = infos or env.reset(options=options)
+        except Exception:
+            self.pool.release(env)
+            raise
+        session = uuid.uuid4().hex
+        sessions[session] = env
+        return session, _to_client(infos)
+
+    def step(
+        self,
+        sessions: dict[str, RepoEnv],
+        session: str,
+        action_tool_call: ToolCall,
+        action_content: str | None = None,
+        action_reasoning: str | None = None,
+    ) -> EnvInfo:
+        env = self._get_env(sessions, session)
+        infos = env.step(action_tool_call, action_content, action_reasoning)
+        return _to_client(infos)
+
+    def fork(self, sessions: dict[str, RepoEnv], session: str) -> tuple[str, EnvInfo]:
+        """Open a new session in the same state as `session`."""
+        env = self._get_env(sessions, session)
+        fork, infos = self.pool.acquire(env.reset_options)
+        try:
+            infos = env.fork_into(fork, reset=infos is None)
+        except Exception:
+            self.pool.release(fork)
+            raise
+        fork_session = uuid.uuid4().hex
+        sessions[fork_session] = fork
+        return fork_session, _to_client(infos)
+
+    def close(self, sessions: dict[str, RepoEnv], session: str) -> None:
+        self.pool.release(sessions.pop(session))
+
+
+class EnvServerError(RuntimeError):
+    pass
+
+
+class EnvClient:
+    """Connection to an EnvServer, shared by the RemoteEnv of its sessions."""
+
+    def __init__(self, socket_path: str):
+        self.socket = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.socket.connect(socket_path)
+        self._lock = threading.Lock()
+
+    def call(self, method: str, **kwargs):
+        with self._lock:
+            send_message(self.socket, (method, kwargs))
+            response = recv_message(self.socket)
+        if "error" in response:
+            raise EnvServerError(response["error"])
+        return response["result"]
+
+    def close(self):
+        self.socket.close()
+
+
+class RemoteEnv:
+    """Client side of a session, with the `reset`/`step`/`close` interface of
+    RepoEnv. The tools of the returned infos are `ToolSpec`s."""
+
+    def __init__(self, socket_path: str | None = None, client: EnvClient | None = None):
+        self.client = client or EnvClient(socket_path)
+        self._owns_client = client is None
+        self.session = None
+        self.infos: EnvInfo | None = None
+
+    def reset(self, *, options: dict = None) -> EnvInfo:
+        self.session, self.infos = self.client.call(
+            "reset", session=self.session, options=options
+        )
+        return self.infos
+
+    def step(
+        self,
+        action_tool_call: ToolCall,
+        action_content: str | None = None,
+        action_reasoning: str | None = None,
+    ) -> EnvInfo:
+        self.infos = self.client.call(
+            "step",
+            session=self.session,
+            action_tool_call=action_tool_call,
+            action_content=action_content,
+            action_reasoning=action_reasoning,
+        )
+        return self.infos
+
+    def fork(self) -> "RemoteEnv":
+        """A new session in the current state of this one, sharing its connection
+        (the fork is closed along with the connection)."""
+        fork = RemoteEnv(client=self.client)
+        fork.session, fork.infos = self.client.call("fork", session=self.session)
+        return fork
+
+    def close(self):
+        if self.session is not None:
+            self.client.call("close", session=self.session)
+            self.session = None
+        if self._owns_client:
+            self.client.close()
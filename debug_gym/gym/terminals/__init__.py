@@ -1,6 +1,7 @@
 from debug_gym.gym.terminals.docker import DockerTerminal
 from debug_gym.gym.terminals.kubernetes import KubernetesTerminal
 from debug_gym.gym.terminals.local import LocalTerminal
+from debug_gym.gym.terminals.shared_docker import SharedDockerTerminal
 from debug_gym.gym.terminals.terminal import Terminal
 from debug_gym.logger import DebugGymLogger
 
@@ -18,6 +19,8 @@ def select_terminal(
     match terminal_type:
         case "docker":
             terminal_class = DockerTerminal
+        case "shared_docker":
+            terminal_class = SharedDockerTerminal
         case "kubernetes":
             terminal_class = KubernetesTerminal
         case "local":
@@ -1,4 +1,3 @@
-import atexit
 import os
 import tarfile
 import uuid
@@ -7,6 +6,8 @@ from pathlib import Path
 
 import docker
 
+from debug_gym.gym.resources import RESOURCES
+from debug_gym.gym.terminals.reaper import owner_labels
 from debug_gym.gym.terminals.shell_session import ShellSession
 from debug_gym.gym.terminals.terminal import DISABLE_ECHO_COMMAND, Terminal
 from debug_gym.logger import DebugGymLogger
@@ -24,6 +25,7 @@ class DockerTerminal(Terminal):
         base_image: str | None = None,
         registry: str = "",
         setup_commands: list[str] | None = None,
+        extra_labels: dict | None = None,
         **kwargs,
     ):
         """
@@ -45,8 +47,13 @@ class DockerTerminal(Terminal):
         self.base_image = base_image
         self.registry = registry.rstrip("/") + "/" if registry else ""
         self.setup_commands = setup_commands or []
+        self.labels = {"app": "dbg-gym"} | {
+            key: str(value)
+            for key, value in (extra_labels or {}).items()
+            if value is not None
+        }
+        self._container = None  # Set first, `__del__` runs even if `from_env` fails.
         self.docker_client = docker.from_env(timeout=600)
-        self._container = None
 
     @property
     def working_dir(self):
@@ -55,7 +62,7 @@ class DockerTerminal(Terminal):
 
     @working_dir.setter
     def working_dir(self, value):
-        if self._container is not None:
+        if self._container is not None and value != self._working_dir:
             raise ValueError(
                 "Cannot change working directory while container is running."
             )
@@ -145,6 +152,8 @@ class DockerTerminal(Terminal):
             command="sleep infinity",  # Keep the container running
             working_dir=self.working_dir,
             environment=self.env_vars,
+            # Owner labels let the reaper remove the container if we get killed.
+            labels=self.labels | owner_labels(),
             detach=True,
             auto_remove=True,
             remove=True,
@@ -156,7 +165,7 @@ class DockerTerminal(Terminal):
         container.reload()  # Refresh container attributes (e.g., status="running")
         self._run_setup_commands(container)
         self.logger.debug(f"{container} ({container_name}) started successfully.")
-        atexit.register(self.clean_up)
+        RESOURCES.register(self.clean_up, "container")
         return container
 
     def _run_setup_commands(self, container):
@@ -189,11 +198,15 @@ class DockerTerminal(Terminal):
                     "It might have already been removed."
                 )
             self._container = None
+        RESOURCES.unregister(self.clean_up)
 
     def close(self):
         super().close()
         self.clean_up()
 
+    def __del__(self):
+        self.close()
+
     def __str__(self):
         return f"DockerTerminal[{self.container}, {self.working_dir}]"
 
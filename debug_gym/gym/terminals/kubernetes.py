@@ -1,10 +1,12 @@
-import atexit
+import hashlib
 import json
 import os
 import random
+import shlex
 import subprocess
 import time
 import uuid
+from collections import defaultdict
 from pathlib import Path
 
 from jinja2 import Template
@@ -19,11 +21,15 @@ from tenacity import (
 )
 from yaml import dump, safe_load
 
-from debug_gym.gym.terminals.shell_session import ShellSession
+from debug_gym.gym.resources import RESOURCES
+from debug_gym.gym.terminals.reaper import owner_labels
+from debug_gym.gym.terminals.shell_session import ProcessNotRunningError, ShellSession
 from debug_gym.gym.terminals.terminal import DISABLE_ECHO_COMMAND, Terminal
 from debug_gym.logger import DebugGymLogger
 
 NB_RETRIES_RUN = 50  # Number of retries for running a command
+SHELL_COMMAND = "/bin/bash --noprofile --norc --noediting"
+PREPULL_APP_LABEL = "dbg-gym-prepull"  # `app` label of the image pre-pulling pods.
 
 
 def _clean_for_kubernetes(name: str) -> str:
@@ -36,6 +42,113 @@ def _clean_for_kubernetes(name: str) -> str:
     return cleaned[:253]
 
 
+def _normalize_image(image: str) -> str:
+    """Normalize an image reference the way nodes report it, e.g. `ubuntu` and
+    `docker.io/library/ubuntu:latest` are the same image."""
+    image = image.removeprefix("docker.io/").removeprefix("library/")
+    if "@" not in image and ":" not in image.rsplit("/", 1)[-1]:
+        image += ":latest"
+    return image
+
+
+class ImageLocality:
+    """Tracks which nodes likely have an image already, so pods can prefer them
+    and avoid pulling large images again.
+
+    Nodes are known from the nodes where this process's pods recently ran, and
+    from the images listed in the nodes' status (cached for `refresh_interval`
+    seconds). Listing nodes requires cluster-wide read permissions; without
+    them, only the pod history is used.
+    """
+
+    # Nodes where pods of each image recently ran, most recent first. Shared by
+    # all terminals of the process, e.g., successive tasks of a `run.py` worker.
+    history: dict[str, list[str]] = defaultdict(list)
+
+    def __init__(
+        self,
+        k8s_client: client.CoreV1Api,
+        node_selector: dict[str, str] | None = None,
+        max_nodes: int = 5,
+        refresh_interval: int = 300,
+        logger: DebugGymLogger | None = None,
+    ):
+        self.k8s_client = k8s_client
+        self.node_selector = node_selector or {}
+        self.max_nodes = max_nodes
+        self.refresh_interval = refresh_interval
+        self.logger = logger or DebugGymLogger("debug-gym")
+        self._nodes = None
+        self._listed_at = None
+
+    def nodes(self) -> list | None:
+        """Schedulable nodes matching the node selector, or None if they cannot
+        be listed."""
+        now = time.monotonic()
+        if self._listed_at is None or now - self._listed_at > self.refresh_interval:
+            self._listed_at = now
+            label_selector = ",".join(f"{k}={v}" for k, v in self.node_selector.items())
+            try:
+                nodes = self.k8s_client.list_node(label_selector=label_selector).items
+                self._nodes = [node for node in nodes if not node.spec.unschedulable]
+            except ApiException as e:
+                self.logger.debug(f"Cannot list nodes for image locality: {e}")
+                self._nodes = None
+
+        return self._nodes
+
+    def record(self, image: str, node_name: str | None):
+        """Record that a pod using `image` ran on `node_name`."""
+        if not node_name:
+            return
+
+        nodes = self.history[_normalize_image(image)]
+        if node_name in nodes:
+            nodes.remove(node_name)
+        nodes.insert(0, node_name)
+        del nodes[self.max_nodes :]
+
+    def nodes_with_image(self, image: str) -> list[str]:
+        """Nodes whose status lists `image` among their images."""
+        image = _normalize_image(image)
+        return [
+            node.metadata.name
+            for node in self.nodes() or []
+            if any(
+                _normalize_image(name) == image
+                for node_image in node.status.images or []
+                for name in node_image.names or []
+            )
+        ]
+
+    def preferred_nodes(self, image: str) -> list[str]:
+        """Up to `max_nodes` nodes likely to have `image`, most likely first."""
+        candidates = self.history[_normalize_image(image)] + self.nodes_with_image(
+            image
+        )
+        nodes = self.nodes()
+        if nodes is not None:  # Skip nodes gone or unschedulable.
+            schedulable = {node.metadata.name for node in nodes}
+            candidates = [name for name in candidates if name in schedulable]
+
+        return list(dict.fromkeys(candidates))[: self.max_nodes]
+
+    def node_affinity(self, image: str, weight: int = 100) -> dict | None:
+        """Preferred node affinity term for the nodes likely to have `image`."""
+        nodes = self.preferred_nodes(image)
+        if not nodes:
+            return None
+
+        return {
+            "weight": weight,
+            "preference": {
+                "matchFields": [
+                    {"key": "metadata.name", "operator": "In", "values": nodes}
+                ]
+            },
+        }
+
+
 class Pod:
     def __init__(
         self, k8s_client: client.CoreV1Api, pod_body: dict, logger: DebugGymLogger
@@ -46,9 +159,10 @@ class Pod:
         self.namespace = self.pod_body["metadata"]["namespace"]
         self.logger = logger
         self._last_pending_reason = None  # Track to avoid duplicate pending logs
+        self.node_name = None
 
         self.create_pod()
-        atexit.register(self.clean_up)
+        RESOURCES.register(self.clean_up, "pod")
         self.wait_for_pod_ready()
 
     @retry(
@@ -110,7 +224,8 @@ class Pod:
                 phase = pod.status.phase
 
                 if phase == "Running":
-                    self.logger.debug(f"{self} is ready on node {pod.spec.node_name}")
+                    self.node_name = pod.spec.node_name
+                    self.logger.debug(f"{self} is ready on node {self.node_name}")
                     return
                 elif phase in ["Failed", "Unknown", "Succeeded"]:
                     raise ValueError(f"{self} is in {phase} state instead of running.")
@@ -173,6 +288,7 @@ class Pod:
 
     def clean_up(self):
         """Clean up the Kubernetes pod."""
+        RESOURCES.unregister(self.clean_up)
         if not self.exists():
             return
 
@@ -212,8 +328,88 @@ class Pod:
         return f"Pod[{self.name}]"
 
 
+class KubernetesShellSession(ShellSession):
+    """A ShellSession attached to the pod's TTY through the exec websocket of the
+    Kubernetes API, instead of a `kubectl exec -it` subprocess per session."""
+
+    def __init__(
+        self,
+        k8s_client: client.CoreV1Api,
+        pod: Pod,
+        shell_command: str = SHELL_COMMAND,
+        session_commands: list[str] | None = None,
+        env_vars: dict[str, str] | None = None,
+        logger: DebugGymLogger | None = None,
+        container: str = "main",
+    ):
+        super().__init__(
+            shell_command=shell_command,
+            working_dir=".",  # The shell starts in the container's working directory.
+            session_commands=session_commands,
+            env_vars=env_vars,
+            logger=logger,
+        )
+        self.k8s_client = k8s_client
+        self.pod = pod
+        self.container = container
+        self._ws = None
+
+    @property
+    def is_running(self):
+        return self._ws is not None and self._ws.is_open()
+
+    def _spawn(self, cmd_list: list[str]):
+        # The shell inherits the pod's environment, except for the prompt
+        # which must match the one the session reads until.
+        command = ["env", f"PS1={self.env_vars['PS1']}"] + cmd_list
+        try:
+            self._ws = stream.stream(
+                self.k8s_client.connect_get_namespaced_pod_exec,
+                name=self.pod.name,
+                namespace=self.pod.namespace,
+                container=self.container,
+                command=command,
+                stdin=True,
+                stdout=True,
+                stderr=True,
+                tty=True,
+                _preload_content=False,
+            )
+        except Exception as e:
+            self.logger.debug(f"{self} failed to connect to {self.pod}: {e!r}")
+            raise ProcessNotRunningError(command=shlex.join(cmd_list), output=str(e))
+
+    def _write(self, data: bytes):
+        self._ws.write_stdin(data.decode("utf-8"))
+
+    def _read_chunk(self, read_length: int) -> str:
+        if not self._ws.is_open():
+            raise EOFError
+        self._ws.update(timeout=0.1)
+        output = ""
+        # With a TTY, stderr is merged into stdout by the container runtime.
+        if self._ws.peek_stdout():
+            output += self._ws.read_stdout()
+        if self._ws.peek_stderr():
+            output += self._ws.read_stderr()
+        return output
+
+    def close(self):
+        RESOURCES.unregister(self.close)
+        if self._ws is not None:
+            self.logger.debug(f"Closing {self}.")
+            self._ws.close()
+            self._ws = None
+
+    def __str__(self):
+        return f"K8sShell[{self._session_id}]"
+
+
 class KubernetesTerminal(Terminal):
 
+    # Images already handled by `prepull_images` in this process.
+    _prepulled_images: set[str] = set()
+
     def __init__(
         self,
         working_dir: str | None = None,
@@ -230,8 +426,24 @@ class KubernetesTerminal(Terminal):
         kube_context: str | None = None,
         extra_labels: dict | None = None,
         pod_spec_kwargs: dict = None,
+        kubectl_sessions: bool = False,
+        image_locality: bool = True,
+        prepull_nodes: int = 0,
+        prepull_lookahead: int = 16,
         **kwargs,
     ):
+        """
+        kubectl_sessions (bool): If True, interactive shell sessions (e.g., pdb)
+                spawn a `kubectl exec -it` subprocess, instead of connecting to the
+                pod's exec websocket directly (requires kubectl).
+        image_locality (bool): If True, pods prefer the nodes which likely have
+                their image already (see `ImageLocality`).
+        prepull_nodes (int): Number of nodes per image on which `prepull_images`
+                warms the images of the upcoming tasks. Disabled if 0.
+        prepull_lookahead (int): Number of upcoming images warmed at a time, so
+                at most `prepull_lookahead * prepull_nodes` pods pre-pull
+                images. More are warmed as the tasks' pods start.
+        """
         super().__init__(
             working_dir=working_dir,
             session_commands=session_commands,
@@ -247,6 +459,7 @@ class KubernetesTerminal(Terminal):
         self.registry = registry.rstrip("/") + "/" if registry else ""
         self._pod_name = pod_name
         self.pod_spec_kwargs = pod_spec_kwargs or {}
+        self.kubectl_sessions = kubectl_sessions
         user = _clean_for_kubernetes(os.environ.get("USER", "unknown"))
         self.labels = {"app": "dbg-gym", "user": user} | (extra_labels or {})
         self._pod = None
@@ -276,7 +489,16 @@ class KubernetesTerminal(Terminal):
             self.env_vars.setdefault("PATH", os.environ["PATH"])
 
         self.k8s_client = client.CoreV1Api()
-        atexit.register(self.close)
+        self.prepull_nodes = prepull_nodes
+        self.prepull_lookahead = prepull_lookahead
+        self._upcoming_images = []  # Images of the upcoming tasks, in order.
+        self.image_locality = None
+        if image_locality or prepull_nodes:
+            self.image_locality = ImageLocality(
+                self.k8s_client,
+                node_selector=self._render_pod_spec_kwargs().get("nodeSelector"),
+                logger=self.logger,
+            )
 
     @property
     def pod_name(self):
@@ -310,7 +532,7 @@ class KubernetesTerminal(Terminal):
 
     @working_dir.setter
     def working_dir(self, value):
-        if self._pod is not None:
+        if self._pod is not None and value != self._working_dir:
             raise ValueError("Cannot change working directory after pod creation.")
 
         self._working_dir = value
@@ -327,20 +549,28 @@ class KubernetesTerminal(Terminal):
     def default_shell_command(self) -> list[str]:
         """Expects the pod to have bash installed."""
         kubeconfig = f"--kubeconfig {self.kube_config} " if self.kube_config else ""
-        bash_cmd = "/bin/bash --noprofile --norc --noediting"
-        return f"kubectl {kubeconfig}exec -it {self.pod.name} -c main -n {self.pod.namespace} -- {bash_cmd}"
+        return f"kubectl {kubeconfig}exec -it {self.pod.name} -c main -n {self.pod.namespace} -- {SHELL_COMMAND}"
 
     def new_shell_session(self):
         if not self.pod.is_running():
             raise ValueError("Pod is not running. Cannot create shell session.")
 
-        session = ShellSession(
-            shell_command=self.default_shell_command,
-            session_commands=[DISABLE_ECHO_COMMAND] + self.session_commands,
-            working_dir=".",
-            env_vars=self.env_vars,
-            logger=self.logger,
-        )
+        if self.kubectl_sessions:
+            session = ShellSession(
+                shell_command=self.default_shell_command,
+                session_commands=[DISABLE_ECHO_COMMAND] + self.session_commands,
+                working_dir=".",
+                env_vars=self.env_vars,
+                logger=self.logger,
+            )
+        else:
+            session = KubernetesShellSession(
+                k8s_client=self.k8s_client,
+                pod=self.pod,
+                session_commands=[DISABLE_ECHO_COMMAND] + self.session_commands,
+                env_vars=self.env_vars,
+                logger=self.logger,
+            )
         self.sessions.append(session)
         return session
 
@@ -441,11 +671,17 @@ class KubernetesTerminal(Terminal):
             f"Setting up pod {pod_name} with image: {self.registry}{self.base_image}"
         )
 
-        # Render pod_spec_kwargs as a Jinja2 template, replace variables, then load as dict.
-        pod_spec_yaml = dump(self.pod_spec_kwargs)
-        pod_spec_template = Template(pod_spec_yaml)
-        rendered_yaml = pod_spec_template.render(os.environ)
-        pod_spec_kwargs = safe_load(rendered_yaml)
+        pod_spec_kwargs = self._render_pod_spec_kwargs()
+        image = f"{self.registry}{self.base_image}"
+        if self.image_locality is not None:
+            preference = self.image_locality.node_affinity(image)
+            if preference is not None:
+                self.logger.debug(f"Preferring nodes with image {image}: {preference}")
+                node_affinity = pod_spec_kwargs.setdefault("affinity", {})
+                node_affinity = node_affinity.setdefault("nodeAffinity", {})
+                node_affinity.setdefault(
+                    "preferredDuringSchedulingIgnoredDuringExecution", []
+                ).append(preference)
 
         # Create pod specification for Kubernetes.
         pod_body = {
@@ -454,7 +690,8 @@ class KubernetesTerminal(Terminal):
             "metadata": {
                 "name": pod_name,
                 "namespace": self.namespace,
-                "labels": self.labels,
+                # Owner labels let the reaper delete the pod if we get killed.
+                "labels": self.labels | owner_labels(),
             },
             "spec": {
                 "activeDeadlineSeconds": 3600 * 24,  # a day
@@ -462,7 +699,7 @@ class KubernetesTerminal(Terminal):
                 "containers": [
                     {
                         "name": "main",
-                        "image": f"{self.registry}{self.base_image}",
+                        "image": image,
                         "imagePullPolicy": "IfNotPresent",
                         "command": ["/bin/bash"],
                         "args": ["-c", "sleep infinity"],
@@ -485,6 +722,9 @@ class KubernetesTerminal(Terminal):
 
         try:
             self._pod = Pod(self.k8s_client, pod_body, logger=self.logger)
+            if self.image_locality is not None:
+                self.image_locality.record(image, self._pod.node_name)
+            self._prepull_next(self.base_image)
 
             # Run setup commands
             self._run_setup_commands()
@@ -493,6 +733,143 @@ class KubernetesTerminal(Terminal):
         except ApiException as e:
             raise ValueError(f"Failed to create pod: {e}")
 
+    def _render_pod_spec_kwargs(self) -> dict:
+        """Render pod_spec_kwargs as a Jinja2 template, replace variables, then load as dict."""
+        pod_spec_yaml = dump(self.pod_spec_kwargs)
+        pod_spec_template = Template(pod_spec_yaml)
+        rendered_yaml = pod_spec_template.render(os.environ)
+        return safe_load(rendered_yaml)
+
+    def prepull_images(self, images: list[str] | None = None) -> list[str]:
+        """Warm the given images (e.g., of the upcoming tasks, in order) on
+        `prepull_nodes` nodes each, by running a short-lived pod per image and
+        node, so the tasks' pods land on nodes which already have their image.
+        Only the next `prepull_lookahead` images are warmed, the following ones
+        as the tasks' pods start (or by calling it again without `images`).
+        Returns the names of the pods created."""
+        if images is not None:
+            self._upcoming_images = list(images)
+        images = [
+            image
+            for image in self._upcoming_images[: self.prepull_lookahead]
+            if image not in self._prepulled_images
+        ]
+        if not self.prepull_nodes or not images:
+            return []
+
+        nodes = self.image_locality.nodes()
+        if not nodes:
+            self.logger.warning("Cannot list the nodes to pre-pull images on.")
+            return []
+
+        warming = self._sweep_prepull_pods()
+        node_names = [node.metadata.name for node in nodes]
+        pod_spec_kwargs = self._render_pod_spec_kwargs()
+        created = []
+        for i, image in enumerate(images):
+            image = f"{self.registry}{image}"
+            warm = set(self.image_locality.preferred_nodes(image))
+            warm |= warming[_normalize_image(image)]
+            missing = self.prepull_nodes - len(warm)
+            # Spread the images over the nodes.
+            offset = i * self.prepull_nodes % len(node_names)
+            candidates = node_names[offset:] + node_names[:offset]
+            candidates = [name for name in candidates if name not in warm]
+            for node_name in candidates[: max(0, missing)]:
+                pod_name = self._create_prepull_pod(image, node_name, pod_spec_kwargs)
+                if pod_name is not None:
+                    self.image_locality.record(image, node_name)
+                    created.append(pod_name)
+
+        self._prepulled_images.update(images)
+        self.logger.info(f"Pre-pulling {len(images)} images with {len(created)} pods.")
+        return created
+
+    def _prepull_next(self, image: str) -> None:
+        """Warm the next upcoming image, now that the task of `image` started."""
+        normalized = _normalize_image(image)
+        upcoming = [
+            upcoming
+            for upcoming in self._upcoming_images
+            if _normalize_image(upcoming) != normalized
+        ]
+        if len(upcoming) == len(self._upcoming_images):
+            return
+
+        self._upcoming_images = upcoming
+        try:
+            self.prepull_images()
+        except ApiException as e:  # The task's pod is fine without it.
+            self.logger.debug(f"Failed to pre-pull the upcoming images: {e}")
+
+    def _sweep_prepull_pods(self) -> dict[str, set[str]]:
+        """Delete finished pre-pulling pods, e.g., from previous calls or other
+        workers. Returns the nodes on which each image is being pulled."""
+        warming = defaultdict(set)
+        pods = self.k8s_client.list_namespaced_pod(
+            namespace=self.namespace, label_selector=f"app={PREPULL_APP_LABEL}"
+        ).items
+        for pod in pods:
+            image = _normalize_image(pod.spec.containers[0].image)
+            warming[image].add(pod.spec.node_name)
+            if pod.status.phase in ("Succeeded", "Failed"):
+                try:
+                    self.k8s_client.delete_namespaced_pod(
+                        name=pod.metadata.name, namespace=self.namespace
+                    )
+                except ApiException as e:
+                    self.logger.debug(f"Failed to delete {pod.metadata.name}: {e}")
+
+        return warming
+
+    def _create_prepull_pod(
+        self, image: str, node_name: str, pod_spec_kwargs: dict
+    ) -> str | None:
+        image_hash = hashlib.sha1(image.encode()).hexdigest()[:8]
+        pod_name = _clean_for_kubernetes(f"dbg-gym-prepull.{image_hash}.{node_name}")[
+            :63
+        ].strip("-.")
+        pod_body = {
+            "apiVersion": "v1",
+            "kind": "Pod",
+            "metadata": {
+                "name": pod_name,
+                "namespace": self.namespace,
+                "labels": {"app": PREPULL_APP_LABEL},
+            },
+            "spec": {
+                "activeDeadlineSeconds": 3600,
+                "restartPolicy": "Never",
+                "nodeName": node_name,  # Bypass the scheduler.
+                "containers": [
+                    {
+                        "name": "prepull",
+                        "image": image,
+                        "imagePullPolicy": "IfNotPresent",
+                        "command": ["/bin/sh", "-c", "true"],
+                        "resources": {"requests": {"cpu": "10m", "memory": "16Mi"}},
+                    }
+                ],
+                # Needed to pull from private registries or to run on tainted nodes.
+                **{
+                    key: pod_spec_kwargs[key]
+                    for key in ("imagePullSecrets", "tolerations")
+                    if key in pod_spec_kwargs
+                },
+            },
+        }
+        try:
+            self.k8s_client.create_namespaced_pod(
+                namespace=self.namespace, body=pod_body
+            )
+        except ApiException as e:
+            if e.status != 409:  # Already pre-pulling.
+                self.logger.debug(f"Failed to create pre-pulling pod {pod_name}: {e}")
+            return None
+
+        self.logger.debug(f"Pre-pulling {image} on node {node_name}.")
+        return pod_name
+
     def _run_setup_commands(self):
         """Run setup commands if any. If commands fail, delete the pod."""
         if not self.setup_commands:
@@ -0,0 +1,245 @@
+import atexit
+import os
+import re
+import socket
+import tempfile
+import threading
+import time
+from pathlib import Path
+
+from debug_gym.logger import DebugGymLogger
+
+OWNER_HOST_LABEL = "debug-gym.owner-host"
+OWNER_PID_LABEL = "debug-gym.owner-pid"
+HEARTBEAT_DIR = Path(tempfile.gettempdir()) / "debug_gym_heartbeats"
+HEARTBEAT_INTERVAL = 10  # seconds between two heartbeats of a process
+HEARTBEAT_TIMEOUT = 120  # seconds without heartbeat before sandboxes are reaped
+
+
+def hostname() -> str:
+    """Host name usable as a Docker or Kubernetes label value."""
+    return re.sub(r"[^a-zA-Z0-9_.-]", "-", socket.gethostname())[:63].strip("-_.")
+
+
+def owner_labels() -> dict[str, str]:
+    """Labels identifying the current process as the owner of a sandbox. Also
+    starts the heartbeat of the process, so the sandbox is not reaped."""
+    Heartbeat.start()
+    return {OWNER_HOST_LABEL: hostname(), OWNER_PID_LABEL: str(os.getpid())}
+
+
+def is_process_running(pid: int) -> bool:
+    try:
+        os.kill(pid, 0)
+    except ProcessLookupError:
+        return False
+    except PermissionError:
+        pass  # Owned by another user.
+    return True
+
+
+class Heartbeat:
+    """A file touched periodically by a daemon thread while the process lives."""
+
+    _pid = None  # Process running the heartbeat thread (not inherited by forks).
+    _stop_event = None
+
+    @staticmethod
+    def path(pid: int) -> Path:
+        return HEARTBEAT_DIR / str(pid)
+
+    @classmethod
+    def start(cls, interval: int = HEARTBEAT_INTERVAL):
+        if cls._pid == os.getpid():
+            return
+
+        cls._pid = os.getpid()
+        cls._stop_event = stop_event = threading.Event()
+        path = cls.path(cls._pid)
+        path.parent.mkdir(parents=True, exist_ok=True)
+        path.touch()
+
+        def beat():
+            while not stop_event.wait(interval):
+                path.touch()
+
+        threading.Thread(target=beat, name="debug-gym-heartbeat", daemon=True).start()
+        atexit.register(cls.stop)
+
+    @classmethod
+    def stop(cls):
+        if cls._pid != os.getpid():
+            return
+
+        cls._stop_event.set()
+        cls.path(cls._pid).unlink(missing_ok=True)
+        cls._pid = None
+
+    @classmethod
+    def is_alive(cls, pid: int, timeout: int = HEARTBEAT_TIMEOUT) -> bool:
+        try:
+            return time.time() - cls.path(pid).stat().st_mtime < timeout
+        except FileNotFoundError:
+            return False
+
+
+class Reaper:
+    """Deletes the sandboxes (Docker containers and Kubernetes pods) whose owner
+    process stopped without cleaning them up, e.g., a SIGKILLed or OOM-killed
+    worker. Only sandboxes owned by processes of this host are considered, since
+    heartbeats are local. Containers of SharedDockerTerminal are not owned by a
+    single process: they are left to their last tenant, unless all their tenants
+    are orphaned."""
+
+    def __init__(
+        self,
+        docker_client=None,
+        k8s_client=None,
+        namespace: str = "default",
+        uuid: str | None = None,
+        timeout: int = HEARTBEAT_TIMEOUT,
+        logger: DebugGymLogger | None = None,
+    ):
+        self.docker_client = docker_client
+        self.k8s_client = k8s_client
+        self.namespace = namespace
+        self.uuid = uuid  # Only reap the sandboxes of this experiment.
+        self.timeout = timeout
+        self.logger = logger or DebugGymLogger("debug-gym")
+        self._thread = None
+        self._stop_event = threading.Event()
+
+    @classmethod
+    def for_terminal(cls, terminal, **kwargs) -> "Reaper":
+        """Reaper of the sandboxes created by terminals like `terminal`."""
+        return cls(
+            docker_client=getattr(terminal, "docker_client", None),
+            k8s_client=getattr(terminal, "k8s_client", None),
+            namespace=getattr(terminal, "namespace", "default"),
+            **kwargs,
+        )
+
+    @property
+    def enabled(self) -> bool:
+        return self.docker_client is not None or self.k8s_client is not None
+
+    def is_orphaned(self, labels: dict[str, str]) -> bool:
+        if labels.get(OWNER_HOST_LABEL) != hostname():
+            return False
+
+        pid = int(labels[OWNER_PID_LABEL])
+        return not is_process_running(pid) or not Heartbeat.is_alive(pid, self.timeout)
+
+    def _selectors(self) -> list[str]:
+        selectors = [OWNER_PID_LABEL, f"{OWNER_HOST_LABEL}={hostname()}"]
+        if self.uuid:
+            selectors.append(f"uuid={self.uuid}")
+        return selectors
+
+    def _shared_selectors(self) -> list[str]:
+        from debug_gym.gym.terminals.shared_docker import SHARED_GROUP_LABEL
+
+        selectors = [SHARED_GROUP_LABEL, f"{OWNER_HOST_LABEL}={hostname()}"]
+        if self.uuid:
+            selectors.append(f"uuid={self.uuid}")
+        return selectors
+
+    def reap(self) -> list[str]:
+        """Delete orphaned sandboxes. Returns the names of the deleted sandboxes."""
+        reaped = []
+        if self.docker_client is not None:
+            reaped += self.reap_docker()
+        if self.k8s_client is not None:
+            reaped += self.reap_kubernetes()
+        return reaped
+
+    def reap_docker(self) -> list[str]:
+        import docker
+
+        reaped = []
+        containers = self.docker_client.containers.list(
+            filters={"label": self._selectors()}
+        )
+        for container in containers:
+            if not self.is_orphaned(container.labels):
+                continue
+            self.logger.info(f"Reaping orphaned container {container.name}.")
+            try:
+                container.stop(timeout=1)  # Removed on stop (auto_remove).
+                reaped.append(container.name)
+            except docker.errors.APIError as e:
+                self.logger.debug(f"Failed to reap container {container.name}: {e}")
+
+        reaped += self.reap_shared_docker()
+        return reaped
+
+    def reap_shared_docker(self) -> list[str]:
+        import docker
+
+        from debug_gym.gym.terminals.shared_docker import SharedDockerTerminal
+
+        reaped = []
+        containers = self.docker_client.containers.list(
+            filters={"label": self._shared_selectors()}
+        )
+        for container in containers:
+            try:
+                if SharedDockerTerminal.reap_if_orphaned(container, self.is_orphaned):
+                    self.logger.info(
+                        f"Reaped orphaned shared container {container.name}."
+                    )
+                    reaped.append(container.name)
+            except docker.errors.APIError as e:
+                self.logger.debug(f"Failed to reap container {container.name}: {e}")
+        return reaped
+
+    def reap_kubernetes(self) -> list[str]:
+        from kubernetes.client.rest import ApiException
+
+        reaped = []
+        pods = self.k8s_client.list_namespaced_pod(
+            namespace=self.namespace, label_selector=",".join(self._selectors())
+        ).items
+        for pod in pods:
+            if not self.is_orphaned(pod.metadata.labels):
+                continue
+            self.logger.info(f"Reaping orphaned pod {pod.metadata.name}.")
+            try:
+                self.k8s_client.delete_namespaced_pod(
+                    name=pod.metadata.name,
+                    namespace=self.namespace,
+                    grace_period_seconds=5,
+                )
+                reaped.append(pod.metadata.name)
+            except ApiException as e:
+                if e.status != 404:
+                    self.logger.debug(f"Failed to reap pod {pod.metadata.name}: {e}")
+        return reaped
+
+    def start(self, interval: int = 60):
+        """Reap orphaned sandboxes every `interval` seconds in a daemon thread."""
+
+        def loop():
+            while not self._stop_event.wait(interval):
+                try:
+                    self.reap()
+                except Exception as e:
+                    self.logger.debug(f"Failed to reap orphaned sandboxes: {e!r}")
+
+        self._stop_event.clear()
+        self._thread = threading.Thread(target=loop, name="debug-gym-reaper")
+        self._thread.daemon = True
+        self._thread.start()
+
+    def stop(self):
+        """Stop the reaper thread, after a last sweep."""
+        if self._thread is None:
+            return
+
+        self._stop_event.set()
+        self._thread.join()
+        self._thread = None
+        try:
+            self.reap()
+        except Exception as e:
+            self.logger.debug(f"Failed to reap orphaned sandboxes: {e!r}")
@@ -0,0 +1,370 @@
+import hashlib
+import json
+import re
+import uuid
+from typing import Callable
+
+import docker
+
+from debug_gym.gym.resources import RESOURCES
+from debug_gym.gym.terminals.docker import DockerTerminal
+from debug_gym.gym.terminals.reaper import (
+    OWNER_HOST_LABEL,
+    OWNER_PID_LABEL,
+    hostname,
+    owner_labels,
+)
+from debug_gym.gym.terminals.shell_session import ShellSession
+from debug_gym.gym.terminals.terminal import DISABLE_ECHO_COMMAND
+from debug_gym.logger import DebugGymLogger
+
+SHARED_TASKS_DIR = "/debug_gym_tasks"  # One working directory per task.
+SHARED_SLOTS_DIR = "/debug_gym_slots"  # One directory per claimed slot.
+TENANT_ENV_VAR = "DEBUG_GYM_TENANT"
+SHARED_GROUP_LABEL = "debug-gym.shared-group"
+
+# Maps `tenant_limits` keys to the `ulimit` flag enforcing them. The number of
+# processes is not limited: `ulimit -u` counts the processes of the user (all
+# tenants run as the same one), and is not enforced for root anyway.
+TENANT_LIMIT_FLAGS = {
+    "max_memory_kb": "-v",
+    "max_cpu_seconds": "-t",
+    "max_file_size_kb": "-f",
+    "max_open_files": "-n",
+}
+
+
+def _clean_for_docker(name: str) -> str:
+    """Clean a string so it can be used in a Docker container name."""
+    return re.sub(r"[^a-zA-Z0-9_.-]", "-", name).strip("-.")
+
+
+class SharedDockerTerminal(DockerTerminal):
+    """A DockerTerminal running several tasks concurrently inside one long-lived
+    container, instead of one container per task.
+
+    Each terminal (tenant) claims one of the `tasks_per_container` slots of a
+    container shared with other terminals of the same `group` and image. Slots
+    are claimed atomically with `mkdir` inside the container, so tenants living
+    in different processes (e.g., `run.py` workers) can share containers. Each
+    tenant has its own working directory, its commands run in their own process
+    group under optional `ulimit` limits (`tenant_limits`), and the last tenant
+    leaving a container stops it.
+    """
+
+    def __init__(
+        self,
+        working_dir: str | None = None,
+        session_commands: list[str] | None = None,
+        env_vars: dict[str, str] | None = None,
+        logger: DebugGymLogger | None = None,
+        # Docker-specific parameters
+        base_image: str | None = None,
+        registry: str = "",
+        setup_commands: list[str] | None = None,
+        # Sharing-specific parameters
+        tasks_per_container: int = 4,
+        group: str | None = None,
+        tenant_limits: dict[str, int] | None = None,
+        extra_labels: dict | None = None,
+        **kwargs,
+    ):
+        super().__init__(
+            working_dir=working_dir,
+            session_commands=session_commands,
+            env_vars=env_vars,
+            logger=logger,
+            base_image=base_image,
+            registry=registry,
+            setup_commands=setup_commands,
+            **kwargs,
+        )
+        if tasks_per_container < 1:
+            raise ValueError("tasks_per_container must be at least 1.")
+
+        unknown_limits = set(tenant_limits or {}) - set(TENANT_LIMIT_FLAGS)
+        if unknown_limits:
+            raise ValueError(
+                f"Unknown tenant limits: {sorted(unknown_limits)}. "
+                f"Choose from: {sorted(TENANT_LIMIT_FLAGS)}"
+            )
+
+        self.tasks_per_container = tasks_per_container
+        # By default, share containers across all tasks of the same experiment.
+        self._group = group or (extra_labels or {}).get("uuid")
+        self.tenant_limits = tenant_limits or {}
+        self.tenant_id = uuid.uuid4().hex[:12]
+        self._slot = None
+        # If True, the tenant's working directory is not emptied when set again,
+        # e.g., when its sandbox was reset in place (see `RepoEnv.reuse_sandbox`).
+        self.keep_tenant_dir = False
+
+    @property
+    def group(self) -> str:
+        """Tenants of the same group share containers. Without a group (nor an
+        experiment uuid), tenants share containers set up the same way."""
+        if self._group is not None:
+            return self._group
+        setup = [
+            f"{self.registry}{self.base_image}",
+            self.setup_commands,
+            self.env_vars,
+        ]
+        return hashlib.sha1(json.dumps(setup, sort_keys=True).encode()).hexdigest()[:12]
+
+    @property
+    def tenant_dir(self) -> str:
+        """Working directory of this task inside the shared container."""
+        return f"{SHARED_TASKS_DIR}/{self.tenant_id}"
+
+    @property
+    def working_dir(self):
+        """Lazy initialization of the working directory."""
+        return super().working_dir
+
+    @working_dir.setter
+    def working_dir(self, value):
+        # The container is shared, so the working directory is only a property
+        # of this tenant's commands and can change at any time.
+        self._working_dir = value
+        if (
+            self._container is not None
+            and value == self.tenant_dir
+            and not self.keep_tenant_dir
+        ):
+            self._reset_tenant_dir()
+
+    @property
+    def container_prefix(self) -> str:
+        image = _clean_for_docker(f"{self.registry}{self.base_image}")
+        return f"debug_gym_shared_{_clean_for_docker(self.group)}_{image}"
+
+    @property
+    def limits_command(self) -> str | None:
+        """`ulimit` command enforcing the tenant limits, if any."""
+        if not self.tenant_limits:
+            return None
+        limits = [
+            f"ulimit -S {TENANT_LIMIT_FLAGS[name]} {value}"
+            for name, value in sorted(self.tenant_limits.items())
+        ]
+        return " && ".join(limits)
+
+    @property
+    def default_shell_command(self) -> str:
+        """Interactive sessions start in the tenant's working directory and are
+        tagged with the tenant id so stray processes can be killed on close."""
+        return (
+            f"docker exec -t -i -w {self.working_dir} "
+            f"-e {TENANT_ENV_VAR}={self.tenant_id} {self.container.name} "
+            "/bin/bash --noprofile --norc --noediting"
+        )
+
+    def new_shell_session(self):
+        session_commands = [DISABLE_ECHO_COMMAND]
+        if self.limits_command:
+            session_commands.append(self.limits_command)
+        session = ShellSession(
+            shell_command=self.default_shell_command,
+            session_commands=session_commands + self.session_commands,
+            working_dir=".",
+            env_vars=self.env_vars,
+            logger=self.logger,
+        )
+        self.sessions.append(session)
+        return session
+
+    def prepare_command(self, entrypoint: str | list[str]) -> list[str]:
+        """Run the command in its own process group (setsid), tagged with
+        the tenant id and constrained by the tenant limits."""
+        if isinstance(entrypoint, str):
+            entrypoint = [entrypoint]
+        prefix = [f"export {TENANT_ENV_VAR}={self.tenant_id}"]
+        if self.limits_command:
+            prefix.append(self.limits_command)
+        _, _, command = super().prepare_command(prefix + entrypoint)
+        return ["setsid", "--wait", "/bin/bash", "-c", command]
+
+    def setup_container(self) -> docker.models.containers.Container:
+        """Claim a slot in a shared container, starting a new one if all
+        existing containers of this group are full."""
+        index = 0
+        while True:
+            container_name = f"{self.container_prefix}_{index}"
+            container = self._get_or_start_container(container_name)
+            if container is not None:
+                slot = self._claim_slot(container)
+                if slot is not None:
+                    break
+            index += 1
+
+        self._slot = slot
+        self.logger.debug(
+            f"Tenant {self.tenant_id} claimed slot {slot} of {container_name}."
+        )
+        self._run_exec(container, f"mkdir -p {self.tenant_dir}", raises=True)
+        RESOURCES.register(self.clean_up, "container slot")
+        return container
+
+    def _get_or_start_container(self, container_name: str):
+        """Return the running container with the given name, starting it if needed.
+        Returns None if the container exists but is not running (e.g., stopping)."""
+        try:
+            container = self.docker_client.containers.get(container_name)
+        except docker.errors.NotFound:
+            try:
+                return self._start_container(container_name)
+            except docker.errors.APIError as e:
+                if e.status_code != 409:
+                    raise
+                # Another tenant started it concurrently.
+                self.logger.debug(
+                    f"Container {container_name} started by another tenant."
+                )
+                container = self.docker_client.containers.get(container_name)
+
+        return container if container.status == "running" else None
+
+    def _start_container(self, container_name: str):
+        self.logger.debug(
+            f"Starting shared container {container_name} "
+            f"with image: {self.registry}{self.base_image}"
+        )
+        container = self.docker_client.containers.run(
+            name=container_name,
+            image=f"{self.registry}{self.base_image}",
+            command=[
+                "/bin/bash",
+                "-c",
+                f"mkdir -p {SHARED_TASKS_DIR} {SHARED_SLOTS_DIR} && sleep infinity",
+            ],
+            working_dir="/",
+            environment=self.env_vars,
+            # The host label lets the reaper stop the container once all its
+            # tenants are killed (see `reap_if_orphaned`).
+            labels=self.labels
+            | {SHARED_GROUP_LABEL: self.group, OWNER_HOST_LABEL: hostname()},
+            detach=True,
+            auto_remove=True,
+            remove=True,
+            tty=True,
+            stdin_open=True,
+            network_mode="host",
+            mem_limit="16G",
+        )
+        container.reload()  # Refresh container attributes (e.g., status="running")
+        self._run_setup_commands(container)
+        self.logger.debug(f"{container} ({container_name}) started successfully.")
+        return container
+
+    def _claim_slot(self, container) -> int | None:
+        """Atomically claim a free slot (mkdir fails if it already exists).
+        Returns None if the container is full or being retired."""
+        owner = owner_labels()  # The reaper checks the owner of each slot.
+        claim_command = (
+            # Give a freshly started container time to create its directories.
+            f"for _ in $(seq 50); do test -d {SHARED_SLOTS_DIR} && break; "
+            "sleep 0.1; done; "
+            f"for i in $(seq 0 {self.tasks_per_container - 1}); do "
+            f"mkdir {SHARED_SLOTS_DIR}/$i 2>/dev/null "
+            f"&& echo {self.tenant_id} > {SHARED_SLOTS_DIR}/$i/tenant "
+            f"&& echo '{owner[OWNER_HOST_LABEL]} {owner[OWNER_PID_LABEL]}' "
+            f"> {SHARED_SLOTS_DIR}/$i/owner "
+            "&& echo $i && exit 0; "
+            "done; exit 1"
+        )
+        success, output = self._run_exec(container, claim_command)
+        return int(output.strip()) if success else None
+
+    def _run_exec(self, container, command: str, raises: bool = False):
+        """Run a command directly in the container, bypassing the tenant wrapping."""
+        status, output = container.exec_run(["/bin/bash", "-c", command])
+        output = output.decode().strip()
+        if raises and status != 0:
+            raise ValueError(f"Failed to run command `{command}`:\n{output}")
+        return status == 0, output
+
+    def _reset_tenant_dir(self):
+        """Start the next task from an empty working directory."""
+        self.kill_tenant_processes()
+        self._run_exec(
+            self._container,
+            f"mkdir -p {self.tenant_dir} "
+            f"&& find {self.tenant_dir} -mindepth 1 -delete",
+            raises=True,
+        )
+
+    def kill_tenant_processes(self):
+        """Kill every process started by this tenant."""
+        self._run_exec(
+            self._container,
+            f"for p in /proc/[0-9]*; do "
+            f"grep -qsz '^{TENANT_ENV_VAR}={self.tenant_id}$' $p/environ "
+            "&& kill -9 ${p#/proc/} 2>/dev/null; done; true",
+        )
+
+    def clean_up(self):
+        """Release this tenant's slot. The last tenant stops the container."""
+        if self._container is None:
+            return
+
+        container = self._container
+        try:
+            self.kill_tenant_processes()
+            self._run_exec(
+                container,
+                f"rm -rf {self.tenant_dir} {SHARED_SLOTS_DIR}/{self._slot}",
+            )
+            # `rmdir` only succeeds once all slots are released, which also
+            # prevents new tenants from claiming a slot in a stopping container.
+            retired, _ = self._run_exec(container, f"rmdir {SHARED_SLOTS_DIR}")
+            if retired:
+                self.logger.debug(f"Stopping shared container {container.name}.")
+                container.stop(timeout=1)
+        except docker.errors.NotFound:
+            self.logger.debug(
+                f"Container {container.name} not found. "
+                "It might have already been removed."
+            )
+        self._container = None
+        self._slot = None
+        RESOURCES.unregister(self.clean_up)
+
+    @staticmethod
+    def reap_if_orphaned(container, is_orphaned: Callable[[dict], bool]) -> bool:
+        """Stop a shared container once the owners of all its slots are
+        orphaned (see `Reaper.is_orphaned`), e.g., all SIGKILLed, since no
+        tenant is left to stop it. Returns whether the container was stopped."""
+        status, output = container.exec_run(
+            [
+                "/bin/bash",
+                "-c",
+                f"cd {SHARED_SLOTS_DIR} || exit 1; for slot in *; do "
+                '[ -d "$slot" ] && echo "$slot $(cat $slot/owner 2>/dev/null)"; '
+                "done; true",
+            ]
+        )
+        if status != 0:
+            return False  # Starting or being retired.
+
+        slots = []
+        for line in output.decode().splitlines():
+            slot, *owner = line.split()
+            if len(owner) != 2:
+                return False  # Just claimed, the owner is not written yet.
+            host, pid = owner
+            if not is_orphaned({OWNER_HOST_LABEL: host, OWNER_PID_LABEL: pid}):
+                return False
+            slots.append(f"{SHARED_SLOTS_DIR}/{slot}")
+
+        if slots:
+            container.exec_run(["/bin/bash", "-c", f"rm -rf {' '.join(slots)}"])
+        # As in `clean_up`, `rmdir` fails if a tenant claimed a slot meanwhile.
+        status, _ = container.exec_run(["/bin/bash", "-c", f"rmdir {SHARED_SLOTS_DIR}"])
+        if status != 0:
+            return False
+        container.stop(timeout=1)
+        return True
+
+    def __str__(self):
+        return f"SharedDockerTerminal[{self.container}, {self.working_dir}]"
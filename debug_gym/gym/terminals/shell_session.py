@@ -1,4 +1,3 @@
-import atexit
 import errno
 import fcntl
 import os
@@ -16,10 +15,12 @@ from tenacity import (
     wait_random_exponential,
 )
 
+from debug_gym.gym.resources import RESOURCES
 from debug_gym.logger import DebugGymLogger
 
 DEFAULT_TIMEOUT = 300
 DEFAULT_PS1 = "DEBUG_GYM_PS1"
+INTERRUPT_CHARACTER = b"\x03"  # Ctrl-C
 
 
 class ProcessNotRunningError(Exception):
@@ -58,8 +59,6 @@ class ShellSession:
 
         self.default_read_until = self.env_vars["PS1"]
 
-        atexit.register(self.close)
-
     @property
     def is_running(self):
         return self.process is not None and self.process.poll() is None
@@ -86,8 +85,26 @@ class ShellSession:
             entrypoint = self.shell_command
 
         self.logger.debug(f"Starting {self} with entrypoint: {entrypoint}")
+        self._spawn(cmd_list)
+        RESOURCES.register(self.close, "shell session")
+
+        # Read the output until the sentinel or PS1
+        output = self.read(read_until=read_until)
 
-        # Prepare the file descriptor
+        if not self.is_running:
+            self.close()
+            self.logger.debug(f"{self} failed to start {entrypoint}. stderr:\n{output}")
+            raise ProcessNotRunningError(command=command, output=output)
+
+        # Run session commands after starting the session if command was not provided
+        if not command and self.session_commands:
+            command = " && ".join(self.session_commands)
+            output += self.run(command, read_until)
+
+        return output
+
+    def _spawn(self, cmd_list: list[str]):
+        """Start the shell process attached to a new PTY."""
         _server, _client = pty.openpty()
         self.filedescriptor = _server
 
@@ -115,22 +132,31 @@ class ShellSession:
         # close _client, end in the parent process
         os.close(_client)
 
-        # Read the output until the sentinel or PS1
-        output = self.read(read_until=read_until)
+    def _write(self, data: bytes):
+        """Write raw input to the shell."""
+        os.write(self.filedescriptor, data)
 
-        if not self.is_running:
-            self.close()
-            self.logger.debug(f"{self} failed to start {entrypoint}. stderr:\n{output}")
-            raise ProcessNotRunningError(command=command, output=output)
-
-        # Run session commands after starting the session if command was not provided
-        if not command and self.session_commands:
-            command = " && ".join(self.session_commands)
-            output += self.run(command, read_until)
-
-        return output
+    def _read_chunk(self, read_length: int) -> str:
+        """Read the output available, waiting briefly if there is none.
+        Raises EOFError once the shell's output is closed."""
+        try:
+            data = os.read(self.filedescriptor, read_length)
+        except BlockingIOError:
+            time.sleep(0.1)
+            return ""
+        except OSError as e:
+            if e.errno == errno.EIO:
+                raise EOFError from e
+            if e.errno != errno.EAGAIN:
+                raise
+            return ""
+
+        if not data:
+            time.sleep(0.01)
+        return data.decode("utf-8", errors="ignore")
 
     def close(self):
+        RESOURCES.unregister(self.close)
         if self.filedescriptor is not None:
             self.logger.debug(f"Closing {self}.")
             os.close(self.filedescriptor)
@@ -160,25 +186,16 @@ class ShellSession:
                 )
 
             try:
-                data = os.read(self.filedescriptor, read_length).decode(
-                    "utf-8", errors="ignore"
-                )
-                if data:
-                    output += data
-                    if read_until and read_until in output:
-                        break
-                else:
-                    time.sleep(0.01)
-            except BlockingIOError:
-                time.sleep(0.1)
-                continue
-            except OSError as e:
-                if e.errno == errno.EIO:
-                    self.is_closed = True
-                    self.logger.debug("End of file reached while reading from PTY.")
+                data = self._read_chunk(read_length)
+            except EOFError:
+                self.is_closed = True
+                self.logger.debug("End of file reached while reading from PTY.")
+                break
+
+            if data:
+                output += data
+                if read_until and read_until in output:
                     break
-                if e.errno != errno.EAGAIN:
-                    raise
 
         output = output.replace(read_until, "").strip()
         if strip_output:
@@ -190,26 +207,48 @@ class ShellSession:
         command: str,
         read_until: str | None = None,
         timeout: int | None = None,
+        close_on_timeout: bool = True,
     ):
-        """Run a command in the Shell session and return the output."""
+        """Run a command in the Shell session and return the output.
+        If `close_on_timeout` is False, the session is left running on timeout,
+        e.g., so the command can be interrupted with `interrupt()`."""
         output = ""
         if not self.is_running:
             output += self.start()
             self.logger.debug(f"{self}: Initial output: {output!r}")
 
         self.logger.debug(f"{self}: Running {command!r}")
-        os.write(self.filedescriptor, command.encode("utf-8") + b"\n")
+        self._write(command.encode("utf-8") + b"\n")
 
         try:
             output += self.read(read_until=read_until, timeout=timeout)
         except TimeoutError as e:
-            self.close()
+            if close_on_timeout:
+                self.close()
             self.logger.debug(f"{e!r}")
             raise
 
         self.logger.debug(f"{self}: Output: {output!r}")
         return output
 
+    def interrupt(
+        self,
+        read_until: str | None = None,
+        timeout: int | None = None,
+    ) -> str:
+        """Interrupt the running command as Ctrl-C would, i.e. the PTY sends SIGINT
+        to its foreground process group (forwarded to the container's TTY by
+        `docker exec -t` or `kubectl exec -t`). Return the output read until
+        read_until. Raises TimeoutError if read_until is not found in time."""
+        if not self.is_running:
+            raise ProcessNotRunningError(command="interrupt", output="")
+
+        self.logger.debug(f"{self}: Interrupting the running command.")
+        self._write(INTERRUPT_CHARACTER)
+        output = self.read(read_until=read_until, timeout=timeout)
+        self.logger.debug(f"{self}: Output: {output!r}")
+        return output
+
     def __str__(self):
         return f"Shell[{self._session_id}]"
 
@@ -1,8 +1,8 @@
-import atexit
 import tempfile
 from abc import ABC, abstractmethod
 from pathlib import Path
 
+from debug_gym.gym.resources import RESOURCES
 from debug_gym.gym.terminals.shell_session import DEFAULT_PS1
 from debug_gym.logger import DebugGymLogger
 
@@ -30,6 +30,7 @@ class Terminal(ABC):
         self.env_vars["PYTHONDONTWRITEBYTECODE"] = "1"  # prevent creation of .pyc files
 
         self._working_dir = working_dir
+        self._tempdir = None  # Temporary working directory, if none was given.
         self.sessions = []
 
         if kwargs:
@@ -39,9 +40,10 @@ class Terminal(ABC):
     def working_dir(self):
         """Lazy initialization of the working directory."""
         if self._working_dir is None:
-            _tempdir = tempfile.TemporaryDirectory(prefix="Terminal-")
-            atexit.register(_tempdir.cleanup)
-            self._working_dir = str(Path(_tempdir.name).resolve())
+            # Deleted along with the terminal, or at exit.
+            self._tempdir = tempfile.TemporaryDirectory(prefix="Terminal-")
+            RESOURCES.register(self._tempdir.cleanup, "temporary directory")
+            self._working_dir = str(Path(self._tempdir.name).resolve())
             self.logger.debug(f"Using temporary working directory: {self._working_dir}")
         return self._working_dir
 
@@ -80,7 +82,7 @@ class Terminal(ABC):
         self.sessions.remove(session)
 
     def close(self):
-        for session in self.sessions:
+        for session in list(self.sessions):
             self.close_shell_session(session)
 
     def __str__(self):
@@ -7,4 +7,5 @@ from debug_gym.gym.tools.rewrite import RewriteTool
 from debug_gym.gym.tools.submit import SubmitTool
 from debug_gym.gym.tools.tool import EnvironmentTool
 from debug_gym.gym.tools.toolbox import Toolbox
+from debug_gym.gym.tools.trace import TraceTool
 from debug_gym.gym.tools.view import ViewTool
@@ -12,12 +12,14 @@ class EvalTool(EnvironmentTool):
     arguments = {}
 
     def use(self, environment) -> Observation:
-        eval_output = environment.eval()
+        # Only the tests impacted by the changes, if enabled (see `RepoEnv.test_impact`).
+        eval_output = environment.eval(impacted_tests_only=True)
         return Observation(self.name, eval_output.output)
 
     def on_env_reset(self, environment, **kwargs):
         super().on_env_reset(environment, **kwargs)
-        return self(environment)
+        # All the tests, for the initial observation.
+        return Observation(self.name, environment.eval().output)
 
     def on_rewrite_success(self, environment, **kwargs):
         if environment.auto_eval_on_rewrite:
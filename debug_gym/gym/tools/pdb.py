@@ -1,5 +1,6 @@
 import copy
 import re
+import shlex
 
 from debug_gym.gym.entities import Observation
 from debug_gym.gym.terminals.shell_session import ProcessNotRunningError, ShellSession
@@ -7,6 +8,16 @@ from debug_gym.gym.tools.tool import EnvironmentTool
 from debug_gym.gym.tools.toolbox import Toolbox
 
 
+def with_startup_commands(entrypoint: str, commands: list[str]) -> str:
+    """Pass `commands` to pdb as start-up commands (`-c`), run before the first
+    prompt, e.g. `python -m pdb -m pytest` becomes `python -m pdb -c 'b a.py:1'
+    -m pytest`. The entrypoint is returned as is if it does not run `-m pdb`."""
+    options = " ".join(f"-c {shlex.quote(command)}" for command in commands)
+    if not options:
+        return entrypoint
+    return re.sub(r"-m pdb(?=\s|$)", lambda m: f"-m pdb {options}", entrypoint, 1)
+
+
 @Toolbox.register()
 class PDBTool(EnvironmentTool):
     name: str = "pdb"
@@ -21,6 +32,7 @@ class PDBTool(EnvironmentTool):
         "An interface to the Python debugger PDB. Send a command to the PDB terminal. The command should be a valid PDB command."
         + "\nWhen using the breakpoint command (e.g., 'b', 'break', 'cl', 'clear'), make sure you specify the file path and line number in the format `file_path:line_number`."
         + "\nPDB sessions are restarted upon successful rewrite, or if the entrypoint changes. Breakpoints are persistent across PDB sessions and will be restored automatically."
+        + "\nCommands exceeding the timeout (e.g., `c` over an infinite loop) are interrupted, stopping the execution where it was."
         + "\nExamples (for demonstration purposes only, you need to adjust the tool calling format according to your specific syntax):"
         + "\n".join(examples)
     )
@@ -35,12 +47,23 @@ class PDBTool(EnvironmentTool):
         },
     }
 
-    def __init__(self, set_default_entrypoint: bool = True):
+    def __init__(
+        self,
+        set_default_entrypoint: bool = True,
+        interrupt_timeout: int = 10,
+        failing_tests_only: bool = True,
+    ):
         super().__init__()
+        # Time to wait for the prompt after interrupting a command that timed out.
+        self.interrupt_timeout = interrupt_timeout
+        # Whether the default entrypoint only runs the tests that failed in the
+        # last eval (see `RepoEnv.targeted_debug_entrypoint`), or all of them.
+        self.failing_tests_only = failing_tests_only
         self.current_frame_file = None
         self._session: ShellSession = None
         self.set_default_entrypoint = set_default_entrypoint
         self.entrypoint = None
+        self._default_entrypoint = None
         if not self.set_default_entrypoint:
             # Force the agent to provide an entrypoint when using the tool.
             self.arguments = copy.deepcopy(
@@ -55,6 +78,8 @@ class PDBTool(EnvironmentTool):
             )
         else:
             self.description += "\nNote: You can optionally specify an 'entrypoint' argument to control how the PDB session is started. If not provided, the environment's default debug entrypoint will be used."
+            if self.failing_tests_only:
+                self.description += " It only runs the tests that failed in the last evaluation, provide an entrypoint to run other tests."
 
     def __getstate__(self):
         """Handles serialisation of the PDBTool instance (for pickle) without un-picklable attributes"""
@@ -92,12 +117,29 @@ class PDBTool(EnvironmentTool):
 
     def interact_with_pdb(self, command: str, timeout: int | None = None) -> str:
         try:
-            output = self._session.run(command, read_until="(Pdb)", timeout=timeout)
+            output = self._session.run(
+                command, read_until="(Pdb)", timeout=timeout, close_on_timeout=False
+            )
         except TimeoutError as e:
             output = f"The command `{command}` has timed out. {e!r}"
+            output += "\n" + self.interrupt_pdb()
 
         return output.replace("(Pdb)", "").strip()  # remove the prompt
 
+    def interrupt_pdb(self) -> str:
+        """Interrupt the running command (SIGINT) and wait for the prompt, which
+        is cheaper than restarting pdb and restoring the breakpoints. The session
+        is closed, to be restarted, only if the interrupt fails."""
+        try:
+            output = self._session.interrupt(
+                read_until="(Pdb)", timeout=self.interrupt_timeout
+            )
+            return f"Execution was interrupted:\n{output}"
+        except (TimeoutError, ProcessNotRunningError) as e:
+            self._session.logger.debug(f"Failed to interrupt pdb: {e!r}")
+            self.stop_pdb()
+            return "Failed to interrupt the execution, the debugging session will be restarted."
+
     def stop_pdb(self):
         self.current_frame_file = None
         if self._session is not None:
@@ -106,26 +148,45 @@ class PDBTool(EnvironmentTool):
     def start_pdb(self, environment) -> str:
         self._session = environment.terminal.new_shell_session()
         # init pdb and wait for the prompt
-        self.entrypoint = self.entrypoint or environment.debug_entrypoint
-        initial_output = self._session.start(self.entrypoint, read_until="(Pdb)")
+        if self.entrypoint in (None, self._default_entrypoint):
+            # Not chosen by the agent, follow the failing tests of the last eval.
+            self.entrypoint = self.default_entrypoint(environment)
+            self._default_entrypoint = self.entrypoint
+        breakpoints = []
+        if environment.persistent_breakpoints:
+            breakpoints = list(environment.current_breakpoints_state.values())
+        entrypoint = with_startup_commands(self.entrypoint, breakpoints)
+        initial_output = self._session.start(entrypoint, read_until="(Pdb)")
 
         if "The program finished and will be restarted" in initial_output:
             self.stop_pdb()
 
         if self.pdb_is_running:
-            if environment.persistent_breakpoints:
-                # restore persistent breakpoints
-                for _, _command in environment.current_breakpoints_state.items():
+            if breakpoints and entrypoint == self.entrypoint:
+                # pdb is not started with `-m pdb`, set the breakpoints one by one.
+                for _command in breakpoints:
                     self.interact_with_pdb(_command, environment.run_timeout)
-                if len(environment.current_breakpoints_state) > 0:
-                    initial_output = "\n".join(
-                        [initial_output, "Breakpoints have been restored."]
-                    )
+            elif breakpoints:
+                # Hide the output of the start-up commands, before the first frame.
+                lines = initial_output.splitlines()
+                frame = next(
+                    (i for i, line in enumerate(lines) if line.startswith("> ")), 0
+                )
+                initial_output = "\n".join(lines[frame:])
+            if breakpoints:
+                initial_output = "\n".join(
+                    [initial_output, "Breakpoints have been restored."]
+                )
 
             self.set_current_frame_file(environment)
 
         return initial_output
 
+    def default_entrypoint(self, environment) -> str:
+        if self.failing_tests_only:
+            return environment.targeted_debug_entrypoint()
+        return environment.debug_entrypoint
+
     def on_env_reset(self, environment, **kwargs) -> Observation:
         super().on_env_reset(environment, **kwargs)
         obs = self.start_pdb(environment)
@@ -159,7 +220,9 @@ class PDBTool(EnvironmentTool):
             )
 
         # Set the entrypoint. Priority: tool argument > last entrypoint > default entrypoint.
-        entrypoint = entrypoint or self.entrypoint or environment.debug_entrypoint
+        if not (entrypoint or self.entrypoint):
+            self._default_entrypoint = self.default_entrypoint(environment)
+        entrypoint = entrypoint or self.entrypoint or self._default_entrypoint
 
         # Check if we need to restart pdb due to a different entrypoint.
         if entrypoint != self.entrypoint:
@@ -215,7 +278,9 @@ class PDBTool(EnvironmentTool):
                     output = f"Invalid line number: {pdb_out}."
                 else:
                     output += f"Pdb command output:\n{pdb_out}"
-                self.update_breakpoints(environment)
+                # The session is closed if a timed out command was not interrupted.
+                if self.pdb_is_running:
+                    self.update_breakpoints(environment)
             except Exception:
                 success = False
 
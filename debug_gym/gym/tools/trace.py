@@ -0,0 +1,226 @@
+import json
+import uuid
+from collections import defaultdict
+
+from debug_gym.gym.entities import Observation
+from debug_gym.gym.tools.tool import EnvironmentTool
+from debug_gym.gym.tools.toolbox import Toolbox
+from debug_gym.gym.utils import trace_entrypoint
+from debug_gym.gym.workspace import SANDBOX_SCRIPTS_DIR
+
+TRACE_SCRIPT = "trace_index.py"
+
+
+@Toolbox.register()
+class TraceTool(EnvironmentTool):
+    name: str = "trace"
+    examples = [
+        """trace(query="functions", target=None) to list the functions of the repository executed when running the tests, with their number of calls.""",
+        """trace(query="callers", target="utils.py:parse") to list the functions that called `parse` from 'utils.py'.""",
+        """trace(query="callees", target="Parser.run") to list the functions called by the method `run` of the class `Parser`.""",
+        """trace(query="lines", target="src/code.py:10-30") to show how many times lines 10 to 30 of 'src/code.py' were executed.""",
+        """trace(query="values", target="parse") to show sampled argument and return values of the function `parse`.""",
+        """trace(query="functions", entrypoint="python -m pytest tests/test_app.py::test_parse") to trace a specific test instead of the default entrypoint.""",
+    ]
+    description = (
+        "Query an execution trace of the program, collected by running it once with a lightweight tracer. "
+        "The trace records which functions of the repository called which, how many times each line was executed, and a few sampled argument and return values per function. "
+        "Use it to learn what ran on the failing path without stepping through the debugger. "
+        "Functions are identified as `file_path:QualifiedName`, and can be referred to by a suffix of this identifier (e.g., `Class.method` or `method`). "
+        "The trace is collected again after each rewrite, or if the entrypoint changes."
+        "\nExamples (for demonstration purposes only, you need to adjust the tool calling format according to your specific syntax):\n"
+        + "\n".join(examples)
+    )
+    arguments = {
+        "query": {
+            "type": ["string"],
+            "description": "The query to answer from the trace: 'functions' (executed functions and their number of calls), 'callers' or 'callees' (of a function), 'lines' (hit counts of the lines of a file) or 'values' (sampled arguments and return values of a function).",
+        },
+        "target": {
+            "type": ["string", "null"],
+            "description": "The function to query (for 'callers', 'callees' and 'values'), or the file to query, optionally followed by a line number or range, e.g., 'src/code.py:10-30' (for 'lines'). For 'functions', an optional file path to filter the results.",
+        },
+        "entrypoint": {
+            "type": ["string", "null"],
+            "description": "The python command to trace. If null, the last provided entrypoint or the environment's entrypoint (restricted to the failing tests) will be used, in priority order.",
+        },
+    }
+
+    def __init__(self, max_results: int = 50):
+        super().__init__()
+        self.max_results = max_results
+        self.entrypoint = None
+        self.index = None
+        self.index_file = f"{SANDBOX_SCRIPTS_DIR}/trace-{uuid.uuid4().hex[:8]}.json"
+
+    def use(
+        self,
+        environment,
+        query: str,
+        target: str | None = None,
+        entrypoint: str | None = None,
+    ) -> Observation:
+        queries = {
+            "functions": self.query_functions,
+            "callers": self.query_callers,
+            "callees": self.query_callees,
+            "lines": self.query_lines,
+            "values": self.query_values,
+        }
+        if query not in queries:
+            return Observation(
+                self.name,
+                f"Invalid query `{query}`. Choose from: {', '.join(queries)}.",
+            )
+        if query != "functions" and not target:
+            return Observation(self.name, f"The `{query}` query requires a target.")
+
+        if entrypoint is not None:
+            entrypoint = environment._prepare_entrypoint(entrypoint)
+            if entrypoint != self.entrypoint:
+                self.entrypoint = entrypoint
+                self.index = None
+
+        if self.index is None:
+            error = self.collect_trace(environment)
+            if error:
+                return Observation(self.name, error)
+
+        return Observation(self.name, queries[query](target))
+
+    def collect_trace(self, environment) -> str | None:
+        """Run the entrypoint once under the tracer and load the resulting index.
+        Returns an error message if the trace could not be collected."""
+        entrypoint = self.entrypoint or environment.targeted_entrypoint()
+        script = environment.workspace.upload_script(TRACE_SCRIPT)
+        command = trace_entrypoint(
+            entrypoint, script, str(environment.workspace.working_dir), self.index_file
+        )
+        # The traced program is expected to fail, e.g. failing tests.
+        _, output = environment.terminal.run(
+            f"rm -f {self.index_file}; {command}", timeout=environment.run_timeout
+        )
+        success, index = environment.terminal.run(f"cat {self.index_file}")
+        if not success:
+            return f"Failed to collect the trace of `{entrypoint}`:\n{output}"
+
+        self.index = json.loads(index)
+        return None
+
+    def invalidate(self):
+        self.index = None
+
+    def on_env_reset(self, environment, **kwargs):
+        super().on_env_reset(environment, **kwargs)
+        self.entrypoint = None
+        self.invalidate()
+        return None
+
+    def on_rewrite_success(self, environment, **kwargs):
+        self.invalidate()
+        return None
+
+    def on_file_change(self, environment, changes, **kwargs):
+        # Code changed by other means than the rewrite tool (e.g., bash).
+        if any(
+            path.endswith(".py") or kind in ("deleted", "overflow")
+            for path, kind in changes.items()
+        ):
+            self.invalidate()
+        return None
+
+    def match_functions(self, target: str) -> list[str]:
+        """Functions whose identifier is `target` or ends with it (at a `/`, `:`
+        or `.` boundary)."""
+        return sorted(
+            key
+            for key in self.index["functions"]
+            if key == target or any(key.endswith(f"{sep}{target}") for sep in "/:.")
+        )
+
+    def _truncate(self, lines: list[str]) -> str:
+        if len(lines) > self.max_results:
+            omitted = len(lines) - self.max_results
+            lines = lines[: self.max_results] + [f"... ({omitted} more)"]
+        return "\n".join(lines)
+
+    def _no_match(self, target: str) -> str:
+        return f"No executed function matches `{target}`."
+
+    def query_functions(self, target: str | None = None) -> str:
+        functions = [
+            (info["calls"], key)
+            for key, info in self.index["functions"].items()
+            if not target or key.split(":")[0] == target.strip("/")
+        ]
+        if not functions:
+            return "No function was executed."
+        functions.sort(key=lambda x: (-x[0], x[1]))
+        return self._truncate([f"{key} ({calls} calls)" for calls, key in functions])
+
+    def _query_edges(self, target: str, callers: bool) -> str:
+        functions = self.match_functions(target)
+        if not functions:
+            return self._no_match(target)
+
+        edges = defaultdict(list)
+        for caller, callee, count in self.index["edges"]:
+            if callers and callee in functions:
+                edges[callee].append(f"  {caller} ({count} calls)")
+            elif not callers and caller in functions:
+                edges[caller].append(f"  {callee} ({count} calls)")
+
+        relation = "Callers of" if callers else "Functions called by"
+        lines = []
+        for function in functions:
+            lines.append(f"{relation} {function}:")
+            lines += edges[function] or ["  None"]
+        return self._truncate(lines)
+
+    def query_callers(self, target: str) -> str:
+        return self._query_edges(target, callers=True)
+
+    def query_callees(self, target: str) -> str:
+        return self._query_edges(target, callers=False)
+
+    def query_lines(self, target: str) -> str:
+        path, _, line_range = target.partition(":")
+        path = path.strip("/")
+        try:
+            start, _, end = line_range.partition("-")
+            start = int(start) if start else None
+            end = int(end) if end else start
+        except ValueError:
+            return f"Invalid line range `{line_range}`, expected `start-end`."
+
+        hits = self.index["lines"].get(path)
+        if hits is None:
+            return f"No line of `{path}` was executed."
+        if start is None:
+            lines = [
+                f"{path}:{lineno} ({count} hits)" for lineno, count in hits.items()
+            ]
+            return self._truncate(lines)
+
+        lines = []
+        for lineno in range(start, end + 1):
+            count = hits.get(str(lineno))
+            status = f"executed {count} times" if count else "not executed"
+            lines.append(f"{path}:{lineno} {status}")
+        return self._truncate(lines)
+
+    def query_values(self, target: str) -> str:
+        functions = self.match_functions(target)
+        if not functions:
+            return self._no_match(target)
+
+        lines = []
+        for function in functions:
+            info = self.index["functions"][function]
+            lines.append(f"{function} ({info['calls']} calls), sampled values:")
+            for i, args in enumerate(info["args"]):
+                args = ", ".join(f"{name}={value}" for name, value in args.items())
+                lines.append(f"  call {i + 1}: ({args})")
+            for i, value in enumerate(info["returns"]):
+                lines.append(f"  return {i + 1}: {value}")
+        return self._truncate(lines)
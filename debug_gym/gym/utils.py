@@ -54,13 +54,13 @@ def show_line_number(code_string, code_path=None, environment=None, start_index=
     return "\n".join(output)
 
 
-def make_file_matcher(
+def make_file_rules(
     base_dir: str | Path,
     pattern_files: list[str | Path] | str | Path,
     patterns: list[str] | None = None,
-) -> Callable[[str | Path], bool]:
+) -> list:
     """
-    Creates a file matcher function based on ignore patterns from files and additional patterns.
+    Parses gitignore-like patterns from files and additional patterns into rules.
 
     Args:
         base_dir (str | Path): The base directory to normalize the patterns against.
@@ -68,10 +68,10 @@ def make_file_matcher(
         patterns (list[str]): Additional patterns to include. Defaults to an empty list.
 
     Returns:
-        function: A function that takes a file path as input and returns True if the file matches any of the patterns, False otherwise.
+        list: The rules (`gitignore_parser.IgnoreRule`), in order of precedence (later rules override earlier ones).
     """
     # Ref: gitignore_parser.parse_gitignore
-    from gitignore_parser import _normalize_path, handle_negation, rule_from_pattern
+    from gitignore_parser import _normalize_path, rule_from_pattern
 
     if patterns is None:
         patterns = []
@@ -97,6 +97,31 @@ def make_file_matcher(
         rule = rule_from_pattern(line.rstrip("\n"), base_dir, ("multiple_files", i))
         if rule:
             rules.append(rule)
+    return rules
+
+
+def make_file_matcher(
+    base_dir: str | Path,
+    pattern_files: list[str | Path] | str | Path,
+    patterns: list[str] | None = None,
+) -> Callable[[str | Path], bool]:
+    """
+    Creates a file matcher function based on ignore patterns from files and additional patterns.
+
+    Args:
+        base_dir (str | Path): The base directory to normalize the patterns against.
+        pattern_files (list[str | Path] | str | Path): Path(s) to file(s) containing gitignore-like patterns.
+        patterns (list[str]): Additional patterns to include. Defaults to an empty list.
+
+    Returns:
+        function: A function that takes a file path as input and returns True if the file matches any of the patterns, False otherwise.
+    """
+    return make_rules_matcher(make_file_rules(base_dir, pattern_files, patterns))
+
+
+def make_rules_matcher(rules: list) -> Callable[[str | Path], bool]:
+    """Creates a file matcher function from rules parsed by `make_file_rules`."""
+    from gitignore_parser import handle_negation
 
     if not any(r.negation for r in rules):
         return lambda file_path: any(r.match(file_path) for r in rules)
@@ -195,6 +220,37 @@ def extract_reward_from_pytest_output(output):
     return 0
 
 
+def trace_entrypoint(entrypoint: str, script: str, root: str, index_file: str) -> str:
+    """Insert the tracer script between the python interpreter (and its options)
+    and the program to run, e.g. `python -W ignore -m pytest` becomes
+    `python -W ignore <script> <root> <index_file> -m pytest`. A `pytest`
+    command is run as `python -m pytest` (with the python of its directory)."""
+    tokens = entrypoint.split()
+    for i, token in enumerate(tokens):
+        if token == "python" or token.endswith("/python"):
+            break
+        if token == "pytest" or token.endswith("/pytest"):
+            tokens[i : i + 1] = [
+                token.removesuffix("pytest") + "python",
+                "-m",
+                "pytest",
+            ]
+            break
+    else:
+        raise ValueError(
+            f"Cannot trace `{entrypoint}`, the entrypoint must run a python program."
+        )
+
+    i += 1
+    while (
+        i < len(tokens) and tokens[i].startswith("-") and tokens[i] not in ("-m", "-c")
+    ):
+        # Interpreter options taking a value, e.g. `-W ignore`.
+        i += 2 if tokens[i] in ("-W", "-X") else 1
+
+    return " ".join(tokens[:i] + [script, root, index_file] + tokens[i:])
+
+
 def filter_problems(
     dataset: dict[str, Any],
     problems: str | list[str] | None = None,
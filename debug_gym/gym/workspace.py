@@ -1,13 +1,36 @@
-import atexit
+import hashlib
+import json
 import os
+import shlex
 import tempfile
+from dataclasses import dataclass
+from importlib.resources import files as importlib_files
 from pathlib import Path
 
+from debug_gym.gym.resources import RESOURCES
 from debug_gym.gym.terminals.local import LocalTerminal
+from debug_gym.gym.terminals.shared_docker import SharedDockerTerminal
 from debug_gym.gym.terminals.terminal import Terminal
-from debug_gym.gym.utils import make_file_matcher
+from debug_gym.gym.utils import make_file_rules, make_rules_matcher
 from debug_gym.logger import DebugGymLogger
 
+SANDBOX_SNAPSHOT_ARCHIVE = "/var/tmp/debug_gym_snapshot/restore.tar"
+SANDBOX_SCRIPTS_DIR = "/tmp/debug_gym_scripts"
+SANDBOX_PYCACHE_DIR = "/tmp/debug_gym_pycache"  # See `RepoEnv.bytecode_cache`.
+
+
+@dataclass
+class SandboxSnapshot:
+    """State of a sandbox right after its setup, used to reset it in place."""
+
+    key: tuple  # Identifies the setup that produced this state.
+    commit: str
+    preserved_paths: list[str]  # Untracked paths present after setup.
+    restore_paths: list[str]  # Paths outside the repository restored on reset.
+    archived_paths: list[str]  # Subset of `restore_paths` present after setup.
+    verify_paths: list[str]  # Paths outside the repository only verified on reset.
+    manifest: str
+
 
 class Workspace:
 
@@ -16,11 +39,16 @@ class Workspace:
         self.working_dir = None
         self.logger = logger or DebugGymLogger("debug-gym")
         self.terminal = terminal
+        self._file_watcher_pid = None
+        self._file_changes_dir = None
+        self._file_changes_polls = 0
 
     def cleanup(self):
+        self.stop_watching_files()
         self.working_dir = None
         if self._tempdir:
             self._tempdir.cleanup()
+            RESOURCES.unregister(self._tempdir.cleanup)
             self._tempdir = None
 
     def reset(
@@ -34,8 +62,11 @@ class Workspace:
         # only create temp dir for local terminal
         if type(self.terminal) is LocalTerminal:
             self._tempdir = tempfile.TemporaryDirectory(prefix="DebugGym-")
-            atexit.register(self._tempdir.cleanup)
+            RESOURCES.register(self._tempdir.cleanup, "temporary directory")
             self.working_dir = Path(self._tempdir.name).resolve()
+        elif isinstance(self.terminal, SharedDockerTerminal):
+            # Tasks sharing a container each have their own working directory.
+            self.working_dir = Path(self.terminal.tenant_dir)
 
         self.logger.debug(f"Working directory: {self.working_dir}")
         self.terminal.working_dir = str(self.working_dir)
@@ -50,6 +81,7 @@ class Workspace:
         directory, applying ignore and readonly patterns."""
         self._is_readonly_func = lambda f: False
         self._is_ignored_func = lambda f: False
+        self._file_filters = json.dumps({"base": "/", "ignore": [], "readonly": []})
 
         readonly_patterns = readonly_patterns or []
         ignore_patterns = ignore_patterns or []
@@ -75,18 +107,29 @@ class Workspace:
         )
 
         # create a matcher function for ignored files, .debugignore has precedence over .gitignore
-        self._is_ignored_func = make_file_matcher(
+        ignore_rules = make_file_rules(
             base_dir=self.working_dir,
             pattern_files=[],
             patterns=ignore_patterns,
         )
+        self._is_ignored_func = make_rules_matcher(ignore_rules)
 
         # create a matcher function for readonly files
-        self._is_readonly_func = make_file_matcher(
+        readonly_rules = make_file_rules(
             base_dir=self.working_dir,
             pattern_files=[],
             patterns=readonly_patterns,
         )
+        self._is_readonly_func = make_rules_matcher(readonly_rules)
+
+        # The same filters, applied in the sandbox when listing files.
+        self._file_filters = json.dumps(
+            {
+                "base": str(self.working_dir),
+                "ignore": [[r.regex, r.negation] for r in ignore_rules],
+                "readonly": [[r.regex, r.negation] for r in readonly_rules],
+            }
+        )
 
     def copy_content(self, src: str | Path, target: str | Path | None = None):
         """Copy files contained in src to a target directory."""
@@ -94,6 +137,132 @@ class Workspace:
         target = Path(target or self.working_dir).resolve()
         self.terminal.copy_content(src, target)
 
+    def snapshot(
+        self,
+        key: tuple,
+        restore_paths: list[str] | None = None,
+        verify_paths: list[str] | None = None,
+    ) -> SandboxSnapshot:
+        """Record the current state of the sandbox, so `restore` can bring it back
+        to that state. `restore_paths` are absolute paths outside the repository
+        (e.g., modified during setup) to archive, and `verify_paths` are absolute
+        paths outside the repository to only check for modifications."""
+        restore_paths = restore_paths or []
+        verify_paths = verify_paths or []
+
+        _, commit = self.terminal.run("git rev-parse HEAD", raises=True)
+        # Untracked and ignored paths (e.g., virtualenvs) are kept by `git clean`.
+        _, preserved_paths = self.terminal.run(
+            "git ls-files --others --directory", raises=True
+        )
+        preserved_paths = [path.rstrip("/") for path in preserved_paths.splitlines()]
+
+        archived_paths = []
+        if restore_paths:
+            _, archived_paths = self.terminal.run(
+                f"for p in {_quote(restore_paths)}; do "
+                '[ -e "$p" -o -L "$p" ] && echo "$p"; done; true'
+            )
+            archived_paths = archived_paths.splitlines()
+
+        if archived_paths:
+            # POSIX format keeps sub-second timestamps, required by the manifest.
+            relative_paths = [path.lstrip("/") for path in archived_paths]
+            self.terminal.run(
+                f"mkdir -p {os.path.dirname(SANDBOX_SNAPSHOT_ARCHIVE)} && "
+                f"tar --format=posix -cpf {SANDBOX_SNAPSHOT_ARCHIVE} "
+                f"-C / {_quote(relative_paths)}",
+                raises=True,
+            )
+
+        snapshot = SandboxSnapshot(
+            key=key,
+            commit=commit,
+            preserved_paths=preserved_paths,
+            restore_paths=restore_paths,
+            archived_paths=archived_paths,
+            verify_paths=verify_paths,
+            manifest="",
+        )
+        snapshot.manifest = self.sandbox_manifest(snapshot)
+        return snapshot
+
+    def restore(self, snapshot: SandboxSnapshot) -> bool:
+        """Restore the files of the sandbox to the state recorded in `snapshot`.
+        Returns whether the restored sandbox matches the snapshot's manifest."""
+        excludes = " ".join(
+            f"-e {shlex.quote('/' + path)}" for path in snapshot.preserved_paths
+        )
+        commands = [
+            f"git reset -q --hard {snapshot.commit}",
+            f"git clean -ffdxq {excludes}".rstrip(),
+        ]
+        if snapshot.restore_paths:
+            # Directories are restored from scratch, while files are overwritten
+            # in place since some might be mount points (e.g., /etc/hosts).
+            archived = f" {' '.join(snapshot.archived_paths)} "
+            commands.append(
+                f"for p in {_quote(snapshot.restore_paths)}; do "
+                f'case "{archived}" in *" $p "*) '
+                '[ -d "$p" -a ! -L "$p" ] && rm -rf "$p";; '
+                '*) rm -rf "$p";; esac; done; true'
+            )
+        if snapshot.archived_paths:
+            commands.append(f"tar -xpf {SANDBOX_SNAPSHOT_ARCHIVE} -C / --overwrite")
+
+        for command in commands:
+            success, output = self.terminal.run(command)
+            if not success:
+                self.logger.debug(f"Failed to restore the sandbox: {output}")
+                return False
+
+        manifest = self.sandbox_manifest(snapshot)
+        if manifest != snapshot.manifest:
+            self.logger.debug(
+                f"Restored sandbox does not match its snapshot: "
+                f"{manifest} != {snapshot.manifest}"
+            )
+            return False
+
+        return True
+
+    def sandbox_manifest(self, snapshot: SandboxSnapshot) -> str:
+        """Checksum of the repository state (commit, modified and untracked files)
+        and of the metadata of the preserved, restored and verified paths."""
+        paths = snapshot.preserved_paths + snapshot.restore_paths
+        paths += snapshot.verify_paths
+        find_command = ""
+        if paths:
+            find_command = (
+                f"find {_quote(paths)} -printf '%p %y %s %T@ %m %U:%G %l\\n' "
+                "2>/dev/null | sort; "
+            )
+
+        _, manifest = self.terminal.run(
+            "{ git rev-parse HEAD; git status --porcelain --ignored; "
+            f"{find_command}}} | sha256sum",
+            raises=True,
+        )
+        return manifest.split()[0]
+
+    def upload_script(self, name: str) -> str:
+        """Copy a standalone script from `debug_gym/gym/scripts` into the sandbox,
+        unless already there. Returns the path of the script in the sandbox."""
+        content = (importlib_files("debug_gym") / "gym" / "scripts" / name).read_text()
+        return self.upload_content(name, content)
+
+    def upload_content(self, name: str, content: str) -> str:
+        """Write `content` into the sandbox under a path unique to it, unless
+        already there. Returns the path of the file in the sandbox."""
+        digest = hashlib.sha256(content.encode()).hexdigest()[:8]
+        path = f"{SANDBOX_SCRIPTS_DIR}/{Path(name).stem}-{digest}{Path(name).suffix}"
+        success, _ = self.terminal.run(f"test -f {path}")
+        if not success:
+            self.terminal.run(f"mkdir -p {SANDBOX_SCRIPTS_DIR}", raises=True)
+            self.write_file(path, content)
+
+        return path
+
     def resolve_path(self, filepath: str | Path, raises=False) -> Path:
         """Convert a relative filepath to absolute based on the working_dir.
         If the path is already absolute, it is returned as is.
@@ -157,39 +326,38 @@ class Workspace:
 
     def directory_tree(self, root: str | Path = None, max_depth: int = 1):
         root = self.resolve_path(root or self.working_dir, raises=True)
-        # Use the terminal to run a bash command to list files
-        tree_cmd = (
-            f"tree --charset=ASCII --noreport -a -v -F -f -l -L {max_depth} {root} "
+        # Walk the tree in the sandbox, applying the file filters there.
+        script_path = self.upload_script("walk_tree.py")
+        filters_path = self.upload_content("file_filters.json", self._file_filters)
+        success, output = self.terminal.run(
+            f"python {script_path} {shlex.quote(str(root))} {max_depth} {filters_path}",
+            raises=True,
         )
-        success, output = self.terminal.run(tree_cmd, raises=True)
-
-        first, *rest = output.splitlines()
-        lines = [first]
-        for line in rest:
-            assert "-- " in line
-            prefix, path = line.split("-- ", 1)
-            prefix += "-- "
-
-            if self._is_ignored_func(path):
-                continue
-
-            # Remove trailing / and symbolic link details.
-            clean_path = path.split(" -> ")[0].rstrip("/")
-            lines.append(f"{prefix}{os.path.basename(clean_path)}")
-
-            if path.endswith("/"):
-                # i.e. a directory
-                lines[-1] += "/"
-
-            if self._is_readonly_func(path):
-                lines[-1] += " (read-only)"
 
+        lines = [f"{root}/"] + self._format_tree(json.loads(output))
         output = "\n".join(lines)
 
         # To maintain backward compatibility with previous version of debug-gym.
         output = output.replace("`", "|").replace("    ", "  ")
         return output
 
+    @classmethod
+    def _format_tree(cls, entries: list[dict], prefix: str = "") -> list[str]:
+        """Format entries listed by `walk_tree.py` like the `tree` command."""
+        lines = []
+        for i, entry in enumerate(entries):
+            last = i == len(entries) - 1
+            line = f"{prefix}{'`' if last else '|'}-- {entry['name']}"
+            if entry["dir"]:
+                line += "/"
+            if entry["readonly"]:
+                line += " (read-only)"
+            lines.append(line)
+            if entry.get("children"):
+                child_prefix = prefix + ("    " if last else "|   ")
+                lines += cls._format_tree(entry["children"], child_prefix)
+        return lines
+
     def is_editable(self, filepath):
         return not self._is_readonly_func(self.resolve_path(filepath, raises=True))
 
@@ -211,3 +379,80 @@ class Workspace:
             return True
         except FileNotFoundError:
             return False
+
+    def watch_files(self) -> bool:
+        """Start watching the working directory for file changes, in the sandbox
+        (see `scripts/watch_files.py`). Ignored files are not watched. Returns
+        False if the sandbox cannot watch files (e.g., no inotify support)."""
+        self.stop_watching_files()
+        script_path = self.upload_script("watch_files.py")
+        filters_path = self.upload_content("file_filters.json", self._file_filters)
+        _, changes_dir = self.terminal.run(
+            "mktemp -d /tmp/debug_gym_file_changes.XXXXXX", raises=True
+        )
+        self.terminal.run(
+            f"nohup python {script_path} {shlex.quote(str(self.working_dir))} "
+            f"{changes_dir} {filters_path} > {changes_dir}/log 2>&1 < /dev/null &",
+            raises=True,
+        )
+        _, status = self.terminal.run(
+            f"for i in $(seq 300); do test -s {changes_dir}/status && break; "
+            f"sleep 0.1; done; cat {changes_dir}/status {changes_dir}/log"
+        )
+        if not status.startswith("ready "):
+            self.logger.debug(f"Cannot watch files in the sandbox:\n{status}")
+            self.terminal.run(f"rm -rf {changes_dir}")
+            return False
+
+        self._file_watcher_pid = status.split()[1]
+        self._file_changes_dir = changes_dir
+        return True
+
+    @property
+    def watching_files(self) -> bool:
+        return self._file_watcher_pid is not None
+
+    def poll_file_changes(self) -> dict[str, str] | None:
+        """Files changed since the last poll, as {path: kind} with paths relative
+        to the working directory and kind one of `created`, `modified` or
+        `deleted`. `{".": "overflow"}` means that some changes were missed.
+        Returns None if files are not watched (see `watch_files`)."""
+        if not self.watching_files:
+            return None
+
+        # Wait for the watcher to acknowledge the request, so the changes made
+        # before it are all reported.
+        self._file_changes_polls += 1
+        token, changes_dir = self._file_changes_polls, self._file_changes_dir
+        success, output = self.terminal.run(
+            f"echo {token} > {changes_dir}/sync; for i in $(seq 200); do "
+            f'test "$(cat {changes_dir}/synced)" = {token} && break; sleep 0.05; '
+            f'done 2>/dev/null; test "$(cat {changes_dir}/synced)" = {token} && '
+            f"cat {changes_dir}/changes",
+            strip_output=False,
+        )
+        if not success:
+            self.logger.warning(
+                "The file watcher stopped responding, file changes are no longer tracked."
+            )
+            self.stop_watching_files()
+            return {".": "overflow"}
+
+        changes = {}
+        for line in output.splitlines():
+            kind, path = line.split("\t", 1)
+            changes[path] = kind
+        return changes
+
+    def stop_watching_files(self):
+        if not self.watching_files:
+            return
+        self.terminal.run(
+            f"kill {self._file_watcher_pid}; rm -rf {self._file_changes_dir}"
+        )
+        self._file_watcher_pid = None
+        self._file_changes_dir = None
+
+
+def _quote(paths: list[str]) -> str:
+    return " ".join(shlex.quote(path) for path in paths)
@@ -1,3 +1,4 @@
+import copy
 import logging
 import os
 from abc import ABC, abstractmethod
@@ -56,6 +57,8 @@ class LLMConfig:
     # Optional fields
     api_key: Optional[str] = None
     endpoint: Optional[str] = None
+    # Replicas serving the same model, used instead of `endpoint` (see EndpointRouter)
+    endpoints: List[str] = None
     tokenizer: Optional[str] = None
     apply_chat_template: Optional[bool] = False
     enable_thinking: Optional[bool] = False
@@ -70,6 +73,8 @@ class LLMConfig:
     generate_kwargs: dict = None
     # Additional kwargs for tokenizer construction (e.g., trust_remote_code)
     tokenizer_kwargs: dict | None = None
+    # Models and policies of a routing LLM (see RoutingLLM)
+    routing: dict | None = None
 
     def __post_init__(self):
         # Set tokenizer to model if not specified
@@ -153,6 +158,16 @@ class TokenUsage:
     response: int
 
 
+@dataclass
+class ServingInfo:
+    """Which model served a response, in how long, and at what cost."""
+
+    model: str
+    latency: float  # seconds
+    cost: float | None = None
+    escalated_from: list[str] | None = None  # Models whose responses were invalid.
+
+
 @dataclass
 class LLMResponse:
     prompt: list[dict] | str  # either a string or a list of messages.
@@ -160,6 +175,7 @@ class LLMResponse:
     reasoning_response: str | None
     tool: ToolCall
     token_usage: TokenUsage | None = None
+    serving: ServingInfo | None = None
 
     def __init__(
         self,
@@ -170,6 +186,7 @@ class LLMResponse:
         prompt_token_count: int = None,
         response_token_count: int = None,
         token_usage: TokenUsage = None,
+        serving: ServingInfo = None,
     ):
         self.prompt = prompt
         self.response = response
@@ -179,6 +196,7 @@ class LLMResponse:
             self.token_usage = TokenUsage(prompt_token_count, response_token_count)
         else:
             self.token_usage = token_usage
+        self.serving = serving
 
 
 class ContextLengthExceededError(Exception):
@@ -210,12 +228,21 @@ class LLM(ABC):
         self.apply_chat_template = self.config.apply_chat_template
         self.enable_thinking = self.config.enable_thinking
         self.reasoning_end_token = self.config.reasoning_end_token
+        # Identifies the episode of the requests, e.g., to route them (see EndpointRouter).
+        self.routing_key: str | None = None
 
         self.logger.debug(
             f"Using {self.model_name} with max context length of {
                 self.context_length:,} tokens."
         )
 
+    def fork(self, routing_key: str) -> "LLM":
+        """Copy of the LLM sending its requests under `routing_key`, e.g., for a
+        branch of the episode running concurrently. Clients are shared."""
+        llm = copy.copy(self)
+        llm.routing_key = routing_key
+        return llm
+
     @classmethod
     def instantiate(
         cls,
@@ -246,7 +273,18 @@ class LLM(ABC):
 
         tags = llm_config.tags
 
-        if "copilot openai" in tags:
+        if "routing" in tags:
+            from debug_gym.llms.routing import RoutingLLM
+
+            # Its models are instantiated from the same config file.
+            return RoutingLLM(
+                llm_name,
+                logger=logger,
+                llm_config=llm_config,
+                llm_config_file_path=llm_config_file_path,
+            )
+
+        elif "copilot openai" in tags:
             from debug_gym.llms.copilot import CopilotOpenAILLM
 
             klass = CopilotOpenAILLM
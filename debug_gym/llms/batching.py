@@ -0,0 +1,146 @@
+import threading
+import time
+from concurrent.futures import Future, ThreadPoolExecutor
+from dataclasses import dataclass, field
+
+from debug_gym.llms.base import LLM, LLMResponse
+
+
+@dataclass
+class BatchStats:
+    batches: int = 0
+    requests: int = 0
+    occupancy: float = 0.0  # Mean fraction of the batch size used by a batch.
+    mean_queue_delay: float = 0.0  # Seconds between submission and dispatch.
+    max_queue_delay: float = 0.0
+
+
+@dataclass
+class _PendingRequest:
+    messages: list[dict]
+    tools: list
+    kwargs: dict
+    submitted: float = field(default_factory=time.monotonic)
+    future: Future = field(default_factory=Future)
+
+
+class BatchingLLM:
+    """Wraps an LLM shared by episodes running concurrently (e.g., in threads, or
+    in a vectorized loop using `generate_batch`), and submits their pending
+    requests together. The inference server (e.g., vLLM behind HuggingFaceLLM)
+    then schedules the steps of the episodes in one batch, instead of each
+    request queueing behind whichever arrived first.
+
+    A batch is submitted once `batch_size` requests are pending, or `max_wait`
+    seconds after the oldest pending request. Responses are returned to the
+    episode which sent the request. Other attributes are the wrapped LLM's.
+    """
+
+    def __init__(self, llm: LLM, batch_size: int, max_wait: float = 0.5):
+        if batch_size < 1:
+            raise ValueError("batch_size must be at least 1.")
+        self.llm = llm
+        self.batch_size = batch_size
+        self.max_wait = max_wait
+        self._pending: list[_PendingRequest] = []
+        self._condition = threading.Condition()
+        self._executor = ThreadPoolExecutor(batch_size, "debug-gym-batch")
+        self._dispatcher = None
+        self._closed = False
+        self._stats = BatchStats()
+        self._total_queue_delay = 0.0
+
+    def __getattr__(self, name):
+        # Only called for attributes not found on the wrapper.
+        if name == "llm":
+            raise AttributeError(name)
+        return getattr(self.llm, name)
+
+    def __call__(self, messages, tools, *args, **kwargs) -> LLMResponse:
+        return self.submit(messages, tools, **kwargs).result()
+
+    def submit(self, messages, tools, **kwargs) -> Future:
+        """Queue a request, returns the future of its response."""
+        request = _PendingRequest(messages, tools, kwargs)
+        with self._condition:
+            if self._closed:
+                raise RuntimeError("Cannot submit requests to a closed BatchingLLM.")
+            if self._dispatcher is None:
+                self._dispatcher = threading.Thread(
+                    target=self._dispatch_loop, name="debug-gym-batcher", daemon=True
+                )
+                self._dispatcher.start()
+            self._pending.append(request)
+            self._condition.notify()
+        return request.future
+
+    def generate_batch(self, requests: list[tuple[list[dict], list]]) -> list:
+        """Submit the `(messages, tools)` requests of several episodes at once,
+        e.g., from a vectorized agent loop. Returns the responses in order."""
+        futures = [self.submit(messages, tools) for messages, tools in requests]
+        return [future.result() for future in futures]
+
+    def _dispatch_loop(self):
+        while True:
+            with self._condition:
+                while not self._pending and not self._closed:
+                    self._condition.wait()
+                if not self._pending:
+                    return  # Closed.
+
+                deadline = self._pending[0].submitted + self.max_wait
+                while len(self._pending) < self.batch_size and not self._closed:
+                    remaining = deadline - time.monotonic()
+                    if remaining <= 0:
+                        break
+                    self._condition.wait(remaining)
+
+                batch = self._pending[: self.batch_size]
+                self._pending = self._pending[self.batch_size :]
+
+            self._submit_batch(batch)
+
+    def _submit_batch(self, batch: list[_PendingRequest]):
+        now = time.monotonic()
+        delays = [now - request.submitted for request in batch]
+        with self._condition:
+            stats = self._stats
+            stats.occupancy = (
+                stats.occupancy * stats.batches + len(batch) / self.batch_size
+            ) / (stats.batches + 1)
+            stats.batches += 1
+            stats.requests += len(batch)
+            self._total_queue_delay += sum(delays)
+            stats.mean_queue_delay = self._total_queue_delay / stats.requests
+            stats.max_queue_delay = max(stats.max_queue_delay, *delays)
+
+        self.llm.logger.debug(
+            f"Submitting a batch of {len(batch)}/{self.batch_size} requests "
+            f"(max queueing delay: {max(delays):.2f}s)."
+        )
+        for request in batch:
+            self._executor.submit(self._generate, request)
+
+    def _generate(self, request: _PendingRequest):
+        if not request.future.set_running_or_notify_cancel():
+            return
+        try:
+            response = self.llm(request.messages, request.tools, **request.kwargs)
+            request.future.set_result(response)
+        except BaseException as e:
+            request.future.set_exception(e)
+
+    @property
+    def stats(self) -> BatchStats:
+        """Batch occupancy and queueing delay of the requests submitted so far."""
+        with self._condition:
+            return BatchStats(**vars(self._stats))
+
+    def close(self):
+        """Submit the pending requests, then stop the dispatcher."""
+        with self._condition:
+            self._closed = True
+            self._condition.notify()
+        if self._dispatcher is not None:
+            self._dispatcher.join()
+        self._executor.shutdown(wait=True)
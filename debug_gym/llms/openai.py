@@ -16,6 +16,7 @@ from debug_gym.llms.base import (
     retry_on_exception,
 )
 from debug_gym.llms.constants import LLM_API_KEY_PLACEHOLDER, LLM_ENDPOINT_PLACEHOLDER
+from debug_gym.llms.router import EndpointRouter, prefix_key
 
 # Set logging level down to WARNING for endpoint queries.
 logging.getLogger("openai").setLevel(logging.WARNING)
@@ -32,6 +33,10 @@ class OpenAILLM(LLM):
         "maximum context length",
     ]
 
+    def __init__(self, *args, **kwargs):
+        super().__init__(*args, **kwargs)
+        self._endpoint_clients = {}  # By endpoint (see `_endpoint_client`).
+
     def is_context_length_error(self, exception: Exception) -> bool:
         if (
             hasattr(exception, "code")
@@ -143,8 +148,35 @@ class OpenAILLM(LLM):
         such as GitHub Copilot HMAC tokens).
         """
 
+        if self.config.endpoints:
+            return self._routed_chat_completion(**kwargs)
         return self.client.chat.completions.create(**kwargs)
 
+    def _endpoint_client(self, endpoint: str) -> OpenAI:
+        """Client of one of the `endpoints` of the config."""
+        if endpoint not in self._endpoint_clients:
+            self._endpoint_clients[endpoint] = OpenAI(
+                api_key=self.config.api_key, base_url=endpoint, timeout=None
+            )
+        return self._endpoint_clients[endpoint]
+
+    def _routed_chat_completion(self, **kwargs):
+        """Send the request to the replica the episode is pinned to. Retries are
+        routed again, away from the replica if it failed."""
+        router = EndpointRouter.shared(self.config.endpoints)
+        endpoint = router.acquire(self.routing_key or prefix_key(kwargs["messages"]))
+        try:
+            client = self._endpoint_client(endpoint)
+            response = client.chat.completions.create(**kwargs)
+        except openai.BadRequestError:
+            router.release(endpoint)  # The request is at fault, not the replica.
+            raise
+        except Exception:
+            router.release(endpoint, failed=True)
+            raise
+        router.release(endpoint)
+        return response
+
     def define_tools(self, tool_call_list: list[EnvironmentTool]) -> list[dict]:
         """Translates the list of tools into a format that is specifically defined by each LLM.
         OpenAI function calling format: https://platform.openai.com/docs/guides/function-calling
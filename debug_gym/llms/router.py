@@ -0,0 +1,123 @@
+import hashlib
+import threading
+import time
+from collections import OrderedDict
+from dataclasses import dataclass
+
+
+@dataclass
+class EndpointStats:
+    requests: int = 0
+    in_flight: int = 0
+    failures: int = 0
+    # Requests routed to the endpoint which served the previous request of the
+    # same episode, i.e., which likely has the prompt prefix in its KV cache.
+    cache_hits: int = 0
+    healthy: bool = True
+
+    @property
+    def cache_hit_rate(self) -> float:
+        return self.cache_hits / self.requests if self.requests else 0.0
+
+
+def prefix_key(messages: list[dict]) -> str:
+    """Routing key of requests without an episode key: their first message
+    (e.g., the system prompt with the task instructions) is their prefix."""
+    return hashlib.sha1(str(messages[:1]).encode()).hexdigest()
+
+
+def _score(key: str, endpoint: str) -> int:
+    return int.from_bytes(hashlib.sha1(f"{key}|{endpoint}".encode()).digest()[:8])
+
+
+class EndpointRouter:
+    """Routes the requests of an episode (identified by a key, e.g., agent uuid
+    and task) to replicas of the same model, pinning each episode to a replica
+    so consecutive steps, which share a long prompt prefix, hit its prefix cache.
+
+    Episodes are first assigned by rendezvous hashing, which is consistent across
+    processes without coordination. An episode moves to the least loaded replica
+    when its replica has `max_imbalance` more requests in flight than that one,
+    or when its replica failed in the last `cooldown` seconds.
+
+    Routers are shared per list of endpoints within a process (see `shared`), so
+    loads and metrics account for all the LLM instances using them.
+    """
+
+    _shared: dict[tuple[str, ...], "EndpointRouter"] = {}
+    _shared_lock = threading.Lock()
+
+    def __init__(
+        self,
+        endpoints: list[str],
+        max_imbalance: int = 4,
+        cooldown: float = 30,
+        max_pins: int = 10_000,
+    ):
+        if not endpoints:
+            raise ValueError("EndpointRouter requires at least one endpoint.")
+        self.endpoints = list(endpoints)
+        self.max_imbalance = max_imbalance
+        self.cooldown = cooldown
+        self.max_pins = max_pins
+        self._stats = {endpoint: EndpointStats() for endpoint in self.endpoints}
+        self._down_until = {endpoint: 0.0 for endpoint in self.endpoints}
+        self._pins: OrderedDict[str, str] = OrderedDict()
+        self._lock = threading.Lock()
+
+    @classmethod
+    def shared(cls, endpoints: list[str], **kwargs) -> "EndpointRouter":
+        with cls._shared_lock:
+            key = tuple(endpoints)
+            if key not in cls._shared:
+                cls._shared[key] = cls(endpoints, **kwargs)
+            return cls._shared[key]
+
+    def _healthy(self, now: float) -> list[str]:
+        healthy = [e for e in self.endpoints if self._down_until[e] <= now]
+        return healthy or self.endpoints  # All down, try them anyway.
+
+    def acquire(self, key: str) -> str:
+        """Endpoint to send the next request of the episode `key` to. Must be
+        followed by `release` once the request is done."""
+        with self._lock:
+            candidates = self._healthy(time.monotonic())
+            least_loaded = min(candidates, key=lambda e: self._stats[e].in_flight)
+            pinned = self._pins.get(key)
+            endpoint = pinned
+            if endpoint not in candidates:
+                endpoint = max(candidates, key=lambda e: _score(key, e))
+            if (
+                self._stats[endpoint].in_flight
+                >= self._stats[least_loaded].in_flight + self.max_imbalance
+            ):
+                endpoint = least_loaded  # Overloaded, rebalance.
+
+            stats = self._stats[endpoint]
+            stats.requests += 1
+            stats.in_flight += 1
+            stats.cache_hits += endpoint == pinned
+            self._pins[key] = endpoint
+            self._pins.move_to_end(key)
+            if len(self._pins) > self.max_pins:
+                self._pins.popitem(last=False)
+            return endpoint
+
+    def release(self, endpoint: str, failed: bool = False) -> None:
+        with self._lock:
+            stats = self._stats[endpoint]
+            stats.in_flight -= 1
+            if failed:
+                stats.failures += 1
+                self._down_until[endpoint] = time.monotonic() + self.cooldown
+
+    def stats(self) -> dict[str, EndpointStats]:
+        """Per-endpoint load and cache-hit metrics."""
+        with self._lock:
+            now = time.monotonic()
+            return {
+                endpoint: EndpointStats(
+                    **{**vars(stats), "healthy": self._down_until[endpoint] <= now}
+                )
+                for endpoint, stats in self._stats.items()
+            }
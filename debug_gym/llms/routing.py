@@ -0,0 +1,188 @@
+import copy
+import time
+from dataclasses import dataclass
+
+from debug_gym.gym.envs.env import EnvInfo
+from debug_gym.gym.tools.tool import EnvironmentTool, ToolCall
+from debug_gym.llms.base import LLM, LLMConfig, LLMResponse, ServingInfo
+from debug_gym.logger import DebugGymLogger
+
+# Kind of the step following the use of a tool (see `after_tool` below).
+STEP_KINDS = {
+    "listdir": "navigation",
+    "view": "navigation",
+    "grep": "navigation",
+    "rewrite": "edit",
+    "eval": "test",
+    "pdb": "debug",
+    "trace": "debug",
+}
+
+
+@dataclass
+class _EpisodeState:
+    step: int = 0
+    last_tool: str | None = None
+    failure_streak: int = 0  # Invalid responses in a row.
+    escalated: bool = False  # Next step on the most capable model.
+
+
+class RoutingLLM(LLM):
+    """Serves each step of an episode with one of several models, e.g., a cheap
+    model for navigation and a capable one for rewrites. Selected with the
+    `routing` tag; its `routing` config entry reads:
+
+        models: [cheap-model, capable-model]  # From cheapest to most capable.
+        first_steps: 1  # Steps served by the most capable model (planning).
+        after_tool: {rewrite: capable-model, navigation: cheap-model}
+        failure_streak: 2  # Invalid responses in a row before using the most
+                           # capable model, until it responds validly.
+        escalate: true  # Retry invalid responses with the next model.
+        costs: {capable-model: [2.5, 10.0]}  # Price per 1M prompt/response tokens.
+
+    `after_tool` picks the model of the step following the use of a tool, by
+    tool name or by step kind (see `STEP_KINDS`). Otherwise, the first model is
+    used. Responses are invalid when the model does not call a tool, or calls
+    an unknown one. Each response records the model which served it, and the
+    latency and cost of the step, including its invalid responses (see
+    `ServingInfo`).
+
+    Models are instantiated from the same config file, and must share the
+    same API (e.g., all OpenAI-compatible): the first one formats the prompts.
+    """
+
+    def __init__(
+        self,
+        model_name: str,
+        logger: DebugGymLogger | None = None,
+        llm_config: LLMConfig | None = None,
+        llm_config_file_path: str | None = None,
+    ):
+        super().__init__(model_name, logger=logger, llm_config=llm_config)
+        routing = self.config.routing or {}
+        model_names = routing.get("models") or []
+        if not model_names:
+            raise ValueError(f"Routing LLM {model_name} requires `routing.models`.")
+
+        self.models = {
+            name: LLM.instantiate(name, llm_config_file_path, logger=self.logger)
+            for name in model_names
+        }
+        self.model_names = model_names
+        self.first_steps = routing.get("first_steps", 0)
+        self.after_tool = routing.get("after_tool", {})
+        self.failure_streak = routing.get("failure_streak", 0)
+        self.escalate_invalid = routing.get("escalate", True)
+        self.costs = routing.get("costs", {})
+        unknown = set(self.after_tool.values()) - set(model_names)
+        if unknown:
+            raise ValueError(f"Unknown models in `routing.after_tool`: {unknown}")
+
+        self._episode_key = None
+        self._episode = _EpisodeState()
+
+    @property
+    def default_llm(self) -> LLM:
+        return self.models[self.model_names[0]]
+
+    def episode(self) -> _EpisodeState:
+        """State of the current episode, reset when the routing key changes."""
+        if self.routing_key != self._episode_key:
+            self._episode_key = self.routing_key
+            self._episode = _EpisodeState()
+        return self._episode
+
+    def fork(self, routing_key: str) -> "RoutingLLM":
+        """The fork starts from the state of the current episode, and updates
+        its own copy of it."""
+        llm = super().fork(routing_key)
+        llm._episode_key = routing_key
+        llm._episode = copy.copy(self.episode())
+        return llm
+
+    def escalate(self):
+        """Serve the next step with the most capable model, e.g., when the agent
+        is going in circles (see LoopDetector)."""
+        self.episode().escalated = True
+
+    def select_model(self, episode: _EpisodeState) -> str:
+        most_capable = self.model_names[-1]
+        if episode.step < self.first_steps or episode.escalated:
+            return most_capable
+        if self.failure_streak and episode.failure_streak >= self.failure_streak:
+            return most_capable
+        if episode.last_tool is not None:
+            for key in (episode.last_tool, STEP_KINDS.get(episode.last_tool)):
+                if key in self.after_tool:
+                    return self.after_tool[key]
+        return self.model_names[0]
+
+    def cost(self, model: str, response: LLMResponse) -> float | None:
+        if model not in self.costs or response.token_usage is None:
+            return None
+        prompt_price, response_price = self.costs[model]
+        usage = response.token_usage
+        return (usage.prompt * prompt_price + usage.response * response_price) / 1e6
+
+    @staticmethod
+    def is_valid(response: LLMResponse, tools: list) -> bool:
+        # Includes the `empty_tool_response` of models not calling any tool.
+        return response.tool is not None and response.tool.name in {
+            tool.name for tool in tools
+        }
+
+    def __call__(self, messages, tools, *args, **kwargs) -> LLMResponse:
+        episode = self.episode()
+        model = self.select_model(episode)
+        episode.escalated = False
+        invalid_models = []
+        latency, costs = 0.0, []  # Of all the attempts, including invalid ones.
+        while True:
+            start = time.monotonic()
+            llm_response = self.models[model](messages, tools, *args, **kwargs)
+            latency += time.monotonic() - start
+            costs.append(self.cost(model, llm_response))
+            if self.is_valid(llm_response, tools):
+                episode.failure_streak = 0
+                break
+
+            episode.failure_streak += 1
+            invalid_models.append(model)
+            index = self.model_names.index(model)
+            if not self.escalate_invalid or index + 1 == len(self.model_names):
+                break
+            model = self.model_names[index + 1]
+            self.logger.info(f"Invalid response, escalating the step to {model}.")
+
+        costs = [cost for cost in costs if cost is not None]
+        llm_response.serving = ServingInfo(
+            model=model,
+            latency=latency,
+            cost=sum(costs) if costs else None,
+            escalated_from=[m for m in invalid_models if m != model] or None,
+        )
+        episode.last_tool = llm_response.tool.name if llm_response.tool else None
+        episode.step += 1
+        cost = llm_response.serving.cost
+        self.logger.info(
+            f"Step {episode.step} served by {model} in {latency:.1f}s"
+            + (f" (${cost:.4f})" if cost is not None else "")
+        )
+        return llm_response
+
+    def generate(self, messages, tools, **kwargs) -> LLMResponse:
+        return self.default_llm.generate(messages, tools, **kwargs)
+
+    def tokenize(self, messages: list[dict]) -> list[list[str]]:
+        return self.default_llm.tokenize(messages)
+
+    def define_tools(self, tool_call_list: list[EnvironmentTool]) -> list[dict]:
+        return self.default_llm.define_tools(tool_call_list)
+
+    def parse_tool_call_response(self, response) -> ToolCall:
+        return self.default_llm.parse_tool_call_response(response)
+
+    def format_tool_call_history(
+        self, history_info: EnvInfo, response: list[LLMResponse]
+    ) -> list[dict]:
+        return self.default_llm.format_tool_call_history(history_info, response)
@@ -46,6 +46,7 @@ class TaskProgress:
         return self.status in (
             "resolved",
             "unresolved",
+            "stalled",
             "skip-resolved",
             "skip-unresolved",
             "error",
@@ -59,6 +60,7 @@ class TaskProgress:
             "pending",
             "resolved",
             "unresolved",
+            "stalled",
             "skip-resolved",
             "skip-unresolved",
             "error",
@@ -71,6 +73,8 @@ class TaskProgress:
             return "✓"
         elif status == "unresolved":
             return "✗"
+        elif status == "stalled":
+            return "↻"
         elif status == "skip-resolved":
             return "✓"
         elif status == "skip-unresolved":
@@ -90,6 +94,8 @@ class TaskProgress:
             return "green"
         elif status == "unresolved":
             return "red"
+        elif status == "stalled":
+            return "dark_orange"
         elif status == "skip-resolved":
             return "yellow"
         elif status == "skip-unresolved":
@@ -120,7 +126,7 @@ class TaskProgress:
 class StatusColumn(SpinnerColumn):
     """Custom status column. magenta ! when error,
     yellow spinner pending, blue spinner running,
-    green ✓ when resolved, red ✗ when unresolved,
+    green ✓ when resolved, red ✗ when unresolved, orange ↻ when stalled,
     yellow ✓ when skip-resolved, yellow ✗ when skip-unresolved."""
 
     def __init__(self, spinner_name: str = "dots", speed: float = 1.0):
@@ -10,9 +10,13 @@ from pathlib import Path
 
 from debug_gym import version as dg_version
 from debug_gym.agents.base_agent import AGENT_REGISTRY, create_agent
+from debug_gym.agents.best_of_n_agent import BestOfNAgent
 from debug_gym.agents.utils import load_config
+from debug_gym.gym.certification import Certifier
 from debug_gym.gym.envs import select_env
+from debug_gym.gym.server import EnvPool, EnvServer
 from debug_gym.gym.terminals import select_terminal
+from debug_gym.gym.terminals.reaper import Reaper
 from debug_gym.gym.tools.toolbox import Toolbox
 from debug_gym.llms.base import LLM
 from debug_gym.llms.human import Human
@@ -63,7 +67,7 @@ def run_agent(args, problem, config):
         if (
             not args.force_all
             and previous_run is not None
-            and previous_run.status in ["resolved", "unresolved"]
+            and previous_run.status in ["resolved", "unresolved", "stalled"]
         ):
             task_logger.debug(f"Previous run found: {problem_path}")
             success = previous_run.status == "resolved"
@@ -106,6 +110,8 @@ def run_agent(args, problem, config):
             llm=llm,
             logger=task_logger,
         )
+        if isinstance(agent, BestOfNAgent):
+            agent.env_factory = make_env_factory(config, task_logger)
 
         try:
             success = agent.run(task_name=problem, debug=args.debug)
@@ -201,6 +207,17 @@ def add_tools(env, config: dict, logger: DebugGymLogger):
         logger.debug(f"Adding tool to toolbox: {tool_instantiated.__class__.__name__}")
 
 
+def make_env_factory(config: dict, logger: DebugGymLogger):
+    """Returns a function creating environments with the tools of the config."""
+
+    def env_factory():
+        env = create_env(config, logger=logger)
+        add_tools(env, config, logger=logger)
+        return env
+
+    return env_factory
+
+
 def dump_experiment_info(config: dict, args: dict):
     """Dump experiment information to a JSONL file.
     Each line is one experiment run with its metadata."""
@@ -238,8 +255,50 @@ def dump_experiment_info(config: dict, args: dict):
         f.write(f"{json.dumps(version_info)}\n")
 
 
+def reap(config: dict, logger: DebugGymLogger):
+    """Delete the sandboxes left behind by dead processes, across experiments."""
+    terminal = select_terminal(config.get("terminal"), logger)
+    reaper = Reaper.for_terminal(terminal, logger=logger)
+    if not reaper.enabled:
+        logger.warning("Nothing to reap, the terminal does not create sandboxes.")
+        return
+    reaped = reaper.reap()
+    logger.info(f"Reaped {len(reaped)} orphaned sandboxes.")
+
+
+def serve(args, config: dict, problems: list[str], logger: DebugGymLogger):
+    """Serve environments with the tools of the config, warmed on the problems."""
+    env_factory = make_env_factory(config, logger)
+    pool = EnvPool(env_factory, size=args.pool_size, tasks=problems, logger=logger)
+    server = EnvServer(args.serve, pool, logger=logger)
+    try:
+        server.serve_forever()
+    finally:
+        server.shutdown()
+
+
+def certify(args, config: dict, problems: list[str], logger: DebugGymLogger):
+    """Certify the problems with their gold patch, on a pool of environments."""
+    num_workers = args.num_workers or int(os.environ.get("DEBUG_GYM_WORKERS", 1))
+    certifier = Certifier(
+        lambda: create_env(config, logger),
+        workers=min(num_workers, len(problems)),
+        runs=args.certify_runs,
+        logger=logger,
+    )
+    certification = certifier.certify(problems, args.certify, force=args.force_all)
+    uncertified = [p for p in certification.uncertified_tasks() if p in problems]
+    logger.info(
+        f"{len(problems) - len(uncertified)}/{len(problems)} problems certified, "
+        f"results written to {args.certify}."
+    )
+
+
 def main():
     config, args = load_config()
+    if args.reap:
+        return reap(config, DebugGymLogger("debug-gym", level=args.logging_level))
+
     config["uuid"] = config.get("uuid", str(uuid.uuid4()))
     exp_output_path = Path(config["output_path"]) / config["uuid"]
     exp_output_path.mkdir(parents=True, exist_ok=True)
@@ -247,6 +306,10 @@ def main():
     logger.info(f"Experiment log path: {exp_output_path}")
     dump_experiment_info(config, args)
 
+    if args.certify:
+        # Certify all the problems, including the ones not certified previously.
+        config["env_kwargs"].pop("certification_file", None)
+
     # Create the environment to get the list of problems to run.
     env = create_env(config, logger=logger)
     problems = sorted(env.dataset)
@@ -263,6 +326,12 @@ def main():
 
         return
 
+    if args.serve:
+        return serve(args, config, problems, logger)
+
+    if args.certify:
+        return certify(args, config, problems, logger)
+
     llm = LLM.instantiate(
         llm_name=config["llm_name"],
         llm_config_file_path=config.get("llm_config_file_path"),
@@ -292,24 +361,34 @@ def main():
                 except (KeyboardInterrupt, Exception) as e:
                     raise e
         else:
-            with ProcessPoolExecutor(
-                num_workers, initializer=DebugGymLogger.set_as_worker
-            ) as executor:
-                futures = {
-                    executor.submit(run_agent, args, problem, config): problem
-                    for problem in problems
-                }
-                for future in as_completed(futures):
-                    if future.cancelled():
-                        continue
-                    try:
-                        problem = futures[future]
-                        success = future.result()
-                    except AgentTimeoutException:
-                        pass  # Handled in run_agent, just continue
-                    except (KeyboardInterrupt, Exception) as e:
-                        executor.shutdown(wait=True, cancel_futures=True)
-                        raise e
+            # Workers killed before cleaning up (e.g., OOM) leave their sandboxes
+            # behind, the reaper deletes them so they don't eat up capacity.
+            reaper = Reaper.for_terminal(
+                env.terminal, uuid=config["uuid"], logger=logger
+            )
+            if reaper.enabled:
+                reaper.start()
+            try:
+                with ProcessPoolExecutor(
+                    num_workers, initializer=DebugGymLogger.set_as_worker
+                ) as executor:
+                    futures = {
+                        executor.submit(run_agent, args, problem, config): problem
+                        for problem in problems
+                    }
+                    for future in as_completed(futures):
+                        if future.cancelled():
+                            continue
+                        try:
+                            problem = futures[future]
+                            success = future.result()
+                        except AgentTimeoutException:
+                            pass  # Handled in run_agent, just continue
+                        except (KeyboardInterrupt, Exception) as e:
+                            executor.shutdown(wait=True, cancel_futures=True)
+                            raise e
+            finally:
+                reaper.stop()
 
 
 if __name__ == "__main__":
@@ -13,7 +13,9 @@ from debug_gym.agents.base_agent import (
     register_agent,
 )
 from debug_gym.agents.debug_agent import Debug_5_Agent, DebugAgent
+from debug_gym.agents.loop_detector import LoopDetector
 from debug_gym.agents.rewrite_agent import RewriteAgent
+from debug_gym.gym.tools.tool import ToolCall
 from debug_gym.llms.base import LLMResponse, TokenUsage
 
 
@@ -515,6 +517,37 @@ def test_run_max_rewrite_steps(agent_setup, build_env_info):
     assert result is False  # Task not completed, but stopped due to max rewrites
 
 
+def test_run_stalled(agent_setup, build_env_info):
+    """Test run method stopping an agent repeating the same step"""
+    agent, env, llm = next(agent_setup(DebugAgent))
+    agent.config["loop_detection"] = {"max_repeats": 2, "actions": ["warn", "stop"]}
+    agent.loop_detector = LoopDetector.from_config(agent.config["loop_detection"])
+    agent.logger.report_progress = MagicMock()
+    env.changes_digest = "same digest"
+    env.reset.return_value = build_env_info(terminated=False, resolved=False)
+    env.step.return_value = build_env_info(
+        terminated=False,
+        resolved=False,
+        action_tool_call=ToolCall(id="1", name="view", arguments={"path": "a.py"}),
+        step_observation="same content",
+    )
+    prompts = []
+
+    def llm_call(messages, tools):
+        prompts.append(messages)
+        return LLMResponse("Prompt", "Expected answer", TokenUsage(2, 4))
+
+    llm.side_effect = llm_call
+    result = agent.run(task_name="test_task")
+    assert result is False
+    # Warned after the third identical step, stopped after the fourth.
+    assert env.step.call_count == 4
+    assert "Do not repeat it" in prompts[3][-1]["content"]
+    assert "Do not repeat it" not in prompts[2][-1]["content"]
+    final = agent.logger.report_progress.call_args.kwargs
+    assert final["status"] == "stalled" and final["step"] == 4
+
+
 def test_run_exception_handling(agent_setup, build_env_info):
     """Test run method exception handling"""
     agent, env, llm = next(agent_setup(DebugAgent))
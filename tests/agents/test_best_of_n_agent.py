@@ -0,0 +1,150 @@
+from unittest.mock import MagicMock
+
+import pytest
+
+from debug_gym.agents.best_of_n_agent import BestOfNAgent
+from debug_gym.gym.tools.tool import ToolCall
+from debug_gym.llms.base import LLMResponse
+
+
+def view_call():
+    return ToolCall(id="1", name="view", arguments={"path": "a.py"})
+
+
+def rewrite_call():
+    return ToolCall(id="2", name="rewrite", arguments={"path": "a.py"})
+
+
+def make_branch_env(build_env_info, score, resolved=False):
+    env = MagicMock()
+    env.auto_eval_on_rewrite = False
+    env.has_tool.return_value = False
+    env.step.return_value = build_env_info(
+        action_tool_call=view_call(), score=0, step_observation=f"obs {score}"
+    )
+    env.evaluate.return_value = build_env_info(
+        action_tool_call=view_call(),
+        score=score,
+        resolved=resolved,
+        terminated=resolved,
+        step_observation=f"obs {score}",
+    )
+    return env
+
+
+@pytest.fixture
+def best_of_n_setup(agent_setup, build_env_info):
+    agent, env, llm = next(agent_setup(BestOfNAgent))
+    agent.logger.report_progress = MagicMock()
+    agent.n_candidates = 3
+    env.auto_eval_on_rewrite = False
+    env.has_tool.return_value = False
+    env.changes = "diff"
+    env.reset.return_value = build_env_info(action_tool_call=None, score=0)
+    env.fork_into.return_value = env.reset.return_value
+    llm.return_value = LLMResponse("Prompt", "Answer", tool=view_call())
+    llm.fork.return_value = llm
+    branch_envs = [
+        make_branch_env(build_env_info, 7),
+        make_branch_env(build_env_info, 3),
+    ]
+    agent.env_factory = MagicMock(side_effect=branch_envs)
+    return agent, env, llm, branch_envs
+
+
+def test_best_of_n_requires_env_factory(agent_setup, build_env_info):
+    agent, env, llm = next(agent_setup(BestOfNAgent))
+    agent.logger.report_progress = MagicMock()
+    env.reset.return_value = build_env_info(action_tool_call=None)
+    with pytest.raises(ValueError, match="env_factory"):
+        agent.run(task_name="test_task")
+
+
+def test_best_of_n_continues_with_best_branch(best_of_n_setup, build_env_info):
+    agent, env, llm, branch_envs = best_of_n_setup
+    agent.branch_at = ["start"]
+    agent.rollout_steps = 2
+    agent.config["max_steps"] = 2
+    env.step.return_value = build_env_info(action_tool_call=view_call(), score=0)
+    env.evaluate.return_value = build_env_info(action_tool_call=view_call(), score=1)
+    branch_envs[0].fork_into.return_value = build_env_info(
+        action_tool_call=view_call(), score=7
+    )
+
+    agent.run(task_name="test_task")
+    # Branches are forked from the agent's env, and all rolled out.
+    for branch_env in branch_envs:
+        env.fork_into.assert_any_call(branch_env, changes="diff")
+        assert branch_env.step.call_count == 2
+        branch_env.evaluate.assert_called_once()
+    assert env.step.call_count == 2
+    # The best branch is brought back into the agent's env.
+    branch_envs[0].fork_into.assert_called_once_with(env)
+    assert agent.history.memory[-1].step_observation.observation == "obs 7"
+    assert len(agent.history) == 3
+    final = agent.logger.report_progress.call_args.kwargs
+    assert final["score"] == 7 and final["step"] == 2
+    # Branch environments are closed at the end of the episode.
+    for branch_env in branch_envs:
+        branch_env.close.assert_called_once()
+    assert agent.branch_envs == []
+
+
+def test_best_of_n_keeps_main_branch_on_tie(best_of_n_setup, build_env_info):
+    agent, env, llm, branch_envs = best_of_n_setup
+    agent.branch_at = ["start"]
+    agent.rollout_steps = 1
+    agent.config["max_steps"] = 1
+    env.step.return_value = build_env_info(action_tool_call=view_call(), score=0)
+    env.evaluate.return_value = build_env_info(action_tool_call=view_call(), score=7)
+
+    agent.run(task_name="test_task")
+    for branch_env in branch_envs:
+        branch_env.fork_into.assert_not_called()
+
+
+def test_best_of_n_without_rollout_steps(best_of_n_setup, build_env_info):
+    agent, env, llm, branch_envs = best_of_n_setup
+    agent.branch_at = ["start"]
+    agent.rollout_steps = 0
+    agent.config["max_steps"] = 0
+    env.evaluate.return_value = build_env_info(action_tool_call=None, score=1)
+
+    agent.run(task_name="test_task")
+    # The branches are only evaluated, from the initial state.
+    llm.assert_not_called()
+    for branch_env in branch_envs:
+        branch_env.step.assert_not_called()
+        branch_env.evaluate.assert_called_once()
+    branch_envs[0].fork_into.assert_called_once_with(env)
+    assert agent.logger.report_progress.call_args.kwargs["step"] == 0
+
+
+def test_best_of_n_branches_on_rewrite(best_of_n_setup, build_env_info):
+    agent, env, llm, branch_envs = best_of_n_setup
+    agent.branch_at = ["rewrite"]
+    agent.max_branch_points = 1
+    agent.config["max_steps"] = 3
+    llm.return_value = LLMResponse("Prompt", "Answer", tool=rewrite_call())
+    env.step.return_value = build_env_info(action_tool_call=rewrite_call(), score=0)
+    env.evaluate.return_value = build_env_info(action_tool_call=rewrite_call())
+    branch_envs[0].fork_into.return_value = build_env_info(
+        action_tool_call=rewrite_call(), score=7
+    )
+
+    agent.run(task_name="test_task")
+    # The agent's rewrite is applied in its own env, the other branches
+    # sample their own.
+    assert env.step.call_args_list[0].args[0] == rewrite_call()
+    assert llm.call_count == 3 + 2
+    # The other branches send their requests under their own routing key.
+    routing_key = f"{agent._uuid}/test_task"
+    assert [call.args for call in llm.fork.call_args_list] == [
+        (f"{routing_key}/branch1",),
+        (f"{routing_key}/branch2",),
+    ]
+    for branch_env in branch_envs:
+        assert branch_env.step.call_count == 1
+    # Only `max_branch_points` branch points, then regular steps.
+    assert env.step.call_count == 3
+    branch_envs[0].fork_into.assert_called_once_with(env)
@@ -0,0 +1,147 @@
+import re
+from unittest.mock import MagicMock, patch
+
+from debug_gym.agents.history_compactor import HistoryCompactor
+from debug_gym.agents.history_tracker import HistoryTracker, build_history_prompt
+from debug_gym.gym.tools.tool import ToolCall
+from debug_gym.llms.base import LLM, LLMConfig, LLMResponse
+from debug_gym.llms.routing import RoutingLLM
+
+
+class FakeLLM:
+    """Counts one token per word, and summarizes steps by their observations."""
+
+    context_length = 10_000
+
+    def __init__(self):
+        self.summary_requests = []
+
+    def format_tool_call_history(self, history_info, response):
+        return [{"role": "tool", "content": history_info.step_observation.observation}]
+
+    def tokenize(self, messages):
+        return [m["content"].split() for m in messages]
+
+    def count_tokens(self, messages):
+        if isinstance(messages, str):
+            return len(messages.split())
+        return sum(len(m["content"].split()) for m in messages)
+
+    def __call__(self, messages, tools):
+        self.summary_requests.append(messages[1]["content"])
+        observations = re.findall(r"obs\d+", messages[1]["content"])
+        summary = " ".join(dict.fromkeys(observations))
+        return LLMResponse(
+            prompt=messages,
+            response="",
+            tool=ToolCall(id="1", name=tools[0].name, arguments={"summary": summary}),
+        )
+
+
+def add_step(history, build_env_info, i):
+    info = build_env_info(
+        step_observation=f"obs{i} " + "word " * 9,  # 10 tokens.
+        action_tool_call=ToolCall(id=str(i), name="view", arguments={"i": i}),
+    )
+    history.step(info, [MagicMock()])
+
+
+def make_history(build_env_info, n_steps, memory_size=100):
+    history = HistoryTracker(memory_size)
+    for i in range(n_steps):
+        add_step(history, build_env_info, i)
+    return history
+
+
+def test_compactor_below_threshold_keeps_history(build_env_info):
+    llm = FakeLLM()
+    compactor = HistoryCompactor(max_tokens=100, keep_recent=2)
+    history = make_history(build_env_info, 5)
+    messages = build_history_prompt(history, llm, compactor=compactor)
+    assert len(messages) == 5
+    assert llm.summary_requests == []
+
+
+def test_compactor_summarizes_older_steps_incrementally(build_env_info):
+    llm = FakeLLM()
+    compactor = HistoryCompactor(max_tokens=50, keep_recent=2)
+    history = make_history(build_env_info, 6)  # 60 tokens.
+
+    messages = build_history_prompt(history, llm, compactor=compactor)
+    # Folded down to at most half of max_tokens: the 2 latest steps verbatim.
+    assert (
+        messages[0]["content"] == "Summary of the previous steps:\nobs0 obs1 obs2 obs3"
+    )
+    assert [m["content"].split()[0] for m in messages[1:]] == ["obs4", "obs5"]
+    assert llm.count_tokens(messages) <= 50
+
+    # The summary is reused while the prompt stays under the threshold.
+    for i in range(6, 8):
+        add_step(history, build_env_info, i)
+        messages = build_history_prompt(history, llm, compactor=compactor)
+    assert len(llm.summary_requests) == 1
+    assert len(messages) == 5
+
+    # Then extended with the newly folded steps only.
+    add_step(history, build_env_info, 8)
+    messages = build_history_prompt(history, llm, compactor=compactor)
+    assert len(llm.summary_requests) == 2
+    assert llm.summary_requests[1].startswith("Previous summary:\nobs0 obs1 obs2 obs3")
+    assert "obs3 " not in llm.summary_requests[1].split("New steps:")[1]
+    assert messages[0]["content"].endswith("obs0 obs1 obs2 obs3 obs4 obs5 obs6")
+    assert llm.count_tokens(messages) <= 50
+
+
+def test_compactor_folds_steps_out_of_memory_window(build_env_info):
+    llm = FakeLLM()
+    compactor = HistoryCompactor(max_tokens=1000, keep_recent=1)
+    history = make_history(build_env_info, 5, memory_size=3)
+    messages = build_history_prompt(history, llm, compactor=compactor)
+    assert messages[0]["content"].endswith("obs0 obs1")
+    assert len(messages) == 4
+
+
+def test_compactor_resets_with_history(build_env_info):
+    llm = FakeLLM()
+    compactor = HistoryCompactor(max_tokens=50, keep_recent=2)
+    build_history_prompt(make_history(build_env_info, 6), llm, compactor=compactor)
+    assert compactor.summary is not None
+
+    # A shorter history is a new episode.
+    messages = build_history_prompt(
+        make_history(build_env_info, 2), llm, compactor=compactor
+    )
+    assert len(messages) == 2 and compactor.summary is None
+
+
+def test_compactor_uses_summary_llm(build_env_info):
+    llm, summary_llm = FakeLLM(), FakeLLM()
+    compactor = HistoryCompactor(max_tokens=50, keep_recent=2, summary_llm=summary_llm)
+    build_history_prompt(make_history(build_env_info, 6), llm, compactor=compactor)
+    assert llm.summary_requests == []
+    assert len(summary_llm.summary_requests) == 1
+
+
+def test_compactor_leaves_routing_state(build_env_info):
+    backends = {"cheap": FakeLLM(), "capable": FakeLLM()}
+    config = LLMConfig(
+        model="router",
+        tokenizer="gpt-4o",
+        context_limit=4,
+        tags=["routing"],
+        routing={"models": list(backends), "after_tool": {"view": "cheap"}},
+    )
+    with patch.object(LLM, "instantiate", side_effect=lambda n, *a, **k: backends[n]):
+        llm = RoutingLLM("router", logger=MagicMock(), llm_config=config)
+    compactor = HistoryCompactor(max_tokens=50, keep_recent=2)
+
+    llm.escalate()  # E.g., a loop was detected.
+    build_history_prompt(make_history(build_env_info, 6), llm, compactor=compactor)
+    # The summary is written by the default model, outside of the episode.
+    assert len(backends["cheap"].summary_requests) == 1
+    assert llm.episode().step == 0
+    # The agent's next step is still escalated.
+    tool = MagicMock()
+    tool.name = "view"
+    response = llm([{"role": "system", "content": ""}] * 2, [tool])
+    assert response.serving.model == "capable"
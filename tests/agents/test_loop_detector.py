@@ -0,0 +1,65 @@
+import pytest
+
+from debug_gym.agents.loop_detector import LoopDetector, StepFingerprint
+from debug_gym.gym.tools.tool import ToolCall
+
+
+def step(build_env_info, name, observation, workspace="", **arguments):
+    info = build_env_info(
+        step_observation=observation,
+        action_tool_call=ToolCall(
+            id=f"call-{observation}", name=name, arguments=arguments
+        ),
+    )
+    return StepFingerprint.from_info(info, workspace)
+
+
+def test_loop_detector_exact_repeats(build_env_info):
+    detector = LoopDetector(window=10, max_repeats=2, actions=["warn", "stop"])
+    view = step(build_env_info, "view", "content", path="a.py")
+    assert detector.update(view) is None
+    assert detector.update(view) is None
+    event = detector.update(view)
+    assert (event.kind, event.repeats, event.action) == ("exact", 2, "warn")
+    # Actions escalate with the number of detections.
+    assert detector.update(view).action == "stop"
+    assert detector.update(view).action == "stop"
+
+    detector.reset()
+    assert detector.update(view) is None
+
+
+def test_loop_detector_oscillation(build_env_info):
+    detector = LoopDetector(max_repeats=2)
+    a = step(build_env_info, "view", "A", path="a.py")
+    b = step(build_env_info, "view", "B", path="b.py")
+    events = [detector.update(s) for s in (a, b, a, b, a)]
+    assert events[:4] == [None] * 4
+    assert events[4].kind == "exact"
+
+
+def test_loop_detector_near_duplicates(build_env_info):
+    detector = LoopDetector(max_repeats=1)
+    first = step(build_env_info, "eval", "1 failed in 0.53s at 0x7f00", target="t")
+    second = step(build_env_info, "eval", "1 failed in 0.61s at 0x7f42", target="t")
+    assert detector.update(first) is None
+    assert detector.update(second).kind == "near"
+
+
+def test_loop_detector_progress_is_not_a_loop(build_env_info):
+    detector = LoopDetector(window=2, max_repeats=1)
+    # Same action and observation, but the workspace changed in between.
+    assert detector.update(step(build_env_info, "eval", "fail", "diff1")) is None
+    assert detector.update(step(build_env_info, "eval", "fail", "diff2")) is None
+    # Steps out of the window are forgotten.
+    assert detector.update(step(build_env_info, "view", "x", "diff2")) is None
+    assert detector.update(step(build_env_info, "eval", "fail", "diff1")) is None
+
+
+def test_loop_detector_from_config():
+    assert LoopDetector.from_config(None) is None
+    assert LoopDetector.from_config(True).actions == ["warn", "stop"]
+    detector = LoopDetector.from_config({"window": 5, "actions": ["escalate"]})
+    assert detector.window == 5 and detector.actions == ["escalate"]
+    with pytest.raises(ValueError):
+        LoopDetector(actions=["retry"])
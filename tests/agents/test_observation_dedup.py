@@ -0,0 +1,106 @@
+from unittest.mock import MagicMock
+
+from debug_gym.agents.history_compactor import HistoryCompactor
+from debug_gym.agents.history_tracker import HistoryTracker, build_history_prompt
+from debug_gym.agents.observation_dedup import ObservationDeduplicator
+from debug_gym.gym.tools.tool import ToolCall
+
+FILE = "\n".join(f"{i:4} line {i} of the file" for i in range(1, 41))
+
+
+def make_info(build_env_info, observation, name="view", **arguments):
+    return build_env_info(
+        step_observation=observation,
+        action_tool_call=ToolCall(id=name, name=name, arguments=arguments),
+    )
+
+
+def test_dedup_exact_repeat(build_env_info):
+    dedup = ObservationDeduplicator()
+    infos = [
+        make_info(build_env_info, FILE, path="a.py"),
+        make_info(build_env_info, "short output", name="eval"),
+        make_info(build_env_info, FILE, path="a.py"),
+        make_info(build_env_info, "short output", name="eval"),
+    ]
+    deduped = dedup(infos)
+    assert deduped[0] is infos[0]
+    assert deduped[2].step_observation.observation == (
+        '[Same output as the earlier `view` call with arguments {"path": "a.py"}.]'
+    )
+    assert deduped[2].action_tool_call == infos[2].action_tool_call
+    # Short observations are kept.
+    assert deduped[3] is infos[3]
+    # The history itself is untouched.
+    assert infos[2].step_observation.observation == FILE
+
+
+def test_dedup_near_repeat_with_diff(build_env_info):
+    dedup = ObservationDeduplicator()
+    frame = "Context around the current frame:\n" + FILE
+    first = make_info(build_env_info, "(Pdb) p x\n1\n" + frame, name="pdb")
+    second = make_info(build_env_info, "(Pdb) p y\n2\n" + frame, name="pdb")
+    deduped = dedup([first, second])
+    observation = deduped[1].step_observation.observation
+    assert observation.startswith("[Same output as the earlier `pdb` call")
+    assert "-(Pdb) p x\n-1\n+(Pdb) p y\n+2" in observation
+    assert len(observation) < len(second.step_observation.observation) / 2
+
+
+def test_dedup_keeps_different_observations(build_env_info):
+    dedup = ObservationDeduplicator()
+    other = "\n".join(f"{i:4} something else entirely" for i in range(1, 41))
+    infos = [
+        make_info(build_env_info, FILE, path="a.py"),
+        make_info(build_env_info, other, path="b.py"),
+    ]
+    assert dedup(infos) == infos
+
+
+def test_dedup_from_config():
+    assert ObservationDeduplicator.from_config(None) is None
+    assert ObservationDeduplicator.from_config(True).min_length == 300
+    assert ObservationDeduplicator.from_config({"similarity": 0.9}).similarity == 0.9
+
+
+def test_build_history_prompt_dedup(build_env_info):
+    llm = MagicMock()
+    llm.format_tool_call_history = lambda info, response: [
+        {"role": "tool", "content": info.step_observation.observation}
+    ]
+    history = HistoryTracker(history_steps=2)
+    for _ in range(3):
+        history.step(make_info(build_env_info, FILE, path="a.py"), [MagicMock()])
+
+    messages = build_history_prompt(
+        history, llm, deduplicator=ObservationDeduplicator()
+    )
+    # Only the steps in the window are referenced.
+    assert messages[0]["content"] == FILE
+    assert messages[1]["content"].startswith("[Same output as")
+
+
+def test_compactor_dedup_after_summary(build_env_info):
+    llm = MagicMock()
+    llm.format_tool_call_history = lambda info, response: [
+        {"role": "tool", "content": info.step_observation.observation}
+    ]
+    llm.count_tokens = lambda messages: (
+        len(messages)
+        if isinstance(messages, str)
+        else sum(len(m["content"]) for m in messages)
+    )
+    llm.context_length = 100_000
+    llm.return_value.tool.arguments = {"summary": "Viewed a.py."}
+    history = HistoryTracker(history_steps=100)
+    for _ in range(3):
+        history.step(make_info(build_env_info, FILE, path="a.py"), [MagicMock()])
+
+    compactor = HistoryCompactor(max_tokens=len(FILE), keep_recent=1)
+    messages = build_history_prompt(
+        history, llm, compactor=compactor, deduplicator=ObservationDeduplicator()
+    )
+    # The step referring to the summarized one is now shown verbatim.
+    assert messages[0]["content"] == "Summary of the previous steps:\nViewed a.py."
+    assert messages[1] == {"role": "tool", "content": FILE}
+    assert messages[2]["content"].startswith("[Same output as")
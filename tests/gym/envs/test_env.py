@@ -1,3 +1,4 @@
+from concurrent.futures import ThreadPoolExecutor
 from pathlib import Path
 from unittest.mock import MagicMock, call, patch
 
@@ -5,9 +6,18 @@ import numpy as np
 import pytest
 
 from debug_gym.gym.entities import EvalOutput, Event, Observation
-from debug_gym.gym.envs.env import EnvInfo, EventHooks, RepoEnv, TooledEnv
+from debug_gym.gym.envs.env import (
+    EnvInfo,
+    EventHooks,
+    ImpactIndex,
+    RepoEnv,
+    TooledEnv,
+    changed_lines,
+    select_pytest_tests,
+)
 from debug_gym.gym.tools.tool import ToolCall
 from debug_gym.gym.tools.toolbox import Toolbox
+from debug_gym.gym.workspace import SANDBOX_PYCACHE_DIR, SandboxSnapshot
 
 
 @pytest.fixture
@@ -239,6 +249,72 @@ def test_reset(tmp_path):
     )
 
 
+@patch.object(RepoEnv, "setup_terminal")
+@patch.object(RepoEnv, "setup_workspace")
+def test_reset_reuse_sandbox(mock_setup_workspace, mock_setup_terminal):
+    terminal = MagicMock(sessions=[])
+    terminal.run.return_value = (True, "1 7")
+    env = RepoEnv(terminal=terminal, reuse_sandbox=True)
+    env.workspace = MagicMock()
+    snapshot = SandboxSnapshot(
+        key=(None, None),
+        commit="abc",
+        preserved_paths=[],
+        restore_paths=[],
+        archived_paths=[],
+        verify_paths=[],
+        manifest="123",
+    )
+    env.workspace.snapshot.return_value = snapshot
+
+    # First reset sets up the sandbox and records its state.
+    env.reset()
+    assert not env.sandbox_reused
+    assert mock_setup_terminal.call_count == 1
+    env.workspace.snapshot.assert_called_once_with(
+        (None, None), restore_paths=[], verify_paths=[]
+    )
+    assert env._sandbox_pids == ["1", "7"]
+
+    # Same sandbox key, the sandbox is restored in place.
+    env.workspace.restore.return_value = True
+    env.reset()
+    assert env.sandbox_reused
+    assert mock_setup_terminal.call_count == 1
+    assert mock_setup_workspace.call_count == 2
+    env.workspace.restore.assert_called_once_with(snapshot)
+    kill_command = terminal.run.call_args_list[-1].args[0]
+    assert kill_command.startswith('keep=" 1 7 "; ')
+    terminal.close.assert_not_called()
+
+    # Restored sandbox doesn't match the snapshot, a new sandbox is set up.
+    env.workspace.restore.return_value = False
+    env.reset()
+    assert not env.sandbox_reused
+    assert mock_setup_terminal.call_count == 2
+    terminal.close.assert_called_once()
+
+    # Different sandbox key, a new sandbox is set up.
+    env.base_image = "other_image"
+    env.reset()
+    assert not env.sandbox_reused
+    assert mock_setup_terminal.call_count == 3
+    assert env.workspace.restore.call_count == 2
+    assert terminal.close.call_count == 2
+
+
+@patch.object(RepoEnv, "setup_terminal")
+@patch.object(RepoEnv, "setup_workspace")
+def test_reset_without_reuse_sandbox(mock_setup_workspace, mock_setup_terminal):
+    env = RepoEnv(terminal=MagicMock(sessions=[]))
+    env.workspace = MagicMock()
+    env.reset()
+    env.reset()
+    assert mock_setup_terminal.call_count == 2
+    env.workspace.snapshot.assert_not_called()
+    env.workspace.restore.assert_not_called()
+
+
 def test_rewrite_counter(env):
     env_info = env.reset()
     assert env.rewrite_counter == 0
@@ -456,3 +532,352 @@ def test_has_breakpoint_relative_path(tmp_path):
     assert env.has_breakpoint("foo.py", 6) is False
     # Should return False for non-existent file
     assert env.has_breakpoint("bar.py", line_number) is False
+
+
+def test_fork_into(env):
+    env.reset()
+    env.workspace.write_file("file1.txt", "Hello, World!")
+    env.workspace.write_file("new.txt", "New file")
+    env.current_breakpoints_state = {f"{env.working_dir}/file1.txt|||1": "b 1"}
+    env.rewrite_counter = 2
+    patch = env.patch
+
+    fork = RepoEnv(path=env.path, dir_tree_depth=2)
+    infos = env.fork_into(fork)
+    assert fork.workspace.read_file("file1.txt") == "Hello, World!"
+    assert fork.workspace.read_file("new.txt") == "New file"
+    assert fork.current_breakpoints_state == env.current_breakpoints_state
+    assert infos.rewrite_counter == fork.rewrite_counter == 2
+    assert "new.txt" in infos.dir_tree
+    # Collecting the changes leaves the git index untouched.
+    assert env.patch == patch
+
+
+def test_fork_into_given_changes(env):
+    env.reset()
+    env.workspace.write_file("file1.txt", "Hello, World!")
+    changes = env.changes
+    env.workspace.write_file("file1.txt", "Changed after")
+
+    fork = RepoEnv(path=env.path, dir_tree_depth=2)
+    env.fork_into(fork, changes=changes)
+    assert fork.workspace.read_file("file1.txt") == "Hello, World!"
+
+
+def test_changes_digest(env):
+    env.reset()
+    digest = env.changes_digest
+    assert len(digest) == 40
+    env.workspace.write_file("new.txt", "New file")
+    assert env.changes_digest != digest
+    env.terminal.run("rm new.txt", raises=True)
+    assert env.changes_digest == digest
+
+
+def test_apply_patch_concurrently(env):
+    env.reset()
+    patches = []
+    for i in range(4):
+        env.workspace.write_file("file1.txt", f"Fork {i}\n" * 1000)
+        patches.append(env.changes)
+
+    forks = [RepoEnv(path=env.path) for _ in patches]
+    for fork in forks:
+        fork.reset()
+    # The environments share the sandbox scripts directory.
+    with ThreadPoolExecutor(len(forks)) as executor:
+        list(executor.map(RepoEnv.apply_patch, forks, patches))
+    for i, fork in enumerate(forks):
+        assert fork.workspace.read_file("file1.txt") == f"Fork {i}\n" * 1000
+
+
+def test_evaluate(tmp_path):
+    (tmp_path / "test.py").write_text("def test_1():\n  assert False\n")
+    env = RepoEnv(path=tmp_path, entrypoint="pytest test.py", max_score=1)
+    env.reset()
+    assert env.infos.eval_observation is None
+
+    env.workspace.write_file("test.py", "def test_1():\n  assert True\n")
+    infos = env.evaluate()
+    assert "1 passed" in infos.eval_observation.observation
+    assert infos.score == env.score == 1
+    assert infos.resolved and infos.terminated
+    assert env.infos is infos
+
+
+@pytest.mark.parametrize(
+    "entrypoint,expected",
+    [
+        ("python -m pdb -m pytest -sq .", "python -m pdb -m pytest -sq T"),
+        (
+            "python -m pdb $(which pytest) -p no:cacheprovider -k fast tests a.py",
+            "python -m pdb $(which pytest) -p no:cacheprovider -k fast T",
+        ),
+        (
+            "python -m pdb .venv/bin/pytest --tb=short tests && echo done",
+            "python -m pdb .venv/bin/pytest --tb=short T && echo done",
+        ),
+        ("python -m pdb app.py", "python -m pdb app.py"),
+    ],
+)
+def test_select_pytest_tests(entrypoint, expected):
+    tests = ["tests/a.py::test_b[x-1]", "test_c"]
+    expected = expected.replace("T", "'tests/a.py::test_b[x-1]'")
+    assert select_pytest_tests(entrypoint, tests) == expected
+    assert select_pytest_tests(entrypoint, ["test_c"]) == entrypoint
+
+
+def test_targeted_debug_entrypoint(tmp_path):
+    (tmp_path / "test_a.py").write_text(
+        "def test_pass():\n  pass\n\ndef test_fail():\n  assert False\n"
+    )
+    (tmp_path / "test_b.py").write_text("def test_error(missing):\n  pass\n")
+    env = RepoEnv(path=tmp_path)
+    env.reset()
+    assert env.targeted_debug_entrypoint() == env.debug_entrypoint
+
+    env.eval()
+    assert env.failing_tests() == ["test_a.py::test_fail", "test_b.py::test_error"]
+    assert env.targeted_debug_entrypoint() == (
+        "python -m pdb -m pytest -sq test_a.py::test_fail test_b.py::test_error"
+    )
+
+
+def test_eval_many(tmp_path):
+    (tmp_path / "mod.py").write_text("VALUE = 0\n")
+    (tmp_path / "test.py").write_text(
+        "import mod\n\n"
+        "def test_1():\n"
+        "  assert mod.VALUE == int(open('lib/data/value.txt').read())\n"
+    )
+    # Ignored files are available in the worktrees.
+    (tmp_path / ".gitignore").write_text("lib/data/\n")
+    (tmp_path / "lib" / "data").mkdir(parents=True)
+    (tmp_path / "lib" / "data" / "value.txt").write_text("1")
+    env = RepoEnv(path=tmp_path, entrypoint="pytest test.py", max_score=1)
+    env.reset()
+    env.workspace.write_file("mod.py", "VALUE = 1\n")
+    fix = env.changes
+    env.workspace.write_file("mod.py", "VALUE = 2\n")
+    wrong = env.changes
+    env.workspace.write_file("mod.py", "VALUE = 3\n")
+
+    results = env.eval_many([fix, wrong, "not a patch", ""], max_workers=2)
+    assert [result.score for result in results] == [1, 0, 0, 0]
+    assert "1 passed" in results[0].eval_output.output
+    assert "Cannot apply patch" in results[2].eval_output.output
+    # The working directory and the state of the environment are untouched.
+    assert env.workspace.read_file("mod.py") == "VALUE = 3\n"
+    assert env.last_eval is None and env.score == 0
+    _, worktrees = env.terminal.run("git worktree list")
+    assert len(worktrees.splitlines()) == 1
+
+
+def test_eval_many_untracked_tests(tmp_path):
+    (tmp_path / "mod.py").write_text("VALUE = 0\n")
+    env = RepoEnv(path=tmp_path, entrypoint="python -m pytest extra_tests", max_score=1)
+    env.reset()
+    # Added after setup and never committed, like R2E-Gym's `r2e_tests`.
+    env.terminal.run("mkdir extra_tests", raises=True)
+    env.workspace.write_file(
+        "extra_tests/test_mod.py",
+        "import mod\n\ndef test_value():\n  assert mod.VALUE == 1\n",
+    )
+    _, untracked = env.terminal.run("git status --porcelain --ignored")
+    assert "?? extra_tests/" in untracked
+
+    results = env.eval_many(["", _patch(env, "mod.py", "VALUE = 1\n")])
+    assert "1 failed" in results[0].eval_output.output
+    assert "1 passed" in results[1].eval_output.output
+    assert [result.score for result in results] == [0, 1]
+
+
+def _patch(env, path, content):
+    """The changes of the environment with `path` rewritten, which is restored."""
+    original = env.workspace.read_file(path)
+    env.workspace.write_file(path, content)
+    patch = env.changes
+    env.workspace.write_file(path, original)
+    return patch
+
+
+def test_cpu_quota(env):
+    env.terminal = MagicMock()
+    env.terminal.run.return_value = (True, "8\n200000 100000")
+    assert env.cpu_quota() == 2
+    env.terminal.run.return_value = (True, "8\nmax 100000")
+    assert env.cpu_quota() == 8
+    env.terminal.run.return_value = (True, "4")
+    assert env.cpu_quota() == 4
+
+
+def test_bytecode_cache(tmp_path):
+    (tmp_path / "mod.py").write_text("VALUE = 1\n")
+    (tmp_path / "test.py").write_text(
+        "import sys, mod\n\n"
+        "def test_1():\n"
+        "  assert mod.__cached__.startswith(sys.pycache_prefix)\n"
+    )
+    env = RepoEnv(path=tmp_path, entrypoint="pytest test.py", bytecode_cache=True)
+    env.reset()
+    cache_dir = Path(SANDBOX_PYCACHE_DIR + str(env.working_dir))
+    assert list(cache_dir.glob("mod.*.pyc"))
+    # Runs read the bytecode from the cache, and never write to the workspace.
+    assert env.eval().success
+    assert not list(env.working_dir.rglob("__pycache__"))
+    assert env.changes == ""
+
+
+def test_watch_files(tmp_path):
+    (tmp_path / "mod.py").write_text("VALUE = 1\n")
+    env = RepoEnv(path=tmp_path, watch_files=True)
+    tool = MagicMock()
+    tool.name = "bash"
+    tool.on_file_change.return_value = None
+    env.add_tool(tool)
+    env.event_hooks.subscribe(Event.FILE_CHANGE, tool)
+    env.reset()
+    assert env.workspace.watching_files
+
+    def run(command):
+        tool.side_effect = lambda env, **kwargs: Observation(
+            "bash", env.terminal.run(command)[1]
+        )
+        return env.step(ToolCall(id="1", name="bash", arguments={}))
+
+    # Files changed by any command of a step are reported to the tools.
+    infos = run("echo 'VALUE = 2' > mod.py && touch new.py")
+    tool.on_file_change.assert_called_once_with(
+        env, changes={"mod.py": "modified", "new.py": "created"}
+    )
+    assert "new.py" in infos.dir_tree
+
+    # The directory tree is only listed again after files are created or deleted.
+    with patch.object(env.workspace, "display_files") as display_files:
+        infos = run("echo 'VALUE = 3' > mod.py")
+        display_files.assert_not_called()
+    assert "new.py" in infos.dir_tree
+    tool.on_file_change.assert_called_with(env, changes={"mod.py": "modified"})
+
+    env.close()
+    assert not env.workspace.watching_files
+
+
+def test_changed_lines():
+    diff = (
+        "diff --git a/calc.py b/calc.py\n"
+        "--- a/calc.py\n"
+        "+++ b/calc.py\n"
+        "@@ -2 +2 @@ def add(a, b):\n"
+        "-    return a + b\n"
+        "+    return b + a\n"
+        "@@ -10,0 +11,2 @@ def mul(a, b):\n"
+        "+# Inserted lines.\n"
+        "+\n"
+        "diff --git a/old.py b/old.py\n"
+        "deleted file mode 100644\n"
+        "--- a/old.py\n"
+        "+++ /dev/null\n"
+        "@@ -1,3 +0,0 @@\n"
+        "diff --git a/new.py b/new.py\n"
+        "new file mode 100644\n"
+        "--- /dev/null\n"
+        "+++ b/new.py\n"
+        "@@ -0,0 +1 @@\n"
+        "+--- a/fake.py\n"
+        "diff --git a/data.bin b/data.bin\n"
+        "Binary files a/data.bin and b/data.bin differ\n"
+    )
+    assert changed_lines(diff) == {
+        "calc.py": {2, 10, 11},
+        "old.py": {1, 2, 3},
+        "data.bin": set(),
+    }
+
+
+def test_impact_index_skippable_tests():
+    impact = ImpactIndex(
+        shared={"calc.py": {1, 5}},
+        tests={
+            "test_add": {"calc.py": {2}},
+            "test_mul": {"calc.py": {6}},
+            "test_fail": {"calc.py": {2}},
+        },
+        outcomes={"test_add": "passed", "test_mul": "passed", "test_fail": "failed"},
+    )
+    assert impact.skippable_tests({"calc.py": {6}}) == ["test_add"]
+    assert impact.skippable_tests({"calc.py": {2}}) == ["test_mul"]
+    # Tests which did not pass are always run.
+    assert impact.skippable_tests({"calc.py": {3}}) == ["test_add", "test_mul"]
+    # Changes in shared code or in files not executed by the tests impact all.
+    assert impact.skippable_tests({"calc.py": {5}}) == []
+    assert impact.skippable_tests({"calc.py": {6}, "data.txt": {1}}) == []
+
+
+def test_test_impact(tmp_path):
+    (tmp_path / "calc.py").write_text(
+        "def add(a, b):\n    return a + b\n\n\ndef mul(a, b):\n    return a + b\n"
+    )
+    (tmp_path / "test_calc.py").write_text(
+        "import calc\n\n"
+        "def test_add():\n    assert calc.add(1, 2) == 3\n\n"
+        "def test_mul():\n    assert calc.mul(2, 3) == 6\n"
+    )
+    env = RepoEnv(path=tmp_path, entrypoint="python -m pytest -sq .", test_impact=True)
+    env.reset()
+    # Without changes, only the failing tests are run.
+    eval_output = env.eval(impacted_tests_only=True)
+    assert "1 failed, 1 deselected" in eval_output.output
+    assert eval_output.skipped_tests == ["test_calc.py::test_add"]
+
+    env.workspace.write_file(
+        "calc.py",
+        "def add(a, b):\n    return a + b\n\n\ndef mul(a, b):\n    return a * b\n",
+    )
+    eval_output = env.eval(impacted_tests_only=True)
+    assert eval_output.success
+    assert "1 passed, 1 deselected" in eval_output.output
+    assert eval_output.skipped_tests == ["test_calc.py::test_add"]
+    assert "1 tests not impacted by the changes were not run" in eval_output.output
+    # Full evals run all the tests.
+    eval_output = env.eval()
+    assert "2 passed" in eval_output.output
+    assert eval_output.skipped_tests == []
+
+
+def test_test_impact_partial_eval_does_not_resolve(tmp_path):
+    (tmp_path / "calc.py").write_text(
+        "def add(a, b):\n    return a + b\n\n\ndef mul(a, b):\n    return a + b\n"
+    )
+    (tmp_path / "test_calc.py").write_text(
+        "import calc\n\n"
+        "def test_add():\n    assert calc.add(1, 2) == 3\n\n"
+        "def test_mul():\n    assert calc.mul(2, 3) == 6\n"
+    )
+    env = RepoEnv(
+        path=tmp_path,
+        entrypoint="python -m pytest -sq .",
+        test_impact=True,
+        max_score=1,
+    )
+    env.add_tool(Toolbox.get_tool("eval"))
+    env.reset()
+    env.workspace.write_file(
+        "calc.py",
+        "def add(a, b):\n    return a + b\n\n\ndef mul(a, b):\n    return a * b\n",
+    )
+    # A new file, outside of the changes of the impact index, breaks test_add.
+    env.workspace.write_file(
+        "conftest.py",
+        "import pytest\n\n"
+        "@pytest.fixture(autouse=True)\n"
+        "def broken(request):\n"
+        "    assert request.node.name != 'test_add'\n",
+    )
+    assert env.eval(impacted_tests_only=True).success  # Only test_mul ran.
+
+    # The partial eval would resolve the task, all the tests are run instead.
+    infos = env.step(ToolCall(id="1", name="eval", arguments={}))
+    assert env.last_eval.skipped_tests == []
+    assert "1 error" in infos.eval_observation.observation
+    assert not infos.resolved and not infos.terminated
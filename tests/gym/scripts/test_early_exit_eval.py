@@ -0,0 +1,96 @@
+import json
+import subprocess
+import sys
+from importlib.resources import files as importlib_files
+
+import pytest
+
+from debug_gym.gym.scripts.early_exit_eval import TRUNCATED_MARKER, parse_outcome
+
+SCRIPT = str(importlib_files("debug_gym") / "gym" / "scripts" / "early_exit_eval.py")
+
+
+@pytest.mark.parametrize(
+    "line,expected",
+    [
+        (
+            "r2e_tests/test_1.py::test_a PASSED                 [ 50%]",
+            ("test_a", "PASSED"),
+        ),
+        (
+            "r2e_tests/test_1.py::TestA::test_b[x y] FAILED",
+            ("TestA.test_b[x y]", "FAILED"),
+        ),
+        ("\x1b[32mr2e_tests/test_1.py::test_c ERROR\x1b[0m", ("test_c", "ERROR")),
+        ("FAILED r2e_tests/test_1.py::test_a - AssertionError", None),
+        ("collected 2 items", None),
+    ],
+)
+def test_parse_outcome(line, expected):
+    assert parse_outcome(line) == expected
+
+
+def run_script(tmp_path, expected_output, lines):
+    expected_output_file = tmp_path / "expected_output.json"
+    expected_output_file.write_text(json.dumps(expected_output))
+    marker = tmp_path / "finished"
+    command = "; ".join(f"echo '{line}'" for line in lines)
+    command += f"; sleep 0.5; touch {marker}"
+    result = subprocess.run(
+        [sys.executable, SCRIPT, str(expected_output_file), command],
+        capture_output=True,
+        text=True,
+    )
+    return result, marker.exists()
+
+
+def test_early_exit_eval_all_match(tmp_path):
+    lines = ["t.py::test_a PASSED", "t.py::test_b FAILED"]
+    result, finished = run_script(
+        tmp_path, {"test_a": "PASSED", "test_b": "FAILED"}, lines
+    )
+    assert finished
+    assert result.returncode == 0
+    assert result.stdout == "t.py::test_a PASSED\nt.py::test_b FAILED\n"
+
+
+def test_early_exit_eval_mismatch(tmp_path):
+    lines = ["t.py::test_a FAILED", "t.py::test_b FAILED", "t.py::test_c PASSED"]
+    result, finished = run_script(
+        tmp_path, {"test_a": "PASSED", "test_b": "FAILED", "test_c": "PASSED"}, lines
+    )
+    assert not finished  # The test command was killed.
+    assert result.returncode == 1
+    # The outcome of a test is checked once the next test reports one.
+    assert result.stdout == (
+        "t.py::test_a FAILED\n"
+        "t.py::test_b FAILED\n"
+        f"\n{TRUNCATED_MARKER}: `test_a` FAILED (expected PASSED).\n"
+    )
+
+
+def test_early_exit_eval_unexpected_test(tmp_path):
+    lines = ["t.py::test_a PASSED", "t.py::test_c PASSED", "t.py::test_d PASSED"]
+    result, finished = run_script(tmp_path, {"test_a": "PASSED"}, lines)
+    assert not finished
+    assert f"{TRUNCATED_MARKER}: `test_c` PASSED (expected no such test)." in (
+        result.stdout
+    )
+
+
+@pytest.mark.parametrize(
+    "expected,truncated",
+    [
+        ("ERROR", False),  # The teardown error is the outcome of the test.
+        ("PASSED", True),
+    ],
+)
+def test_early_exit_eval_last_outcome_wins(tmp_path, expected, truncated):
+    lines = ["t.py::test_a PASSED", "t.py::test_a ERROR", "t.py::test_b PASSED"]
+    result, finished = run_script(
+        tmp_path, {"test_a": expected, "test_b": "PASSED"}, lines
+    )
+    assert finished is not truncated
+    assert (TRUNCATED_MARKER in result.stdout) is truncated
+    if truncated:
+        assert "`test_a` ERROR (expected PASSED)" in result.stdout
@@ -0,0 +1,91 @@
+import json
+import subprocess
+import sys
+from importlib.resources import files as importlib_files
+
+import pytest
+
+SCRIPT = str(importlib_files("debug_gym") / "gym" / "scripts" / "impact_index.py")
+
+CALC = """\
+def add(a, b):
+    return a + b
+
+
+def mul(a, b):
+    return a * b
+"""
+
+TESTS = """\
+import pytest
+
+import calc
+
+
+def test_add():
+    assert calc.add(1, 2) == 3
+
+
+def test_mul():
+    assert calc.mul(2, 3) == 5
+
+
+@pytest.mark.skip
+def test_skipped():
+    assert calc.add(0, 0) == 0
+"""
+
+
+@pytest.fixture
+def project(tmp_path):
+    (tmp_path / "calc.py").write_text(CALC)
+    (tmp_path / "test_calc.py").write_text(TESTS)
+    return tmp_path
+
+
+def lines(index, ranges_by_file):
+    return {index["files"][int(key)]: value for key, value in ranges_by_file.items()}
+
+
+@pytest.mark.parametrize("use_monitoring", [True, False])
+def test_impact_index(project, use_monitoring):
+    # Without `sys.monitoring`, the recorder falls back to `sys.settrace`.
+    launcher = (
+        "import runpy, sys\n"
+        f"if {not use_monitoring} and hasattr(sys, 'monitoring'): del sys.monitoring\n"
+        "sys.argv = sys.argv[1:]\n"
+        "runpy.run_path(sys.argv[0], run_name='__main__')\n"
+    )
+    index_file = project.parent / "index.json"
+    result = subprocess.run(
+        [sys.executable, "-c", launcher, SCRIPT, str(project), str(index_file)]
+        + ["-m", "pytest", "-q", "-p", "no:cacheprovider", "."],
+        cwd=project,
+        capture_output=True,
+        text=True,
+    )
+    # The exit code of pytest is preserved.
+    assert result.returncode == 1, result.stdout + result.stderr
+    assert "1 failed, 1 passed, 1 skipped" in result.stdout
+
+    index = json.loads(index_file.read_text())
+    tests = index["tests"]
+    assert {nodeid: test["outcome"] for nodeid, test in tests.items()} == {
+        "test_calc.py::test_add": "passed",
+        "test_calc.py::test_mul": "failed",
+        "test_calc.py::test_skipped": "skipped",
+    }
+    # The body of the functions is only executed by their test.
+    assert lines(index, tests["test_calc.py::test_add"]["lines"]) == {
+        "calc.py": "2",
+        "test_calc.py": "7",
+    }
+    assert lines(index, tests["test_calc.py::test_mul"]["lines"]) == {
+        "calc.py": "6",
+        "test_calc.py": "11",
+    }
+    assert tests["test_calc.py::test_skipped"]["lines"] == {}
+    # Imports and definitions are shared by all tests.
+    shared = lines(index, index["shared"])
+    assert shared["calc.py"] == "1,5"
+    assert shared["test_calc.py"] == "1,3,6,10,14-15"
@@ -0,0 +1,90 @@
+import json
+import subprocess
+import sys
+from importlib.resources import files as importlib_files
+
+import pytest
+
+SCRIPT = str(importlib_files("debug_gym") / "gym" / "scripts" / "trace_index.py")
+
+PROGRAM = """\
+class Calculator:
+    def add(self, a, b):
+        return a + b
+
+
+def total(values):
+    calc = Calculator()
+    result = 0
+    for value in values:
+        result = calc.add(result, value)
+    return result
+
+
+if __name__ == "__main__":
+    assert total([1, 2, 3]) == 7
+"""
+
+
+@pytest.fixture
+def program(tmp_path):
+    (tmp_path / "calc.py").write_text(PROGRAM)
+    (tmp_path / ".venv").mkdir()
+    (tmp_path / ".venv" / "lib.py").write_text("def ignored():\n    pass\n")
+    return tmp_path
+
+
+@pytest.mark.parametrize("use_monitoring", [True, False])
+def test_trace_index(program, use_monitoring):
+    # Without `sys.monitoring`, the tracer falls back to `sys.settrace`.
+    launcher = (
+        "import runpy, sys\n"
+        f"if {not use_monitoring} and hasattr(sys, 'monitoring'): del sys.monitoring\n"
+        f"sys.argv = sys.argv[1:]\n"
+        "runpy.run_path(sys.argv[0], run_name='__main__')\n"
+    )
+    index_file = program / "index.json"
+    result = subprocess.run(
+        [sys.executable, "-c", launcher, SCRIPT, str(program), str(index_file)]
+        + ["calc.py"],
+        cwd=program,
+        capture_output=True,
+        text=True,
+    )
+    # The exit code of the traced program is preserved.
+    assert result.returncode == 1
+    assert "AssertionError" in result.stderr
+
+    index = json.loads(index_file.read_text())
+    assert index["command"] == "calc.py"
+    assert index["functions"]["calc.py:total"] == {
+        "calls": 1,
+        "args": [{"values": "[1, 2, 3]"}],
+        "returns": ["6"],
+    }
+    add = index["functions"]["calc.py:Calculator.add"]
+    assert add["calls"] == 3
+    assert len(add["args"]) == 3  # Only the first calls are sampled.
+    assert add["args"][1]["a"] == "1" and add["args"][1]["b"] == "2"
+    assert add["returns"] == ["1", "3", "6"]
+    assert ["calc.py:total", "calc.py:Calculator.add", 3] in index["edges"]
+    assert ["calc.py:<module>", "calc.py:total", 1] in index["edges"]
+    assert index["lines"]["calc.py"]["3"] == 3
+    assert index["lines"]["calc.py"]["10"] == 3
+    assert "11" in index["lines"]["calc.py"]
+    assert all(".venv" not in key for key in index["functions"])
+
+
+def test_trace_index_module(program):
+    index_file = program / "index.json"
+    (program / "main.py").write_text("import calc\nprint(calc.total([4]))\n")
+    result = subprocess.run(
+        [sys.executable, SCRIPT, str(program), str(index_file), "-m", "main"],
+        cwd=program,
+        capture_output=True,
+        text=True,
+    )
+    assert result.returncode == 0
+    assert result.stdout == "4\n"
+    index = json.loads(index_file.read_text())
+    assert ["main.py:<module>", "calc.py:total", 1] in index["edges"]
@@ -0,0 +1,80 @@
+import json
+import subprocess
+import sys
+from importlib.resources import files as importlib_files
+
+from debug_gym.gym.utils import make_file_rules
+
+SCRIPT = str(importlib_files("debug_gym") / "gym" / "scripts" / "walk_tree.py")
+
+
+def walk_tree(root, max_depth, ignore=(), readonly=()):
+    filters = {
+        "base": str(root),
+        "ignore": [
+            [r.regex, r.negation] for r in make_file_rules(root, [], list(ignore))
+        ],
+        "readonly": [
+            [r.regex, r.negation] for r in make_file_rules(root, [], list(readonly))
+        ],
+    }
+    filters_file = root.parent / "filters.json"
+    filters_file.write_text(json.dumps(filters))
+    result = subprocess.run(
+        [sys.executable, SCRIPT, str(root), str(max_depth), str(filters_file)],
+        capture_output=True,
+        text=True,
+        check=True,
+    )
+    return json.loads(result.stdout)
+
+
+def names(entries):
+    return [entry["name"] for entry in entries]
+
+
+def test_walk_tree_depth_and_order(tmp_path):
+    root = tmp_path / "repo"
+    (root / "pkg" / "sub").mkdir(parents=True)
+    for name in ["file10.py", "file2.py", ".hidden", "pkg/mod.py", "pkg/sub/deep.py"]:
+        (root / name).touch()
+
+    entries = walk_tree(root, max_depth=2)
+    assert names(entries) == [".hidden", "file2.py", "file10.py", "pkg"]
+    pkg = entries[-1]
+    assert pkg["dir"] and names(pkg["children"]) == ["mod.py", "sub"]
+    # Directories beyond the maximum depth are listed, but not walked.
+    assert pkg["children"][1] == {
+        "name": "sub",
+        "dir": True,
+        "readonly": False,
+        "children": [],
+    }
+
+
+def test_walk_tree_filters(tmp_path):
+    root = tmp_path / "repo"
+    (root / "build" / "lib").mkdir(parents=True)
+    (root / "logs").mkdir()
+    for name in ["build/lib/out.so", "logs/a.log", "logs/keep.log", "test.py"]:
+        (root / name).touch()
+    entries = walk_tree(
+        root,
+        max_depth=3,
+        ignore=["build/", "*.log", "!keep.log"],
+        readonly=["test.py"],
+    )
+    assert names(entries) == ["logs", "test.py"]
+    assert names(entries[0]["children"]) == ["keep.log"]
+    assert entries[1]["readonly"] and not entries[0]["readonly"]
+
+
+def test_walk_tree_symlink_loop(tmp_path):
+    root = tmp_path / "repo"
+    (root / "pkg").mkdir(parents=True)
+    (root / "pkg" / "mod.py").touch()
+    (root / "pkg" / "loop").symlink_to(root / "pkg")
+
+    entries = walk_tree(root, max_depth=10)
+    loop = entries[0]["children"][0]
+    assert loop["name"] == "loop" and loop["dir"] and loop["children"] == []
@@ -0,0 +1,59 @@
+import json
+import subprocess
+import sys
+import time
+from importlib.resources import files as importlib_files
+
+SCRIPT = str(importlib_files("debug_gym") / "gym" / "scripts" / "watch_files.py")
+
+
+def start_watcher(root, feed_dir):
+    filters_file = root.parent / "filters.json"
+    filters_file.write_text(
+        json.dumps({"base": str(root), "ignore": [], "readonly": []})
+    )
+    process = subprocess.Popen(
+        [sys.executable, SCRIPT, str(root), str(feed_dir), str(filters_file)]
+    )
+    while not (feed_dir / "status").exists() or not (feed_dir / "status").read_text():
+        time.sleep(0.05)
+    return process
+
+
+def sync(feed_dir, token):
+    (feed_dir / "sync").write_text(token)
+    while (
+        not (feed_dir / "synced").exists() or (feed_dir / "synced").read_text() != token
+    ):
+        time.sleep(0.05)
+    return (feed_dir / "changes").read_text()
+
+
+def test_watch_files_sync_and_exit(tmp_path):
+    root, feed_dir = tmp_path / "repo", tmp_path / "feed"
+    (root / ".git").mkdir(parents=True)
+    (root / "__pycache__").mkdir()
+    feed_dir.mkdir()
+    process = start_watcher(root, feed_dir)
+    try:
+        assert (feed_dir / "status").read_text() == f"ready {process.pid}"
+        (root / "a.py").write_text("a")
+        (root / ".git" / "index").touch()
+        (root / "__pycache__" / "a.pyc").touch()
+        assert sync(feed_dir, "1") == "created\ta.py\n"
+        # Changes are only reported once.
+        assert sync(feed_dir, "2") == ""
+
+        # The watcher exits once the watched directory is deleted.
+        subprocess.run(["rm", "-rf", str(root)], check=True)
+        assert process.wait(timeout=10) == 0
+    finally:
+        process.kill()
+
+
+def test_watch_files_missing_root(tmp_path):
+    feed_dir = tmp_path / "feed"
+    feed_dir.mkdir()
+    process = start_watcher(tmp_path / "missing", feed_dir)
+    assert process.wait(timeout=10) == 1
+    assert (feed_dir / "status").read_text().startswith("error ")
@@ -1,4 +1,6 @@
+import gc
 import os
+import sys
 import time
 
 import docker
@@ -142,6 +144,19 @@ def test_terminal_cleanup(tmp_path):
     assert container_name not in [c.name for c in containers]
 
 
+def test_docker_terminal_without_docker(monkeypatch):
+    def from_env(**kwargs):
+        raise docker.errors.DockerException("Docker is not running.")
+
+    unraisable = []
+    monkeypatch.setattr(docker, "from_env", from_env)
+    monkeypatch.setattr(sys, "unraisablehook", unraisable.append)
+    with pytest.raises(docker.errors.DockerException):
+        DockerTerminal(base_image="ubuntu:latest")
+    gc.collect()
+    assert unraisable == []  # `__del__` does not fail on the half-built terminal.
+
+
 @pytest.if_docker_running
 def test_select_terminal_docker():
     config = {"type": "docker"}
@@ -1,13 +1,28 @@
+import errno
+import fcntl
 import os
 import platform
+import pty
+import select
 import subprocess
 import time
+from types import SimpleNamespace
+from unittest.mock import MagicMock, patch
 
 import pytest
 
 from debug_gym.gym.terminals import select_terminal
-from debug_gym.gym.terminals.kubernetes import KubernetesTerminal
-from debug_gym.gym.terminals.shell_session import DEFAULT_PS1
+from debug_gym.gym.terminals.kubernetes import (
+    PREPULL_APP_LABEL,
+    ImageLocality,
+    KubernetesShellSession,
+    KubernetesTerminal,
+)
+from debug_gym.gym.terminals.shell_session import (
+    DEFAULT_PS1,
+    ProcessNotRunningError,
+    ShellSession,
+)
 from debug_gym.gym.terminals.terminal import DISABLE_ECHO_COMMAND
 
 
@@ -322,3 +337,374 @@ def test_kubernetes_terminal_readonly_properties_after_pod_creation():
         terminal.working_dir = "/new/path"
 
     terminal.close()
+
+
+class FakeExecClient:
+    """Emulates the exec websocket of the Kubernetes API (`WSClient` with a TTY)
+    by running the command in a local PTY."""
+
+    def __init__(self, command):
+        self._fd, client = pty.openpty()
+        flags = fcntl.fcntl(self._fd, fcntl.F_GETFL)
+        fcntl.fcntl(self._fd, fcntl.F_SETFL, flags | os.O_NONBLOCK)
+        self.process = subprocess.Popen(
+            command,
+            stdin=client,
+            stdout=client,
+            stderr=client,
+            start_new_session=True,
+        )
+        os.close(client)
+        self._open = True
+        self._stdout = ""
+
+    def is_open(self):
+        return self._open
+
+    def update(self, timeout=0):
+        if not self._open or not select.select([self._fd], [], [], timeout)[0]:
+            return
+        try:
+            self._stdout += os.read(self._fd, 1024).decode()
+        except OSError as e:
+            if e.errno != errno.EIO:
+                raise
+            self._open = False  # The command exited.
+
+    def peek_stdout(self):
+        return bool(self._stdout)
+
+    def read_stdout(self):
+        output, self._stdout = self._stdout, ""
+        return output
+
+    def peek_stderr(self):
+        return False
+
+    def write_stdin(self, data):
+        os.write(self._fd, data.encode())
+
+    def close(self):
+        if self._open:
+            self.process.kill()
+            os.close(self._fd)
+            self._open = False
+
+
+@pytest.fixture
+def fake_exec_server():
+    clients = []
+
+    def fake_stream(func, **kwargs):
+        assert kwargs["stdin"] and kwargs["tty"]
+        clients.append((kwargs, FakeExecClient(kwargs["command"])))
+        return clients[-1][1]
+
+    with patch("debug_gym.gym.terminals.kubernetes.stream.stream", fake_stream):
+        yield clients
+
+
+def make_k8s_session(**kwargs):
+    pod = MagicMock(namespace="default")
+    pod.name = "dbg-gym-pod"
+    return KubernetesShellSession(
+        k8s_client=MagicMock(),
+        pod=pod,
+        session_commands=[DISABLE_ECHO_COMMAND],
+        env_vars={"PS1": DEFAULT_PS1},
+        **kwargs,
+    )
+
+
+@if_is_linux
+def test_kubernetes_shell_session(fake_exec_server):
+    session = make_k8s_session()
+    assert not session.is_running
+    output = session.run("echo Hello World", timeout=5)
+    assert output == f"{DISABLE_ECHO_COMMAND}Hello World"
+    assert session.is_running
+
+    kwargs, _ = fake_exec_server[0]
+    assert kwargs["name"] == "dbg-gym-pod"
+    assert kwargs["namespace"] == "default"
+    assert kwargs["container"] == "main"
+    assert kwargs["command"] == [
+        "env",
+        f"PS1={DEFAULT_PS1}",
+        "/bin/bash",
+        "--noprofile",
+        "--norc",
+        "--noediting",
+    ]
+
+    session.run("export TEST_VAR='FooBar'", timeout=5)
+    assert session.run("echo $TEST_VAR", timeout=5) == "FooBar"
+    session.close()
+    assert not session.is_running
+
+
+@if_is_linux
+def test_kubernetes_shell_session_pdb(tmp_path, fake_exec_server):
+    (tmp_path / "loop.py").write_text("i = 0\nwhile True:\n    i += 1\n")
+    session = make_k8s_session()
+
+    output = session.start(f"python -m pdb {tmp_path}/loop.py", read_until="(Pdb)")
+    assert "loop.py(1)<module>()" in output
+    assert fake_exec_server[0][0]["command"][-2:] == [
+        "-c",
+        f"{DISABLE_ECHO_COMMAND} && python -m pdb {tmp_path}/loop.py",
+    ]
+
+    with pytest.raises(TimeoutError):
+        session.run("c", read_until="(Pdb)", timeout=1, close_on_timeout=False)
+    output = session.interrupt(read_until="(Pdb)", timeout=5)
+    assert "Program interrupted." in output
+    assert session.run("p i > 0", read_until="(Pdb)", timeout=5) == "True"
+
+    # Restarting the session opens a new websocket.
+    session.start(f"python -m pdb {tmp_path}/loop.py", read_until="(Pdb)")
+    assert len(fake_exec_server) == 2
+    assert not fake_exec_server[0][1].is_open()
+    session.close()
+
+
+def test_kubernetes_shell_session_connection_error():
+    session = make_k8s_session()
+    with patch(
+        "debug_gym.gym.terminals.kubernetes.stream.stream",
+        side_effect=ValueError("Handshake status 403 Forbidden"),
+    ):
+        with pytest.raises(ProcessNotRunningError, match="403 Forbidden"):
+            session._spawn(["/bin/bash"])
+    assert not session.is_running
+
+
+@pytest.mark.parametrize("kubectl_sessions", [False, True])
+@patch("debug_gym.gym.terminals.kubernetes.client")
+@patch("debug_gym.gym.terminals.kubernetes.config")
+def test_kubernetes_terminal_new_shell_session(config, client, kubectl_sessions):
+    terminal = KubernetesTerminal(
+        base_image="ubuntu:latest",
+        kube_config="incluster",
+        kubectl_sessions=kubectl_sessions,
+    )
+    terminal._pod = MagicMock(namespace="default")
+    terminal._pod.name = "dbg-gym-pod"
+    session = terminal.new_shell_session()
+    assert terminal.sessions == [session]
+    if kubectl_sessions:
+        assert type(session) is ShellSession
+        assert session.shell_command.startswith("kubectl exec -it dbg-gym-pod")
+    else:
+        assert isinstance(session, KubernetesShellSession)
+        assert session.pod is terminal._pod
+        assert session.k8s_client is terminal.k8s_client
+    assert session.session_commands == [DISABLE_ECHO_COMMAND]
+    terminal._pod = None
+
+
+def make_node(name, images=(), unschedulable=None):
+    return SimpleNamespace(
+        metadata=SimpleNamespace(name=name),
+        spec=SimpleNamespace(unschedulable=unschedulable),
+        status=SimpleNamespace(
+            images=[SimpleNamespace(names=list(names)) for names in images]
+        ),
+    )
+
+
+class FakeCoreV1Api:
+    """Emulates the nodes and pods endpoints of the Kubernetes API."""
+
+    def __init__(self, nodes):
+        self.nodes = nodes
+        self.pods = {}
+        self.list_node_calls = []
+
+    def list_node(self, label_selector=""):
+        self.list_node_calls.append(label_selector)
+        return SimpleNamespace(items=self.nodes)
+
+    def create_namespaced_pod(self, namespace, body, **kwargs):
+        self.pods[body["metadata"]["name"]] = SimpleNamespace(
+            body=body,
+            metadata=SimpleNamespace(name=body["metadata"]["name"]),
+            spec=SimpleNamespace(
+                node_name=body["spec"].get("nodeName"),
+                containers=[
+                    SimpleNamespace(image=c["image"])
+                    for c in body["spec"]["containers"]
+                ],
+            ),
+            status=SimpleNamespace(phase="Pending"),
+        )
+
+    def list_namespaced_pod(self, namespace, label_selector=""):
+        key, value = label_selector.split("=")
+        pods = [
+            p for p in self.pods.values() if p.body["metadata"]["labels"][key] == value
+        ]
+        return SimpleNamespace(items=pods)
+
+    def delete_namespaced_pod(self, name, namespace, **kwargs):
+        del self.pods[name]
+
+
+@pytest.fixture
+def fake_k8s():
+    ImageLocality.history.clear()
+    KubernetesTerminal._prepulled_images.clear()
+    nodes = [
+        make_node("node-0"),
+        make_node(
+            "node-1", images=[["docker.io/library/ubuntu:latest", "ubuntu@sha256:1"]]
+        ),
+        make_node("node-2", images=[["docker.io/swebench/task:latest"]]),
+        make_node("node-3", images=[["ubuntu:latest"]], unschedulable=True),
+    ]
+    fake_api = FakeCoreV1Api(nodes)
+    with (
+        patch("debug_gym.gym.terminals.kubernetes.config"),
+        patch(
+            "debug_gym.gym.terminals.kubernetes.client.CoreV1Api",
+            return_value=fake_api,
+        ),
+    ):
+        yield fake_api
+    ImageLocality.history.clear()
+    KubernetesTerminal._prepulled_images.clear()
+
+
+def test_image_locality_preferred_nodes(fake_k8s):
+    locality = ImageLocality(fake_k8s, node_selector={"pool": "cpu"}, max_nodes=2)
+    # Nodes reporting the image, except unschedulable ones.
+    assert locality.preferred_nodes("ubuntu") == ["node-1"]
+    assert locality.preferred_nodes("swebench/task") == ["node-2"]
+    assert locality.preferred_nodes("python:3.12") == []
+    assert locality.node_affinity("python:3.12") is None
+
+    # Nodes where pods recently ran come first.
+    locality.record("ubuntu:latest", "node-0")
+    locality.record("ubuntu:latest", "node-3")  # Unschedulable.
+    locality.record("ubuntu:latest", None)
+    assert locality.preferred_nodes("ubuntu") == ["node-0", "node-1"]
+    assert locality.node_affinity("ubuntu") == {
+        "weight": 100,
+        "preference": {
+            "matchFields": [
+                {
+                    "key": "metadata.name",
+                    "operator": "In",
+                    "values": ["node-0", "node-1"],
+                }
+            ]
+        },
+    }
+    # The node list is cached.
+    assert fake_k8s.list_node_calls == ["pool=cpu"]
+
+
+def test_image_locality_cannot_list_nodes(fake_k8s):
+    from kubernetes.client.rest import ApiException
+
+    fake_k8s.list_node = MagicMock(side_effect=ApiException(status=403))
+    locality = ImageLocality(fake_k8s)
+    assert locality.preferred_nodes("ubuntu") == []
+    locality.record("ubuntu", "node-5")
+    assert locality.preferred_nodes("ubuntu") == ["node-5"]
+
+
+def test_kubernetes_terminal_prefers_nodes_with_image(fake_k8s):
+    terminal = KubernetesTerminal(
+        base_image="ubuntu:latest",
+        kube_config="incluster",
+        pod_spec_kwargs={
+            "affinity": {
+                "nodeAffinity": {"requiredDuringSchedulingIgnoredDuringExecution": "X"}
+            }
+        },
+    )
+    with patch("debug_gym.gym.terminals.kubernetes.Pod") as pod_class:
+        pod_class.return_value.node_name = "node-0"
+        terminal.setup_pod()
+
+    _, pod_body = pod_class.call_args.args
+    node_affinity = pod_body["spec"]["affinity"]["nodeAffinity"]
+    assert node_affinity["requiredDuringSchedulingIgnoredDuringExecution"] == "X"
+    preferred = node_affinity["preferredDuringSchedulingIgnoredDuringExecution"]
+    assert preferred[0]["preference"]["matchFields"][0]["values"] == ["node-1"]
+    # The node the pod ran on is now preferred for this image.
+    assert terminal.image_locality.preferred_nodes("ubuntu") == ["node-0", "node-1"]
+    terminal._pod = None
+
+    terminal = KubernetesTerminal(
+        base_image="ubuntu:latest", kube_config="incluster", image_locality=False
+    )
+    with patch("debug_gym.gym.terminals.kubernetes.Pod") as pod_class:
+        terminal.setup_pod()
+    assert "affinity" not in pod_class.call_args.args[1]["spec"]
+    terminal._pod = None
+
+
+def test_kubernetes_terminal_prepull_images(fake_k8s):
+    terminal = KubernetesTerminal(
+        kube_config="incluster",
+        prepull_nodes=2,
+        pod_spec_kwargs={"tolerations": [{"key": "gpu"}], "hostNetwork": True},
+    )
+    created = terminal.prepull_images(["ubuntu", "swebench/task:latest", "python"])
+    pods = fake_k8s.pods
+    assert sorted(created) == sorted(pods)
+    nodes = {}
+    for pod in pods.values():
+        assert pod.body["metadata"]["labels"] == {"app": PREPULL_APP_LABEL}
+        assert pod.body["spec"]["tolerations"] == [{"key": "gpu"}]
+        assert "hostNetwork" not in pod.body["spec"]
+        nodes.setdefault(pod.body["spec"]["containers"][0]["image"], set()).add(
+            pod.body["spec"]["nodeName"]
+        )
+    # Nodes which already have the image only need one more node.
+    assert len(nodes["ubuntu"]) == 1 and "node-1" not in nodes["ubuntu"]
+    assert len(nodes["swebench/task:latest"]) == 1
+    assert len(nodes["python"]) == 2
+    assert all("node-3" not in names for names in nodes.values())
+
+    # Images are only pre-pulled once per process.
+    assert terminal.prepull_images(["ubuntu"]) == []
+
+    # Another process sweeps finished pods, without pulling images again.
+    KubernetesTerminal._prepulled_images.clear()
+    ImageLocality.history.clear()
+    for pod in pods.values():
+        pod.status.phase = "Succeeded"
+    assert terminal.prepull_images(["ubuntu", "python"]) == []
+    assert pods == {}
+
+
+def test_kubernetes_terminal_prepull_lookahead(fake_k8s):
+    terminal = KubernetesTerminal(
+        kube_config="incluster", prepull_nodes=1, prepull_lookahead=2
+    )
+
+    def images():
+        return sorted(
+            pod.body["spec"]["containers"][0]["image"] for pod in fake_k8s.pods.values()
+        )
+
+    # Only the next images are pre-pulled.
+    terminal.prepull_images(["python", "node", "golang", "rust"])
+    assert images() == ["node", "python"]
+
+    # The next one is pre-pulled once a task's pod starts.
+    terminal.base_image = "python:latest"
+    with patch("debug_gym.gym.terminals.kubernetes.Pod"):
+        terminal.setup_pod()
+    assert images() == ["golang", "node", "python"]
+    assert terminal._upcoming_images == ["node", "golang", "rust"]
+    terminal._pod = None
+
+
+def test_kubernetes_terminal_prepull_disabled(fake_k8s):
+    terminal = KubernetesTerminal(kube_config="incluster")
+    assert terminal.prepull_images(["ubuntu"]) == []
+    assert fake_k8s.pods == {}
@@ -0,0 +1,144 @@
+import os
+import subprocess
+import time
+from types import SimpleNamespace
+from unittest.mock import MagicMock, patch
+
+import pytest
+
+from debug_gym.gym.terminals import reaper as reaper_module
+from debug_gym.gym.terminals.docker import DockerTerminal
+from debug_gym.gym.terminals.reaper import (
+    OWNER_HOST_LABEL,
+    OWNER_PID_LABEL,
+    Heartbeat,
+    Reaper,
+    hostname,
+    owner_labels,
+)
+
+
+@pytest.fixture(autouse=True)
+def heartbeat_dir(tmp_path, monkeypatch):
+    monkeypatch.setattr(reaper_module, "HEARTBEAT_DIR", tmp_path / "heartbeats")
+    monkeypatch.setattr(Heartbeat, "_pid", None)
+    yield tmp_path / "heartbeats"
+    Heartbeat.stop()
+
+
+@pytest.fixture
+def dead_pid():
+    process = subprocess.Popen(["true"])
+    process.wait()
+    return process.pid
+
+
+def labels(pid, host=None, **extra):
+    return {OWNER_HOST_LABEL: host or hostname(), OWNER_PID_LABEL: str(pid)} | extra
+
+
+def test_owner_labels_start_heartbeat(heartbeat_dir):
+    assert owner_labels() == labels(os.getpid())
+    assert (heartbeat_dir / str(os.getpid())).exists()
+    assert Heartbeat.is_alive(os.getpid())
+
+    Heartbeat.stop()
+    assert not (heartbeat_dir / str(os.getpid())).exists()
+    assert not Heartbeat.is_alive(os.getpid())
+
+
+def test_heartbeat_is_refreshed(heartbeat_dir):
+    Heartbeat.start(interval=0.1)
+    path = heartbeat_dir / str(os.getpid())
+    os.utime(path, (0, 0))
+    time.sleep(0.5)
+    assert Heartbeat.is_alive(os.getpid(), timeout=5)
+
+
+def test_reaper_is_orphaned(heartbeat_dir, dead_pid):
+    reaper = Reaper(timeout=60)
+    owner_labels()  # Start our heartbeat.
+    assert not reaper.is_orphaned(labels(os.getpid()))
+    # Owned by a process of another host.
+    assert not reaper.is_orphaned(labels(dead_pid, host="other-host"))
+    # Owner process is dead.
+    assert reaper.is_orphaned(labels(dead_pid))
+    # Owner process is alive, but its heartbeat stopped (e.g., stuck).
+    os.utime(heartbeat_dir / str(os.getpid()), (0, 0))
+    assert reaper.is_orphaned(labels(os.getpid()))
+
+
+def test_reaper_reap_docker(dead_pid):
+    owner_labels()
+    alive = SimpleNamespace(name="alive", labels=labels(os.getpid()), stop=MagicMock())
+    orphan = SimpleNamespace(name="orphan", labels=labels(dead_pid), stop=MagicMock())
+    docker_client = MagicMock()
+    docker_client.containers.list.side_effect = lambda filters: (
+        [alive, orphan] if OWNER_PID_LABEL in filters["label"] else []
+    )
+
+    reaper = Reaper(docker_client=docker_client, uuid="exp")
+    assert reaper.enabled
+    assert reaper.reap() == ["orphan"]
+    orphan.stop.assert_called_once()
+    alive.stop.assert_not_called()
+    docker_client.containers.list.assert_any_call(
+        filters={
+            "label": [OWNER_PID_LABEL, f"{OWNER_HOST_LABEL}={hostname()}", "uuid=exp"]
+        }
+    )
+
+
+def test_reaper_reap_kubernetes(dead_pid):
+    owner_labels()
+    k8s_client = MagicMock()
+    k8s_client.list_namespaced_pod.return_value.items = [
+        SimpleNamespace(metadata=SimpleNamespace(name=name, labels=pod_labels))
+        for name, pod_labels in [
+            ("alive", labels(os.getpid())),
+            ("orphan", labels(dead_pid)),
+        ]
+    ]
+
+    reaper = Reaper(k8s_client=k8s_client, namespace="ns")
+    assert reaper.reap() == ["orphan"]
+    k8s_client.list_namespaced_pod.assert_called_once_with(
+        namespace="ns",
+        label_selector=f"{OWNER_PID_LABEL},{OWNER_HOST_LABEL}={hostname()}",
+    )
+    k8s_client.delete_namespaced_pod.assert_called_once_with(
+        name="orphan", namespace="ns", grace_period_seconds=5
+    )
+
+
+def test_reaper_thread():
+    reaper = Reaper(docker_client=MagicMock())
+    with patch.object(Reaper, "reap", return_value=[]) as reap:
+        reaper.start(interval=0.05)
+        time.sleep(0.3)
+        reaper.stop()
+        calls = reap.call_count
+        assert calls >= 2  # Periodic sweeps, and a last one on stop.
+        time.sleep(0.1)
+        assert reap.call_count == calls
+
+
+def test_reaper_for_terminal():
+    assert not Reaper.for_terminal(None).enabled
+    terminal = SimpleNamespace(k8s_client=MagicMock(), namespace="ns")
+    reaper = Reaper.for_terminal(terminal, uuid="exp")
+    assert reaper.k8s_client is terminal.k8s_client
+    assert reaper.docker_client is None
+    assert reaper.namespace == "ns"
+    assert reaper.uuid == "exp"
+
+
+def test_docker_terminal_container_owner_labels():
+    docker_client = MagicMock()
+    with patch("docker.from_env", return_value=docker_client):
+        terminal = DockerTerminal(base_image="ubuntu", extra_labels={"uuid": "exp"})
+        with patch("atexit.register"):
+            terminal.setup_container()
+
+    container_labels = docker_client.containers.run.call_args.kwargs["labels"]
+    assert container_labels == {"app": "dbg-gym", "uuid": "exp"} | owner_labels()
@@ -0,0 +1,271 @@
+import os
+import re
+import subprocess
+from unittest.mock import MagicMock, patch
+
+import docker
+import pytest
+
+from debug_gym.gym.terminals import select_terminal
+from debug_gym.gym.terminals.reaper import OWNER_HOST_LABEL, Reaper, hostname
+from debug_gym.gym.terminals.shared_docker import (
+    SHARED_GROUP_LABEL,
+    SHARED_SLOTS_DIR,
+    SHARED_TASKS_DIR,
+    TENANT_ENV_VAR,
+    SharedDockerTerminal,
+)
+from debug_gym.gym.workspace import Workspace
+
+
+class FakeSharedContainer:
+    """Emulates the slot directories of a shared container."""
+
+    def __init__(self, name, status="running"):
+        self.name = name
+        self.status = status
+        self.slots = set()
+        self.owners = {}  # Owner (host and pid) of each slot.
+        self.retired = False
+        self.stopped = False
+        self.commands = []
+
+    def exec_run(self, command, **kwargs):
+        command = command[-1]
+        self.commands.append(command)
+        if command.startswith("for _ in $(seq 50)"):  # Claim a slot.
+            capacity = int(command.split("$(seq 0 ")[1].split(")")[0]) + 1
+            if self.retired:
+                return 1, b""
+            for i in range(capacity):
+                if i not in self.slots:
+                    self.slots.add(i)
+                    self.owners[i] = re.search(r"echo '(.*)' > ", command).group(1)
+                    return 0, f"{i}\n".encode()
+            return 1, b""
+        if command.startswith(f"cd {SHARED_SLOTS_DIR}"):  # List the slots.
+            if self.retired:
+                return 1, b""
+            slots = [f"{i} {self.owners.get(i, '')}" for i in sorted(self.slots)]
+            return 0, "\n".join(slots).encode()
+        if command.startswith("rm -rf"):  # Release slots.
+            for path in command.split()[2:]:
+                if path.startswith(f"{SHARED_SLOTS_DIR}/"):
+                    self.slots.discard(int(path.rsplit("/", 1)[-1]))
+        if command == f"rmdir {SHARED_SLOTS_DIR}":
+            if self.slots:
+                return 1, b"rmdir: failed to remove: Directory not empty"
+            self.retired = True
+        return 0, b""
+
+    def reload(self):
+        pass
+
+    def stop(self, timeout=None):
+        self.stopped = True
+
+
+@pytest.fixture
+def dead_pid():
+    process = subprocess.Popen(["true"])
+    process.wait()
+    return process.pid
+
+
+@pytest.fixture
+def docker_client():
+    containers = {}
+    client = MagicMock()
+
+    def get(name):
+        if name not in containers:
+            raise docker.errors.NotFound(name)
+        return containers[name]
+
+    def run(name, **kwargs):
+        containers[name] = FakeSharedContainer(name)
+        return containers[name]
+
+    client.containers.get.side_effect = get
+    client.containers.run.side_effect = run
+    client.fake_containers = containers
+    with patch("docker.from_env", return_value=client):
+        yield client
+
+
+def make_terminal(**kwargs):
+    return SharedDockerTerminal(base_image="python:3.12-slim", **kwargs)
+
+
+def test_shared_docker_terminal_shares_container(docker_client):
+    terminals = [make_terminal(tasks_per_container=2, group="exp") for _ in range(3)]
+    containers = [terminal.container for terminal in terminals]
+
+    assert containers[0] is containers[1]
+    assert containers[2] is not containers[0]
+    assert containers[0].name == "debug_gym_shared_exp_python-3.12-slim_0"
+    assert containers[2].name == "debug_gym_shared_exp_python-3.12-slim_1"
+    assert containers[0].slots == {0, 1}
+    assert containers[2].slots == {0}
+    assert docker_client.containers.run.call_count == 2
+
+
+def test_shared_docker_terminal_last_tenant_stops_container(docker_client):
+    terminal_1 = make_terminal(group="exp")
+    terminal_2 = make_terminal(group="exp")
+    container = terminal_1.container
+    assert terminal_2.container is container
+
+    terminal_1.clean_up()
+    assert not container.stopped
+    assert container.slots == {1}
+    assert terminal_1._container is None
+
+    terminal_2.clean_up()
+    assert container.stopped
+    assert container.slots == set()
+
+
+def test_shared_docker_terminal_skips_retired_container(docker_client):
+    retired = FakeSharedContainer("debug_gym_shared_exp_python-3.12-slim_0")
+    retired.retired = True
+    docker_client.fake_containers[retired.name] = retired
+    stopping = FakeSharedContainer(
+        "debug_gym_shared_exp_python-3.12-slim_1", status="exited"
+    )
+    docker_client.fake_containers[stopping.name] = stopping
+
+    terminal = make_terminal(group="exp")
+    assert terminal.container.name == "debug_gym_shared_exp_python-3.12-slim_2"
+
+
+def test_shared_docker_terminal_container_started_concurrently(docker_client):
+    name = "debug_gym_shared_exp_python-3.12-slim_0"
+    other = FakeSharedContainer(name)
+
+    def run(name, **kwargs):
+        # Another tenant created the container in the meantime.
+        docker_client.fake_containers[name] = other
+        raise docker.errors.APIError("Conflict", response=MagicMock(status_code=409))
+
+    docker_client.containers.run.side_effect = run
+    terminal = make_terminal(group="exp")
+    assert terminal.container is other
+    assert other.slots == {0}
+
+
+def test_shared_docker_terminal_group_defaults_to_experiment_uuid(docker_client):
+    terminal = select_terminal(
+        {"type": "shared_docker", "base_image": "python:3.12-slim"}, uuid="1234"
+    )
+    assert isinstance(terminal, SharedDockerTerminal)
+    assert terminal.group == "1234"
+    assert terminal.container_prefix == "debug_gym_shared_1234_python-3.12-slim"
+
+
+def test_shared_docker_terminal_group_defaults_to_setup(docker_client):
+    terminal_1 = make_terminal(setup_commands=["pip install pytest"])
+    terminal_2 = make_terminal(setup_commands=["pip install pytest"])
+    assert terminal_1.group == terminal_2.group
+    # Tenants set up differently do not share containers.
+    assert make_terminal().group != terminal_1.group
+    assert make_terminal(env_vars={"A": "1"}).group != make_terminal().group
+    terminal_2.base_image = "python:3.11-slim"
+    assert terminal_2.group != terminal_1.group
+
+
+def test_reap_orphaned_shared_container(docker_client, dead_pid):
+    terminals = [make_terminal(tasks_per_container=2, group="exp") for _ in range(3)]
+    container, _, other = [terminal.container for terminal in terminals]
+    assert container.owners == {
+        0: f"{hostname()} {os.getpid()}",
+        1: f"{hostname()} {os.getpid()}",
+    }
+    _, kwargs = docker_client.containers.run.call_args
+    assert kwargs["labels"][SHARED_GROUP_LABEL] == "exp"
+    assert kwargs["labels"][OWNER_HOST_LABEL] == hostname()
+
+    docker_client.containers.list.return_value = [container, other]
+    reaper = Reaper(docker_client=docker_client)
+    # The tenants are alive.
+    assert reaper.reap_shared_docker() == []
+    assert not container.stopped
+
+    # The tenants of the first container are killed, without cleaning up.
+    container.owners = {0: f"{hostname()} {dead_pid}", 1: f"{hostname()} {dead_pid}"}
+    assert reaper.reap_shared_docker() == [container.name]
+    assert container.stopped and container.retired
+    assert not other.stopped
+    # A tenant which did not record its owner yet is considered alive.
+    del other.owners[0]
+    assert reaper.reap_shared_docker() == []
+    docker_client.containers.list.assert_called_with(
+        filters={"label": [SHARED_GROUP_LABEL, f"{OWNER_HOST_LABEL}={hostname()}"]}
+    )
+
+
+def test_shared_docker_terminal_prepare_command(docker_client):
+    terminal = make_terminal(
+        session_commands=["source .venv/bin/activate"],
+        tenant_limits={"max_memory_kb": 1024, "max_cpu_seconds": 10},
+    )
+    command = terminal.prepare_command("pytest")
+    assert command[:4] == ["setsid", "--wait", "/bin/bash", "-c"]
+    assert command[4] == (
+        f"source .venv/bin/activate && export {TENANT_ENV_VAR}={terminal.tenant_id}"
+        " && ulimit -S -t 10 && ulimit -S -v 1024 && pytest"
+    )
+
+
+def test_shared_docker_terminal_unknown_limits(docker_client):
+    with pytest.raises(ValueError, match="Unknown tenant limits"):
+        make_terminal(tenant_limits={"max_gpu": 1})
+    with pytest.raises(ValueError, match="Unknown tenant limits"):
+        make_terminal(tenant_limits={"max_processes": 100})
+
+
+def test_shared_docker_terminal_shell_command(docker_client):
+    terminal = make_terminal(group="exp")
+    terminal.working_dir = terminal.tenant_dir
+    assert terminal.default_shell_command == (
+        f"docker exec -t -i -w {SHARED_TASKS_DIR}/{terminal.tenant_id} "
+        f"-e {TENANT_ENV_VAR}={terminal.tenant_id} "
+        "debug_gym_shared_exp_python-3.12-slim_0 "
+        "/bin/bash --noprofile --norc --noediting"
+    )
+
+
+def test_workspace_uses_tenant_dir(docker_client):
+    terminal = make_terminal()
+    container = terminal.container
+    workspace = Workspace(terminal)
+    workspace.reset()
+    assert str(workspace.working_dir) == terminal.tenant_dir
+    assert terminal.working_dir == terminal.tenant_dir
+    # Resetting the workspace empties the tenant's working directory.
+    assert any("-mindepth 1 -delete" in command for command in container.commands)
+
+    # Unless the tenant's sandbox was reset in place.
+    container.commands.clear()
+    terminal.keep_tenant_dir = True
+    workspace.reset()
+    assert not any("-delete" in command for command in container.commands)
+
+
+@pytest.if_docker_running
+def test_shared_docker_terminal_run():
+    terminal_1 = SharedDockerTerminal(base_image="ubuntu:latest", group="test")
+    terminal_2 = SharedDockerTerminal(base_image="ubuntu:latest", group="test")
+    try:
+        for terminal in (terminal_1, terminal_2):
+            terminal.working_dir = terminal.tenant_dir
+        assert terminal_1.container.id == terminal_2.container.id
+
+        terminal_1.run("touch file_1.txt", raises=True)
+        _, output = terminal_2.run("ls", raises=True)
+        assert output == ""
+        _, output = terminal_1.run("pwd", raises=True)
+        assert output == terminal_1.tenant_dir
+    finally:
+        terminal_1.close()
+        terminal_2.close()
@@ -2,7 +2,11 @@ import platform
 
 import pytest
 
-from debug_gym.gym.terminals.shell_session import DEFAULT_PS1, ShellSession
+from debug_gym.gym.terminals.shell_session import (
+    DEFAULT_PS1,
+    ProcessNotRunningError,
+    ShellSession,
+)
 
 if_is_linux = pytest.mark.skipif(
     platform.system() != "Linux",
@@ -62,3 +66,28 @@ def test_shell_session_timeout(tmp_path):
     ):
         shell.run(long_running_command, timeout=timeout)
     assert shell.is_running is False
+
+
+@if_is_linux
+def test_shell_session_interrupt(tmp_path):
+    shell = ShellSession(
+        shell_command="/bin/bash --noprofile --norc",
+        working_dir=str(tmp_path),
+    )
+    shell.start()
+    with pytest.raises(TimeoutError):
+        shell.run("sleep 60", timeout=1, close_on_timeout=False)
+    assert shell.is_running
+
+    shell.interrupt(timeout=5)
+    assert shell.run("echo $((1 + 1))", timeout=5) == "2"
+    shell.close()
+
+
+def test_shell_session_interrupt_not_running(tmp_path):
+    shell = ShellSession(
+        shell_command="/bin/bash --noprofile --norc",
+        working_dir=str(tmp_path),
+    )
+    with pytest.raises(ProcessNotRunningError):
+        shell.interrupt()
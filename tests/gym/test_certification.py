@@ -0,0 +1,101 @@
+import json
+
+import pytest
+
+from debug_gym.gym.certification import (
+    BROKEN,
+    CERTIFIED,
+    FLAKY,
+    Certification,
+    Certifier,
+    TaskCertificate,
+    certify_task,
+)
+from debug_gym.gym.envs.env import RepoEnv
+
+# The gold patch of each task, None if it has none.
+GOLD_PATCHES = {
+    "fixed": "VALUE = 1\n",
+    "flaky": "import os\nVALUE = int(os.path.exists('ran'))\nopen('ran', 'w').close()\n",
+    "unfixed": "VALUE = 2\n",
+    "resolved": None,
+}
+
+
+class GoldEnv(RepoEnv):
+    def load_dataset(self, problems=None):
+        tasks = [task for task in GOLD_PATCHES if task not in self.uncertified_tasks()]
+        return {task: None for task in tasks}
+
+    def setup_task(self, task_name, options=None):
+        if task_name not in GOLD_PATCHES:
+            raise ValueError(f"Unknown task `{task_name}`.")
+        self.task_name = task_name
+
+    def setup_workspace(self):
+        super().setup_workspace()
+        if self.task_name == "resolved":
+            self.workspace.write_file("mod.py", "VALUE = 1\n")
+
+    def apply_gold_patch(self):
+        self.workspace.write_file("mod.py", GOLD_PATCHES[self.task_name])
+
+
+@pytest.fixture
+def env_factory(tmp_path):
+    repo = tmp_path / "repo"
+    repo.mkdir()
+    (repo / "mod.py").write_text("VALUE = 0\n")
+    (repo / "test_mod.py").write_text(
+        "import mod\n\ndef test_value():\n    assert mod.VALUE == 1\n"
+    )
+    return lambda **kwargs: GoldEnv(path=repo, max_score=1, **kwargs)
+
+
+@pytest.mark.parametrize(
+    "task,status,results,error",
+    [
+        ("fixed", CERTIFIED, [True, True], None),
+        ("flaky", FLAKY, [False, True], None),
+        ("unfixed", BROKEN, [False, False], "not resolved by the gold patch"),
+        ("resolved", BROKEN, [], "resolved without the gold patch"),
+        ("unknown", BROKEN, [], "Unknown task"),
+    ],
+)
+def test_certify_task(env_factory, task, status, results, error):
+    env = env_factory()
+    certificate = certify_task(env, task, runs=2)
+    assert certificate.status == status
+    assert certificate.results == results
+    assert len(certificate.eval_times) == len(results)
+    if error:
+        assert error in certificate.error
+    else:
+        assert certificate.error is None
+    if task != "unknown":
+        assert certificate.setup_time > 0
+    env.close()
+
+
+def test_certifier(env_factory, tmp_path):
+    certification_file = tmp_path / "certification.json"
+    Certification({"fixed": TaskCertificate(status=BROKEN)}).save(certification_file)
+
+    certifier = Certifier(env_factory, workers=2, runs=2)
+    certification = certifier.certify(list(GOLD_PATCHES), certification_file)
+    # Tasks already in the certification file are not certified again.
+    assert certification.tasks["fixed"].status == BROKEN
+    assert certification.tasks["flaky"].status == FLAKY
+    assert len(certifier._all_envs) <= 2  # Environments are reused across tasks.
+
+    certification = Certifier(env_factory, runs=2).certify(
+        ["fixed"], certification_file, force=True
+    )
+    assert certification.tasks["fixed"].status == CERTIFIED
+    saved = json.loads(certification_file.read_text())
+    assert saved["tasks"]["fixed"]["results"] == [True, True]
+    assert saved["tasks"]["unfixed"]["status"] == BROKEN
+
+    # Environments skip the tasks which are not certified.
+    env = env_factory(certification_file=str(certification_file))
+    assert list(env.dataset) == ["fixed"]
@@ -0,0 +1,107 @@
+import gc
+import subprocess
+import sys
+import threading
+
+from debug_gym.gym.resources import RESOURCES, ResourceRegistry
+from debug_gym.gym.terminals.local import LocalTerminal
+from debug_gym.gym.terminals.shell_session import ShellSession
+from debug_gym.gym.workspace import Workspace
+
+
+class Sandbox:
+    def __init__(self, registry, kind="container"):
+        self.registry = registry
+        self.released = 0
+        registry.register(self.release, kind)
+
+    def release(self):
+        self.released += 1
+        self.registry.unregister(self.release)
+
+
+def test_register_and_release():
+    registry = ResourceRegistry()
+    sandbox = Sandbox(registry)
+    registry.register(sandbox.release, "container")  # No-op.
+    Sandbox(registry, kind="shell session")  # Garbage collected right away.
+    gc.collect()
+    assert registry.live_counts() == {"container": 1}
+
+    sandbox.release()
+    assert registry.live_counts() == {}
+    registry.release_all()
+    assert sandbox.released == 1
+
+
+def test_registry_does_not_keep_resources_alive():
+    registry = ResourceRegistry()
+    sandboxes = [Sandbox(registry) for _ in range(100)]
+    assert registry.live_counts() == {"container": 100}
+    del sandboxes
+    gc.collect()
+    assert registry.live_counts() == {}
+    assert registry._resources == {}
+
+
+def test_release_all_concurrently():
+    registry = ResourceRegistry()
+    barrier = threading.Barrier(3, timeout=5)
+
+    class SlowSandbox(Sandbox):
+        def release(self):
+            barrier.wait()  # Only passes if the 3 sandboxes are released together.
+            super().release()
+
+    class BrokenSandbox(Sandbox):
+        def release(self):
+            raise RuntimeError("Already gone.")
+
+    sandboxes = [SlowSandbox(registry) for _ in range(3)] + [BrokenSandbox(registry)]
+    registry.release_all()
+    assert [sandbox.released for sandbox in sandboxes] == [1, 1, 1, 0]
+    assert registry.live_counts() == {}
+
+
+def test_release_at_exit():
+    script = (
+        "import threading\n"
+        "from debug_gym.gym.resources import RESOURCES\n"
+        "barrier = threading.Barrier(3, timeout=5)\n"
+        "class Sandbox:\n"
+        "    def release(self):\n"
+        "        barrier.wait()\n"
+        "        print('released', flush=True)\n"
+        "sandboxes = [Sandbox() for _ in range(3)]\n"
+        "for sandbox in sandboxes:\n"
+        "    RESOURCES.register(sandbox.release, 'container')\n"
+    )
+    result = subprocess.run(
+        [sys.executable, "-c", script], capture_output=True, text=True, timeout=60
+    )
+    # The barrier only passes if the sandboxes are released concurrently.
+    assert result.stdout == "released\n" * 3, result.stderr
+    assert result.stderr == ""
+
+
+def test_shell_sessions_and_workspaces_are_registered(tmp_path):
+    baseline = RESOURCES.live_counts()
+
+    def added(kind):
+        return RESOURCES.live_counts().get(kind, 0) - baseline.get(kind, 0)
+
+    session = ShellSession(
+        shell_command="/bin/bash --noprofile --norc", working_dir=str(tmp_path)
+    )
+    assert added("shell session") == 0  # Not started yet.
+    session.start()
+    assert added("shell session") == 1
+    session.close()
+    assert added("shell session") == 0
+
+    workspace = Workspace(LocalTerminal())
+    workspace.reset()
+    workspace.reset()  # The previous temporary directory is released.
+    assert added("temporary directory") == 1
+    workspace.cleanup()
+    assert added("temporary directory") == 0
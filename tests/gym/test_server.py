@@ -0,0 +1,131 @@
+import socket
+from unittest.mock import MagicMock
+
+import pytest
+
+from debug_gym.gym.envs.env import RepoEnv
+from debug_gym.gym.server import (
+    EnvPool,
+    EnvServer,
+    EnvServerError,
+    RemoteEnv,
+    ToolSpec,
+    recv_message,
+    send_message,
+)
+from debug_gym.gym.tools.tool import ToolCall
+from debug_gym.gym.tools.toolbox import Toolbox
+
+
+def test_message_framing():
+    left, right = socket.socketpair()
+    message = ("step", {"content": "x" * 100_000})
+    send_message(left, message)
+    send_message(left, None)
+    assert recv_message(right) == message
+    assert recv_message(right) is None
+
+    left.close()
+    with pytest.raises(EOFError):
+        recv_message(right)
+
+
+@pytest.fixture
+def env_factory(tmp_path):
+    repo = tmp_path / "repo"
+    repo.mkdir()
+    (repo / "code.py").write_text("x = 1\n")
+
+    def factory():
+        env = RepoEnv(path=repo, entrypoint="python code.py")
+        env.add_tool(Toolbox.get_tool("rewrite"))
+        return env
+
+    return factory
+
+
+@pytest.fixture
+def server(tmp_path, env_factory):
+    server = EnvServer(str(tmp_path / "env.sock"), EnvPool(env_factory, size=1))
+    server.start()
+    yield server
+    server.shutdown()
+
+
+def rewrite(new_code):
+    return ToolCall(
+        id="1",
+        name="rewrite",
+        arguments={"path": "code.py", "start": 1, "new_code": new_code},
+    )
+
+
+def _spec(name):
+    tool = Toolbox.get_tool(name)
+    return tool.description, tool.arguments
+
+
+def test_remote_env(server):
+    env = RemoteEnv(server.socket_path)
+    infos = env.reset()
+    assert infos.tools == [ToolSpec("rewrite", *_spec("rewrite"))]
+    assert infos.rewrite_counter == 0
+
+    infos = env.step(rewrite("x = 2"))
+    assert infos.rewrite_counter == 1
+    assert "updated successfully" in infos.step_observation.observation
+
+    infos = env.reset()
+    assert infos.rewrite_counter == 0
+    env.close()
+
+
+def test_remote_env_fork(server):
+    env = RemoteEnv(server.socket_path)
+    env.reset()
+    env.step(rewrite("x = 2"))
+
+    fork = env.fork()
+    assert fork.session != env.session
+    assert fork.infos.rewrite_counter == 1
+    # The fork starts from the code of the original session.
+    infos = fork.step(rewrite("y = x"))
+    assert "-x = 2\n+y = x" in infos.step_observation.observation
+    # Both sessions then diverge.
+    infos = env.step(rewrite("z = 3"))
+    assert "-x = 2\n+z = 3" in infos.step_observation.observation
+    assert infos.rewrite_counter == 2
+
+    fork.close()
+    env.close()
+
+
+def test_remote_env_errors(server):
+    env = RemoteEnv(server.socket_path)
+    with pytest.raises(EnvServerError, match="Unknown session"):
+        env.step(rewrite("x = 2"))
+    with pytest.raises(EnvServerError, match="Unknown method"):
+        env.client.call("destroy")
+    env.close()
+
+
+def test_env_pool_acquire():
+    envs = [MagicMock(reset_options={}) for _ in range(3)]
+    factory = MagicMock(side_effect=envs)
+    pool = EnvPool(factory, size=2, tasks=["a", "b"])
+    pool.start()
+    pool._executor.shutdown(wait=True)  # Wait for the warm-up.
+
+    # Environments already reset on the requested task are preferred.
+    env, infos = pool.acquire({"task_name": "b"})
+    assert env is envs[1] and infos is envs[1].reset.return_value
+    env, infos = pool.acquire({"task_name": "c"})
+    assert env is envs[0] and infos is None
+    # A new environment is created when none is idle.
+    env, infos = pool.acquire({"task_name": "a"})
+    assert env is envs[2] and infos is None
+
+    # Released environments are closed once the pool is closed.
+    pool.close()
+    pool.release(envs[2])
+    envs[2].close.assert_called_once()
@@ -14,6 +14,7 @@ from debug_gym.gym.utils import (
     is_subdirectory,
     make_file_matcher,
     show_line_number,
+    trace_entrypoint,
 )
 
 
@@ -764,3 +765,30 @@ def test_filter_problems():
         "problem2",
         "problem3",
     ]  # excluded_ids doesn't affect custom splits
+
+
+@pytest.mark.parametrize(
+    "entrypoint,expected",
+    [
+        ("python -m pytest -sq .", "python S R I -m pytest -sq ."),
+        ("python -W ignore -m pytest", "python -W ignore S R I -m pytest"),
+        ("python $(which pytest) .", "python S R I $(which pytest) ."),
+        ("python -c 'import app'", "python S R I -c 'import app'"),
+        ("pytest -sq .", "python S R I -m pytest -sq ."),
+        (
+            "cd src && .venv/bin/pytest -x",
+            "cd src && .venv/bin/python S R I -m pytest -x",
+        ),
+        (
+            "xvfb-run --auto-servernum .venv/bin/python -m pytest",
+            "xvfb-run --auto-servernum .venv/bin/python S R I -m pytest",
+        ),
+    ],
+)
+def test_trace_entrypoint(entrypoint, expected):
+    assert trace_entrypoint(entrypoint, "S", "R", "I") == expected
+
+
+def test_trace_entrypoint_not_python():
+    with pytest.raises(ValueError, match="must run a python program"):
+        trace_entrypoint("bash run_tests.sh", "S", "R", "I")
@@ -332,3 +332,123 @@ def test_write_file_exceeding_max_command_length(workspace):
     file_content_exceeding_max_command_length = "A" * (2 * 1024**2)  # 2MB of 'A's
     workspace.write_file("test.txt", file_content_exceeding_max_command_length)
     assert file_path.read_text() == file_content_exceeding_max_command_length
+
+
+def test_snapshot_and_restore(tmp_path):
+    terminal = LocalTerminal()
+    workspace = Workspace(terminal)
+    workspace.reset()
+    repo_path = workspace.working_dir
+    (repo_path / ".gitignore").write_text(".venv/\n")
+    (repo_path / "file1.txt").write_text("original")
+    terminal.run(
+        "git init -q && git add -A && "
+        "git -c user.name=test -c user.email='<>' commit -qm 'Init'",
+        raises=True,
+    )
+    # Untracked files created during setup are preserved.
+    (repo_path / ".venv").mkdir()
+    (repo_path / ".venv" / "lib.py").write_text("lib")
+    # Paths outside the repository modified during setup.
+    hosts = tmp_path / "hosts"
+    hosts.write_text("127.0.0.1 localhost")
+    data_dir = tmp_path / "data"
+    data_dir.mkdir()
+    (data_dir / "data.txt").write_text("data")
+
+    snapshot = workspace.snapshot(
+        ("task", "image"),
+        restore_paths=[str(hosts), str(data_dir), str(tmp_path / "missing")],
+    )
+    assert snapshot.preserved_paths == [".venv"]
+    assert snapshot.archived_paths == [str(hosts), str(data_dir)]
+
+    # Modify the sandbox.
+    (repo_path / "file1.txt").write_text("modified")
+    (repo_path / "new_file.txt").write_text("new")
+    hosts.write_text("127.0.0.1 example.com")
+    (data_dir / "data.txt").unlink()
+    (data_dir / "other.txt").write_text("other")
+    (tmp_path / "missing").write_text("created")
+
+    assert workspace.restore(snapshot)
+    assert (repo_path / "file1.txt").read_text() == "original"
+    assert not (repo_path / "new_file.txt").exists()
+    assert (repo_path / ".venv" / "lib.py").read_text() == "lib"
+    assert hosts.read_text() == "127.0.0.1 localhost"
+    assert sorted(os.listdir(data_dir)) == ["data.txt"]
+    assert not (tmp_path / "missing").exists()
+
+    # Changes to preserved paths can't be restored, but are detected.
+    (repo_path / ".venv" / "lib.py").write_text("modified lib")
+    assert not workspace.restore(snapshot)
+
+
+def test_upload_script(workspace):
+    script_path = workspace.upload_script("early_exit_eval.py")
+    assert script_path.startswith("/tmp/debug_gym_scripts/early_exit_eval-")
+    with open(script_path) as f:
+        assert "TRUNCATED_MARKER" in f.read()
+
+    # Already uploaded scripts are not written again.
+    workspace.write_file = lambda *args: pytest.fail("Script uploaded twice.")
+    assert workspace.upload_script("early_exit_eval.py") == script_path
+
+
+def test_display_files_nested(workspace):
+    (workspace.working_dir / "subdir" / "nested").mkdir()
+    (workspace.working_dir / "subdir" / "nested" / "file10.txt").touch()
+    (workspace.working_dir / "subdir" / "nested" / "file9.txt").touch()
+    (workspace.working_dir / "z_last.txt").touch()
+
+    result = workspace.display_files(dir_tree_depth=3)
+    assert result == (
+        "Listing files in the current working directory. (read-only) indicates read-only files. Max depth: 3.\n"
+        f"{workspace.working_dir}/\n"
+        "|-- .hidden\n"
+        "|-- file1.txt\n"
+        "|-- file2.txt\n"
+        "|-- subdir/\n"
+        "|   |-- nested/\n"
+        "|   |   |-- file9.txt\n"
+        "|   |   |-- file10.txt\n"
+        "|   |-- subfile1.txt\n"
+        "|-- z_last.txt"
+    )
+
+
+def test_watch_files(workspace):
+    workspace.setup_file_filters(ignore_patterns=["*.log"])
+    assert workspace.watch_files()
+    assert workspace.poll_file_changes() == {}
+
+    repo_path = workspace.working_dir
+    (repo_path / "file1.txt").write_text("changed")
+    (repo_path / "new.txt").write_text("new")
+    (repo_path / "debug.log").write_text("ignored")
+    (repo_path / "tmp.txt").write_text("created, then deleted")
+    (repo_path / "tmp.txt").unlink()
+    (repo_path / "file2.txt").unlink()
+    (repo_path / "pkg" / "sub").mkdir(parents=True)
+    (repo_path / "pkg" / "sub" / "mod.py").touch()
+    assert workspace.poll_file_changes() == {
+        "file1.txt": "modified",
+        "new.txt": "created",
+        "file2.txt": "deleted",
+        "pkg": "created",
+        "pkg/sub": "created",
+        "pkg/sub/mod.py": "created",
+    }
+
+    # New directories are watched too.
+    (repo_path / "pkg" / "sub" / "mod.py").write_text("x = 1\n")
+    (repo_path / "subdir" / "subfile1.txt").rename(repo_path / "moved.txt")
+    assert workspace.poll_file_changes() == {
+        "pkg/sub/mod.py": "modified",
+        "subdir/subfile1.txt": "deleted",
+        "moved.txt": "created",
+    }
+
+    workspace.stop_watching_files()
+    assert not workspace.watching_files
+    assert workspace.poll_file_changes() is None
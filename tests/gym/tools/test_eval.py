@@ -60,3 +60,19 @@ def test_eval_on_event(env, method, env_auto_eval_on_rewrite, expected):
 
     getattr(eval_tool, method)(env, random_arg="random_arg")
     assert expected in env.last_eval.output
+
+
+def test_eval_impacted_tests_only(tmp_path):
+    (tmp_path / "test_1.py").write_text(
+        "def test_1():\n  assert True\n\ndef test_2():\n  assert False\n"
+    )
+    env = RepoEnv(path=tmp_path, entrypoint="python -m pytest -sq .", test_impact=True)
+    eval_tool = Toolbox.get_tool("eval")
+    env.add_tool(eval_tool)
+    # The eval at reset runs all the tests.
+    env_info = env.reset()
+    assert "1 failed, 1 passed" in env_info.eval_observation.observation
+
+    env_info = env.step(ToolCall(id="eval_id", name="eval", arguments={}))
+    assert "1 failed, 1 deselected" in env_info.step_observation.observation
+    assert env.last_eval.skipped_tests == ["test_1.py::test_1"]
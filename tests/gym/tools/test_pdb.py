@@ -2,7 +2,7 @@ import copy
 import platform
 import re
 import subprocess
-from unittest.mock import MagicMock
+from unittest.mock import MagicMock, patch
 
 import pytest
 
@@ -11,7 +11,7 @@ from debug_gym.gym.envs.env import RepoEnv
 from debug_gym.gym.terminals.docker import DockerTerminal
 from debug_gym.gym.terminals.local import LocalTerminal
 from debug_gym.gym.terminals.shell_session import ProcessNotRunningError
-from debug_gym.gym.tools.pdb import PDBTool
+from debug_gym.gym.tools.pdb import PDBTool, with_startup_commands
 
 
 def is_docker_running():
@@ -189,6 +189,34 @@ def test_pdb_use_default_env_entrypoint(tmp_path, setup_test_repo):
     assert "(Pdb)" not in output
 
 
+def test_pdb_default_entrypoint_runs_failing_tests(tmp_path, setup_test_repo):
+    tests_path = str(setup_test_repo(tmp_path))
+    env = RepoEnv(path=tests_path, terminal=LocalTerminal())
+    env.reset()
+    env.eval()
+    pdb = PDBTool()
+    pdb.start_pdb(env)
+    assert pdb.entrypoint == "python -m pdb -m pytest -sq test_fail.py::test_fail"
+    output = pdb.use(env, command="c").observation
+    assert "1 failed in" in output and "passed" not in output
+
+    # Sessions started on the failing tests follow the last eval.
+    env.workspace.write_file("test_fail.py", "def test_fail():\n    assert True\n")
+    env.eval()
+    pdb.restart_pdb(env)
+    assert pdb.entrypoint == env.debug_entrypoint
+    # Unlike an entrypoint chosen by the agent.
+    pdb.use(env, command="l", entrypoint="python -m pdb -m pytest -sq test_pass.py")
+    env.workspace.write_file("test_fail.py", "def test_fail():\n    assert False\n")
+    env.eval()
+    pdb.restart_pdb(env)
+    assert pdb.entrypoint == "python -m pdb -m pytest -sq test_pass.py"
+
+    pdb = PDBTool(failing_tests_only=False)
+    pdb.use(env, command="l")
+    assert pdb.entrypoint == env.debug_entrypoint
+
+
 @if_is_linux
 @if_docker_running
 def test_pdb_use_docker_terminal(tmp_path, setup_test_repo):
@@ -385,9 +413,7 @@ def test_pdb_crashing(tmp_path, setup_test_repo):
 def test_pdb_timeout(tmp_path, setup_test_repo):
     tests_path = setup_test_repo(tmp_path)
     with open(tests_path / "test_fail.py", "w") as f:
-        f.write(
-            "def test_fail():\n  print('Sleeping...'); import time; time.sleep(10)"
-        )  # IndentationError
+        f.write("def test_fail():\n  i = 0\n  while True:\n    i += 1\n")
 
     env = RepoEnv(
         path=tests_path,
@@ -399,8 +425,36 @@ def test_pdb_timeout(tmp_path, setup_test_repo):
 
     initial_output = pdb.start_pdb(env)
     assert "The pytest entry point." in initial_output
+    session = pdb._session
+    output = pdb.interact_with_pdb("c", timeout=1)
+    assert "timed out" in output
+    assert "Execution was interrupted:" in output
+    assert "Program interrupted." in output
+    assert "test_fail.py(" in output
+    # The session was interrupted, not restarted.
+    assert pdb.pdb_is_running
+    assert pdb._session is session
+    assert pdb.interact_with_pdb("p i > 0") == "True"
+
+
+def test_pdb_timeout_interrupt_fails(tmp_path, setup_test_repo):
+    tests_path = setup_test_repo(tmp_path)
+    with open(tests_path / "test_fail.py", "w") as f:
+        f.write("def test_fail():\n  import time; time.sleep(30)\n")
+
+    env = RepoEnv(
+        path=tests_path,
+        entrypoint="python -m pytest -s test.py",
+        debug_entrypoint="python -m pdb -m pytest -sv test_fail.py",
+    )
+    env.reset()
+    # `time.sleep` resumes after the SIGINT handler of pdb, delaying the prompt.
+    pdb = PDBTool(interrupt_timeout=1)
+
+    pdb.start_pdb(env)
     output = pdb.interact_with_pdb("c", timeout=1)
     assert "timed out" in output
+    assert "Failed to interrupt the execution" in output
     assert not pdb.pdb_is_running
 
 
@@ -430,6 +484,39 @@ def test_start_pdb_restores_breakpoints(tmp_path, setup_pdb_repo_env):
     assert "Breakpoints have been restored." in out
 
 
+def test_start_pdb_restores_breakpoints_at_startup(tmp_path, setup_pdb_repo_env):
+    pdb_tool, env = setup_pdb_repo_env(tmp_path)
+    pdb_tool.stop_pdb()
+    env.current_breakpoints_state = {
+        f"{env.working_dir}/test_pass.py|||1": f"b {env.working_dir}/test_pass.py:1",
+        f"{env.working_dir}/test_fail.py|||1": f"b {env.working_dir}/test_fail.py:1",
+    }
+    state = dict(env.current_breakpoints_state)
+    with patch.object(
+        pdb_tool, "interact_with_pdb", wraps=pdb_tool.interact_with_pdb
+    ) as interact:
+        out = pdb_tool.start_pdb(env)
+    # Only the hidden `where` is sent, the breakpoints are set by pdb at start-up.
+    assert [c.args[0] for c in interact.call_args_list] == ["where"]
+    assert out.startswith("> ") and "Breakpoint 1 at" not in out
+    assert out.endswith("Breakpoints have been restored.")
+    pdb_tool.update_breakpoints(env)
+    assert env.current_breakpoints_state == state
+
+
+@pytest.mark.parametrize(
+    "entrypoint,expected",
+    [
+        ("python -m pdb -m pytest", "python -m pdb -c 'b a.py:1' -c b -m pytest"),
+        ("python -m pdb", "python -m pdb -c 'b a.py:1' -c b"),
+        ("python -m pdbx app.py", "python -m pdbx app.py"),
+    ],
+)
+def test_with_startup_commands(entrypoint, expected):
+    assert with_startup_commands(entrypoint, ["b a.py:1", "b"]) == expected
+    assert with_startup_commands(entrypoint, []) == entrypoint
+
+
 def test_on_env_reset_calls_start_pdb(tmp_path, setup_pdb_repo_env):
     pdb_tool, env = setup_pdb_repo_env(tmp_path)
     called = []
@@ -0,0 +1,157 @@
+import pytest
+
+from debug_gym.gym.entities import Event
+from debug_gym.gym.envs.env import RepoEnv
+from debug_gym.gym.terminals.local import LocalTerminal
+from debug_gym.gym.tools.trace import TraceTool
+
+
+@pytest.fixture
+def setup_trace_repo_env(tmp_path):
+    working_dir = tmp_path / "tests_trace"
+    working_dir.mkdir()
+    (working_dir / "calc.py").write_text(
+        "def add(a, b):\n"
+        "    return a - b\n"
+        "\n"
+        "\n"
+        "def total(values):\n"
+        "    result = 0\n"
+        "    for value in values:\n"
+        "        result = add(result, value)\n"
+        "    return result\n"
+        "\n"
+        "\n"
+        "def unused():\n"
+        "    return None\n"
+    )
+    (working_dir / "test_calc.py").write_text(
+        "from calc import total\n\n\ndef test_total():\n    assert total([1, 2]) == 3\n"
+    )
+    env = RepoEnv(path=str(working_dir), terminal=LocalTerminal())
+    trace_tool = TraceTool()
+    trace_tool.register(env)
+    env.reset()
+    return trace_tool, env
+
+
+def test_trace_functions(setup_trace_repo_env):
+    trace_tool, env = setup_trace_repo_env
+    obs = trace_tool(env, query="functions", target="calc.py")
+    assert obs.source == "trace"
+    assert obs.observation == (
+        "calc.py:add (2 calls)\ncalc.py:<module> (1 calls)\ncalc.py:total (1 calls)"
+    )
+
+    obs = trace_tool(env, query="functions")
+    assert "test_calc.py:test_total (1 calls)" in obs.observation
+    assert "unused" not in obs.observation
+
+
+def test_trace_failing_tests_only(setup_trace_repo_env):
+    trace_tool, env = setup_trace_repo_env
+    env.workspace.write_file(
+        "test_unused.py",
+        "from calc import unused\n\n\ndef test_unused():\n    assert unused() is None\n",
+    )
+    env.eval()
+    assert env.failing_tests() == ["test_calc.py::test_total"]
+    obs = trace_tool(env, query="functions")
+    assert "test_calc.py:test_total (1 calls)" in obs.observation
+    assert "unused" not in obs.observation
+
+
+def test_trace_callers_and_callees(setup_trace_repo_env):
+    trace_tool, env = setup_trace_repo_env
+    obs = trace_tool(env, query="callers", target="total")
+    assert obs.observation == (
+        "Callers of calc.py:total:\n  test_calc.py:test_total (1 calls)"
+    )
+    obs = trace_tool(env, query="callees", target="calc.py:total")
+    assert obs.observation == (
+        "Functions called by calc.py:total:\n  calc.py:add (2 calls)"
+    )
+    obs = trace_tool(env, query="callers", target="unused")
+    assert obs.observation == "No executed function matches `unused`."
+
+
+def test_trace_lines(setup_trace_repo_env):
+    trace_tool, env = setup_trace_repo_env
+    obs = trace_tool(env, query="lines", target="calc.py:8-9")
+    assert obs.observation == ("calc.py:8 executed 2 times\ncalc.py:9 executed 1 times")
+    obs = trace_tool(env, query="lines", target="calc.py:13")
+    assert obs.observation == "calc.py:13 not executed"
+    obs = trace_tool(env, query="lines", target="calc.py:a-b")
+    assert obs.observation == "Invalid line range `a-b`, expected `start-end`."
+
+
+def test_trace_values(setup_trace_repo_env):
+    trace_tool, env = setup_trace_repo_env
+    obs = trace_tool(env, query="values", target="add")
+    assert obs.observation == (
+        "calc.py:add (2 calls), sampled values:\n"
+        "  call 1: (a=0, b=1)\n"
+        "  call 2: (a=-1, b=2)\n"
+        "  return 1: -1\n"
+        "  return 2: -3"
+    )
+
+
+def test_trace_invalid_query(setup_trace_repo_env):
+    trace_tool, env = setup_trace_repo_env
+    obs = trace_tool(env, query="callers")
+    assert obs.observation == "The `callers` query requires a target."
+    obs = trace_tool(env, query="stack")
+    assert obs.observation.startswith("Invalid query `stack`.")
+    assert trace_tool.index is None
+
+
+def test_trace_index_reused_until_rewrite(setup_trace_repo_env):
+    trace_tool, env = setup_trace_repo_env
+    trace_tool(env, query="functions")
+    index = trace_tool.index
+    trace_tool(env, query="values", target="add")
+    assert trace_tool.index is index  # The program was not traced again.
+
+    env.workspace.write_file(
+        "calc.py", env.workspace.read_file("calc.py").replace("a - b", "a + b")
+    )
+    env.queue_event(Event.REWRITE_SUCCESS, source="rewrite", file="calc.py")
+    env.process_events()
+    assert trace_tool.index is None
+    obs = trace_tool(env, query="values", target="add")
+    assert "return 2: 3" in obs.observation
+
+
+def test_trace_entrypoint_change(setup_trace_repo_env):
+    trace_tool, env = setup_trace_repo_env
+    trace_tool(env, query="functions")
+    obs = trace_tool(
+        env, query="functions", entrypoint="python -c 'import calc; calc.unused()'"
+    )
+    assert obs.observation == "calc.py:<module> (1 calls)\ncalc.py:unused (1 calls)"
+    assert trace_tool.entrypoint == "python -c 'import calc; calc.unused()'"
+
+    env.reset()
+    assert trace_tool.index is None and trace_tool.entrypoint is None
+
+
+def test_trace_failed(setup_trace_repo_env):
+    trace_tool, env = setup_trace_repo_env
+    trace_tool.index_file = "/non_existent_dir/trace.json"
+    obs = trace_tool(env, query="functions")
+    assert obs.observation.startswith("Failed to collect the trace of `python")
+    assert "No such file or directory" in obs.observation
+    assert trace_tool.index is None
+
+
+def test_trace_invalidated_on_file_change(setup_trace_repo_env):
+    trace_tool, env = setup_trace_repo_env
+    trace_tool(env, query="functions")
+    env.queue_event(Event.FILE_CHANGE, source="env", changes={"notes.txt": "created"})
+    env.process_events()
+    assert trace_tool.index is not None
+
+    env.queue_event(Event.FILE_CHANGE, source="env", changes={"calc.py": "modified"})
+    env.process_events()
+    assert trace_tool.index is None
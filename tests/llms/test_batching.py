@@ -0,0 +1,91 @@
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+from unittest.mock import MagicMock
+
+import pytest
+
+from debug_gym.llms.base import LLMResponse
+from debug_gym.llms.batching import BatchingLLM
+
+
+class FakeLLM:
+    """Records when each request is received, and echoes the prompt."""
+
+    def __init__(self, fail_on=None):
+        self.logger = MagicMock()
+        self.model_name = "fake"
+        self.fail_on = fail_on
+        self.calls = []
+        self._lock = threading.Lock()
+
+    def __call__(self, messages, tools, **kwargs):
+        with self._lock:
+            self.calls.append((time.monotonic(), messages[0]["content"]))
+        if messages[0]["content"] == self.fail_on:
+            raise ValueError("Generation failed.")
+        return LLMResponse(prompt=messages, response=messages[0]["content"])
+
+
+def prompt(content):
+    return [{"role": "user", "content": content}]
+
+
+def test_batching_llm_submits_full_batch():
+    llm = BatchingLLM(FakeLLM(), batch_size=3, max_wait=10)
+    with ThreadPoolExecutor(3) as executor:
+        futures = [executor.submit(llm, prompt(f"ep{i}"), []) for i in range(3)]
+        responses = [future.result(timeout=5) for future in futures]
+
+    # Responses are dispatched back to the episode which sent the request.
+    assert [r.response for r in responses] == ["ep0", "ep1", "ep2"]
+    stats = llm.stats
+    assert stats.batches == 1 and stats.requests == 3
+    assert stats.occupancy == 1.0
+    assert stats.max_queue_delay < 5
+    llm.close()
+
+
+def test_batching_llm_max_wait():
+    fake = FakeLLM()
+    llm = BatchingLLM(fake, batch_size=4, max_wait=0.2)
+    start = time.monotonic()
+    assert llm(prompt("alone"), []).response == "alone"
+
+    # A lone request is submitted after `max_wait`.
+    assert fake.calls[0][0] - start >= 0.2
+    assert llm.stats.occupancy == 0.25
+    assert llm.stats.mean_queue_delay >= 0.2
+    llm.close()
+
+
+def test_batching_llm_generate_batch():
+    fake = FakeLLM(fail_on="ep1")
+    llm = BatchingLLM(fake, batch_size=2, max_wait=10)
+    responses = llm.generate_batch([(prompt("ep0"), []), (prompt("ep2"), [])])
+    assert [r.response for r in responses] == ["ep0", "ep2"]
+
+    # Errors are raised in the episode which sent the request only.
+    future = llm.submit(prompt("ep1"), [])
+    other = llm.submit(prompt("ep3"), [])
+    with pytest.raises(ValueError, match="Generation failed"):
+        future.result(timeout=5)
+    assert other.result(timeout=5).response == "ep3"
+    assert llm.stats.batches == 2
+    llm.close()
+
+
+def test_batching_llm_close_flushes_pending():
+    llm = BatchingLLM(FakeLLM(), batch_size=4, max_wait=60)
+    future = llm.submit(prompt("pending"), [])
+    llm.close()
+    assert future.result(timeout=1).response == "pending"
+    with pytest.raises(RuntimeError):
+        llm.submit(prompt("late"), [])
+
+
+def test_batching_llm_delegates_attributes():
+    llm = BatchingLLM(FakeLLM(), batch_size=2)
+    assert llm.model_name == "fake"
+    with pytest.raises(ValueError):
+        BatchingLLM(FakeLLM(), batch_size=0)
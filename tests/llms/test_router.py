@@ -0,0 +1,194 @@
+import json
+import threading
+import urllib.request
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from types import SimpleNamespace
+from unittest.mock import patch
+
+import pytest
+
+from debug_gym.llms.base import LLMConfig
+from debug_gym.llms.openai import OpenAILLM
+from debug_gym.llms.router import EndpointRouter, prefix_key
+
+
+def test_router_pins_episodes():
+    router = EndpointRouter(["a", "b", "c"])
+    pinned = {key: router.acquire(key) for key in map(str, range(30))}
+    for endpoint in pinned.values():
+        router.release(endpoint)
+    # Episodes are spread over the replicas, and stick to theirs.
+    assert set(pinned.values()) == {"a", "b", "c"}
+    for key, endpoint in pinned.items():
+        assert router.acquire(key) == endpoint
+        router.release(endpoint)
+
+    stats = router.stats()
+    assert sum(s.requests for s in stats.values()) == 60
+    assert sum(s.cache_hits for s in stats.values()) == 30
+    assert all(s.in_flight == 0 and s.healthy for s in stats.values())
+    # The assignment is the same in other processes.
+    assert EndpointRouter(["a", "b", "c"]).acquire("0") == pinned["0"]
+
+
+def test_router_rebalances_on_overload():
+    router = EndpointRouter(["a", "b"], max_imbalance=2)
+    endpoint = router.acquire("episode")
+    other = "b" if endpoint == "a" else "a"
+    assert router.acquire("episode") == endpoint  # 1 in flight vs 0.
+    assert router.acquire("episode") == other  # 2 in flight vs 0.
+    # The episode is now pinned to the other replica.
+    assert router.acquire("episode") == other
+    assert router.stats()[other].cache_hits == 1
+
+
+def test_router_avoids_failed_endpoints():
+    router = EndpointRouter(["a", "b"], cooldown=60)
+    endpoint = router.acquire("episode")
+    other = "b" if endpoint == "a" else "a"
+    router.release(endpoint, failed=True)
+
+    assert router.acquire("episode") == other
+    stats = router.stats()
+    assert stats[endpoint].failures == 1
+    assert not stats[endpoint].healthy
+    # All replicas failed, try them anyway.
+    router.release(other, failed=True)
+    assert router.acquire("episode") in ("a", "b")
+
+
+def test_router_shared():
+    assert EndpointRouter.shared(["x", "y"]) is EndpointRouter.shared(["x", "y"])
+    assert EndpointRouter.shared(["x", "y"]) is not EndpointRouter.shared(["y", "x"])
+    with pytest.raises(ValueError):
+        EndpointRouter([])
+
+
+class StubHandler(BaseHTTPRequestHandler):
+    """Minimal OpenAI-compatible chat completion endpoint."""
+
+    def do_POST(self):
+        body = json.loads(self.rfile.read(int(self.headers["Content-Length"])))
+        self.server.requests.append(body)
+        if self.server.fail:
+            self.send_response(503)
+            self.end_headers()
+            return
+        response = {
+            "id": "1",
+            "object": "chat.completion",
+            "created": 0,
+            "model": body["model"],
+            "choices": [
+                {
+                    "index": 0,
+                    "finish_reason": "stop",
+                    "message": {"role": "assistant", "content": self.server.name},
+                }
+            ],
+            "usage": {"prompt_tokens": 1, "completion_tokens": 1, "total_tokens": 2},
+        }
+        payload = json.dumps(response).encode()
+        self.send_response(200)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(payload)))
+        self.end_headers()
+        self.wfile.write(payload)
+
+    def log_message(self, *args):
+        pass
+
+
+@pytest.fixture
+def stub_servers():
+    servers = []
+    for i in range(2):
+        server = ThreadingHTTPServer(("127.0.0.1", 0), StubHandler)
+        server.name, server.fail, server.requests = f"replica{i}", False, []
+        threading.Thread(target=server.serve_forever, daemon=True).start()
+        servers.append(server)
+    yield {f"http://127.0.0.1:{s.server_address[1]}/v1": s for s in servers}
+    for server in servers:
+        server.shutdown()
+
+
+class UrllibOpenAI:
+    """Minimal OpenAI client posting chat completions with urllib."""
+
+    def __init__(self, api_key, base_url, timeout=None):
+        self.chat = SimpleNamespace(completions=SimpleNamespace(create=self.create))
+        self.base_url = base_url
+
+    def create(self, **kwargs):
+        kwargs = {k: v for k, v in kwargs.items() if isinstance(v, (str, list))}
+        request = urllib.request.Request(
+            f"{self.base_url}/chat/completions",
+            data=json.dumps(kwargs).encode(),
+            headers={"Content-Type": "application/json"},
+        )
+        with urllib.request.urlopen(request) as response:
+            body = json.loads(response.read())
+        message = SimpleNamespace(tool_calls=None, **body["choices"][0]["message"])
+        usage = body["usage"]
+        return SimpleNamespace(
+            choices=[SimpleNamespace(message=message)],
+            usage=SimpleNamespace(
+                prompt_tokens=usage["prompt_tokens"],
+                completion_tokens=usage["completion_tokens"],
+            ),
+        )
+
+
+@pytest.fixture(autouse=True)
+def urllib_openai():
+    with patch("debug_gym.llms.openai.OpenAI", UrllibOpenAI):
+        yield
+
+
+def make_llm(endpoints, logger):
+    config = LLMConfig(
+        model="stub",
+        tokenizer="gpt-4o",
+        context_limit=4,
+        api_key="key",
+        endpoints=endpoints,
+    )
+    return OpenAILLM("stub", logger=logger, llm_config=config)
+
+
+def test_openai_llm_routes_to_stub_servers(stub_servers, logger_mock):
+    endpoints = list(stub_servers)
+    llm = make_llm(endpoints, logger_mock)
+    messages = [{"role": "user", "content": "Hello"}]
+    router = EndpointRouter.shared(endpoints)
+
+    replicas = set()
+    for episode in range(16):
+        llm.routing_key = f"uuid/task{episode}"
+        responses = {llm.generate(messages, []).response for _ in range(3)}
+        assert len(responses) == 1  # All steps of the episode on one replica.
+        replicas |= responses
+    assert replicas == {"replica0", "replica1"}
+    assert sum(s.cache_hits for s in router.stats().values()) == 32
+
+    # Without an episode key, requests are routed by their prefix.
+    llm.routing_key = None
+    endpoint = router.acquire(prefix_key(messages))
+    router.release(endpoint)
+    assert llm.generate(messages, []).response == stub_servers[endpoint].name
+
+
+def test_openai_llm_routes_away_from_failed_server(stub_servers, logger_mock):
+    endpoints = list(stub_servers)
+    llm = make_llm(endpoints, logger_mock)
+    llm.routing_key = "uuid/task"
+    llm.need_to_be_retried = lambda exception: True
+    router = EndpointRouter.shared(endpoints)
+    endpoint = router.acquire(llm.routing_key)
+    router.release(endpoint)
+    stub_servers[endpoint].fail = True
+
+    # The failed request is retried on the other replica.
+    response = llm.generate([{"role": "user", "content": "Hello"}], [])
+    assert response.response != stub_servers[endpoint].name
+    assert router.stats()[endpoint].failures == 1
@@ -0,0 +1,199 @@
+from unittest.mock import MagicMock, patch
+
+import pytest
+
+from debug_gym.gym.tools.tool import ToolCall
+from debug_gym.llms.base import LLM, LLMConfig, LLMResponse
+from debug_gym.llms.routing import RoutingLLM
+
+
+class FakeBackend:
+    """Calls the tools queued in `tool_names`, `None` for no tool call."""
+
+    def __init__(self, name, tool_names=()):
+        self.name = name
+        self.tool_names = list(tool_names)
+        self.calls = 0
+
+    def __call__(self, messages, tools, **kwargs):
+        self.calls += 1
+        tool_name = self.tool_names.pop(0) if self.tool_names else "view"
+        return LLMResponse(
+            prompt=messages,
+            response=self.name,
+            tool=ToolCall(
+                id="1",
+                name=tool_name or "empty_tool_response",
+                arguments={},
+            ),
+            prompt_token_count=1000,
+            response_token_count=100,
+        )
+
+
+def make_tools(*names):
+    tools = []
+    for name in names:
+        tool = MagicMock()
+        tool.name = name
+        tools.append(tool)
+    return tools
+
+
+TOOLS = make_tools("view", "listdir", "rewrite", "eval")
+MESSAGES = [{"role": "user", "content": "Fix the bug."}]
+
+
+def make_llm(backends, logger, **routing):
+    config = LLMConfig(
+        model="router",
+        tokenizer="gpt-4o",
+        context_limit=4,
+        tags=["routing"],
+        routing={"models": list(backends), **routing},
+    )
+    with patch.object(LLM, "instantiate", side_effect=lambda n, *a, **k: backends[n]):
+        return RoutingLLM("router", logger=logger, llm_config=config)
+
+
+def served_by(llm, steps):
+    return [llm(MESSAGES, TOOLS).serving.model for _ in range(steps)]
+
+
+def test_routing_llm_after_tool(logger_mock):
+    backends = {
+        "cheap": FakeBackend("cheap", ["view", "rewrite", "view"]),
+        "capable": FakeBackend("capable", ["eval", "view"]),
+    }
+    llm = make_llm(backends, logger_mock, first_steps=1, after_tool={"edit": "capable"})
+    # Planning on the capable model, then the step after a rewrite.
+    assert served_by(llm, 5) == ["capable", "cheap", "cheap", "capable", "cheap"]
+
+
+def test_routing_llm_escalates_invalid_responses(logger_mock):
+    backends = {
+        "cheap": FakeBackend("cheap", [None, "unknown_tool"]),
+        "capable": FakeBackend("capable"),
+    }
+    llm = make_llm(backends, logger_mock)
+    for _ in range(2):
+        response = llm(MESSAGES, TOOLS)
+        assert response.response == "capable"
+        assert response.serving.escalated_from == ["cheap"]
+    assert backends["cheap"].calls == 2
+
+    # Without escalation, invalid responses are returned as is.
+    backends["cheap"].tool_names = [None]
+    llm.escalate_invalid = False
+    response = llm(MESSAGES, TOOLS)
+    assert response.tool.name == "empty_tool_response"
+    assert response.serving.model == "cheap"
+
+
+def test_routing_llm_failure_streak(logger_mock):
+    backends = {
+        "cheap": FakeBackend("cheap", [None, None]),
+        "capable": FakeBackend("capable", [None, "view"]),
+    }
+    llm = make_llm(backends, logger_mock, escalate=False, failure_streak=2)
+    # Two invalid responses in a row, then the capable model until it succeeds.
+    assert served_by(llm, 5) == ["cheap", "cheap", "capable", "capable", "cheap"]
+
+
+def test_routing_llm_resets_per_episode(logger_mock):
+    backends = {"cheap": FakeBackend("cheap"), "capable": FakeBackend("capable")}
+    llm = make_llm(backends, logger_mock, first_steps=1)
+    llm.routing_key = "uuid/task1"
+    assert served_by(llm, 2) == ["capable", "cheap"]
+    llm.routing_key = "uuid/task2"
+    assert served_by(llm, 2) == ["capable", "cheap"]
+
+
+def test_routing_llm_fork(logger_mock):
+    backends = {"cheap": FakeBackend("cheap"), "capable": FakeBackend("capable")}
+    llm = make_llm(backends, logger_mock, first_steps=2)
+    llm.routing_key = "uuid/task"
+    assert served_by(llm, 1) == ["capable"]
+
+    # Forks continue from the episode's state, without changing it.
+    fork = llm.fork("uuid/task/branch1")
+    assert fork.routing_key == "uuid/task/branch1"
+    assert served_by(fork, 2) == ["capable", "cheap"]
+    assert llm.episode().step == 1
+    assert served_by(llm, 1) == ["capable"]
+
+
+def test_routing_llm_records_cost_and_latency(logger_mock):
+    backends = {"cheap": FakeBackend("cheap"), "capable": FakeBackend("capable")}
+    llm = make_llm(backends, logger_mock, costs={"cheap": [1.0, 10.0]})
+    serving = llm(MESSAGES, TOOLS).serving
+    assert round(serving.cost, 6) == (1000 * 1.0 + 100 * 10.0) / 1e6
+    assert serving.latency >= 0
+    assert "served by cheap" in logger_mock._log_history[-1]
+
+
+def test_routing_llm_cost_and_latency_include_invalid_responses(logger_mock):
+    clock = [0.0]
+
+    def slow(backend, seconds):
+        def call(*args, **kwargs):
+            clock[0] += seconds
+            return backend(*args, **kwargs)
+
+        return call
+
+    backends = {
+        "cheap": slow(FakeBackend("cheap", [None]), 1),
+        "capable": slow(FakeBackend("capable"), 2),
+    }
+    llm = make_llm(
+        backends, logger_mock, costs={"cheap": [1.0, 10.0], "capable": [2.0, 20.0]}
+    )
+    with patch("debug_gym.llms.routing.time.monotonic", lambda: clock[0]):
+        serving = llm(MESSAGES, TOOLS).serving
+    assert serving.model == "capable"
+    assert serving.latency == 3
+    # Both the invalid response of the cheap model and the capable one.
+    assert round(serving.cost, 6) == 0.002 + 0.004
+
+
+def test_routing_llm_config_errors(logger_mock):
+    with pytest.raises(ValueError, match="routing.models"):
+        make_llm({}, logger_mock)
+    with pytest.raises(ValueError, match="Unknown models"):
+        make_llm({"cheap": FakeBackend("cheap")}, logger_mock, after_tool={"x": "y"})
+
+
+def test_instantiate_routing_llm(tmp_path, logger_mock):
+    config_file = tmp_path / "llm.yaml"
+    config_file.write_text(
+        "router:\n"
+        "  model: router\n"
+        "  tokenizer: gpt-4o\n"
+        "  context_limit: 4\n"
+        "  tags: [routing]\n"
+        "  routing:\n"
+        "    models: [cheap, capable]\n"
+        "cheap:\n"
+        "  model: cheap\n"
+        "  tokenizer: gpt-4o\n"
+        "  context_limit: 4\n"
+        "  api_key: key\n"
+        "  endpoint: http://localhost\n"
+        "capable:\n"
+        "  model: capable\n"
+        "  tokenizer: gpt-4o\n"
+        "  context_limit: 4\n"
+        "  api_key: key\n"
+        "  endpoint: http://localhost\n"
+    )
+    llm = LLM.instantiate("router", str(config_file), logger=logger_mock)
+    assert isinstance(llm, RoutingLLM)
+    assert [m.model_name for m in llm.models.values()] == ["cheap", "capable"]
+
+
+def test_routing_llm_escalate(logger_mock):
+    backends = {"cheap": FakeBackend("cheap"), "capable": FakeBackend("capable")}
+    llm = make_llm(backends, logger_mock)
+    llm.escalate()
+    assert served_by(llm, 2) == ["capable", "cheap"]
@@ -107,6 +107,7 @@ def test_task_progress_pending_status():
     [
         ("resolved", "✓"),
         ("unresolved", "✗"),
+        ("stalled", "↻"),
         ("skip-resolved", "✓"),
         ("skip-unresolved", "✗"),
         ("error", "!"),
@@ -128,6 +129,7 @@ def test_taskprogress_marker_invalid():
     [
         ("resolved", "green"),
         ("unresolved", "red"),
+        ("stalled", "dark_orange"),
         ("skip-resolved", "yellow"),
         ("skip-unresolved", "yellow"),
         ("error", "red"),